@@ -0,0 +1,309 @@
+#include "Archive.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <unordered_set>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    struct Mapping
+    {
+        const std::byte* data;
+        std::size_t size;
+    };
+
+    Mapping mapFile(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        KORELIB_VERIFY_THROW(file != INVALID_HANDLE_VALUE, korelib::RuntimeException, fmt::format("Failed to open archive '{}'", path.string()));
+
+        LARGE_INTEGER fileSize{};
+        GetFileSizeEx(file, &fileSize);
+        HANDLE mapping = fileSize.QuadPart > 0 ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        CloseHandle(file);
+        KORELIB_VERIFY_THROW(mapping != nullptr, korelib::RuntimeException, fmt::format("Failed to map archive '{}'", path.string()));
+
+        const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        KORELIB_VERIFY_THROW(view != nullptr, korelib::RuntimeException, fmt::format("Failed to map archive '{}'", path.string()));
+
+        return { static_cast<const std::byte*>(view), static_cast<std::size_t>(fileSize.QuadPart) };
+#else
+        const int file = ::open(path.c_str(), O_RDONLY);
+        KORELIB_VERIFY_THROW(file >= 0, korelib::RuntimeException, fmt::format("Failed to open archive '{}'", path.string()));
+
+        struct stat fileStat{};
+        const bool hasSize = fstat(file, &fileStat) == 0 && fileStat.st_size > 0;
+        void* view = hasSize ? mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+        ::close(file);
+        KORELIB_VERIFY_THROW(view != MAP_FAILED, korelib::RuntimeException, fmt::format("Failed to map archive '{}'", path.string()));
+
+        return { static_cast<const std::byte*>(view), static_cast<std::size_t>(fileStat.st_size) };
+#endif
+    }
+
+    void unmapFile(const std::byte* data, std::size_t size)
+    {
+#ifdef _WIN32
+        (void)size;
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<std::byte*>(data), size);
+#endif
+    }
+}
+
+std::shared_ptr<Archive> Archive::open(const std::filesystem::path& path)
+{
+    const Mapping mapping = mapFile(path);
+    try
+    {
+        return std::shared_ptr<Archive>(new Archive(path, mapping.data, mapping.size));
+    }
+    catch (...)
+    {
+        unmapFile(mapping.data, mapping.size);
+        throw;
+    }
+}
+
+Archive::Archive(std::filesystem::path path, const std::byte* data, std::size_t size) : m_path(std::move(path)), m_data(data), m_size(size)
+{
+    KORELIB_VERIFY_THROW(m_size >= sizeof(Header), korelib::RuntimeException, fmt::format("Archive '{}' is truncated", m_path.string()));
+
+    m_header = reinterpret_cast<const Header*>(m_data);
+    KORELIB_VERIFY_THROW(m_header->magic == MAGIC, korelib::RuntimeException, fmt::format("'{}' is not an archive", m_path.string()));
+    KORELIB_VERIFY_THROW(m_header->version == VERSION, korelib::RuntimeException, fmt::format("Archive '{}' has unsupported version {}", m_path.string(), m_header->version));
+
+    const uint64_t tocEntriesSize = static_cast<uint64_t>(m_header->entryCount) * sizeof(TocEntry);
+    KORELIB_VERIFY_THROW(m_header->tocOffset % alignof(TocEntry) == 0 && m_header->tocOffset <= m_size && m_header->tocSize <= m_size - m_header->tocOffset && tocEntriesSize <= m_header->tocSize,
+        korelib::RuntimeException, fmt::format("Archive '{}' has a corrupt table of contents", m_path.string()));
+
+    m_toc = reinterpret_cast<const TocEntry*>(m_data + m_header->tocOffset);
+    m_names = reinterpret_cast<const char*>(m_data + m_header->tocOffset + tocEntriesSize);
+    m_namesSize = m_header->tocSize - tocEntriesSize;
+
+    for (const TocEntry& entry : tocEntries())
+    {
+        KORELIB_VERIFY_THROW(entry.offset <= m_header->tocOffset && entry.size <= m_header->tocOffset - entry.offset && static_cast<uint64_t>(entry.nameOffset) + entry.nameLength <= m_namesSize,
+            korelib::RuntimeException, fmt::format("Archive '{}' has an entry out of bounds", m_path.string()));
+    }
+}
+
+Archive::~Archive()
+{
+    unmapFile(m_data, m_size);
+}
+
+std::span<const Archive::TocEntry> Archive::tocEntries() const
+{
+    return { m_toc, m_header->entryCount };
+}
+
+std::span<const std::byte> Archive::find(std::string_view name) const
+{
+    const uint64_t hash = hashName(name);
+    const std::span<const TocEntry> entries = tocEntries();
+
+    auto it = std::lower_bound(entries.begin(), entries.end(), hash, [](const TocEntry& entry, uint64_t value) { return entry.nameHash < value; });
+    for (; it != entries.end() && it->nameHash == hash; ++it)
+    {
+        if (std::string_view(m_names + it->nameOffset, it->nameLength) == name)
+        {
+            return { m_data + it->offset, static_cast<std::size_t>(it->size) };
+        }
+    }
+
+    return {};
+}
+
+bool Archive::contains(std::string_view name) const
+{
+    return find(name).data() != nullptr;
+}
+
+std::size_t Archive::entryCount() const
+{
+    return m_header->entryCount;
+}
+
+std::string_view Archive::entryName(std::size_t index) const
+{
+    const TocEntry& entry = tocEntries()[index];
+    return { m_names + entry.nameOffset, entry.nameLength };
+}
+
+const std::filesystem::path& Archive::path() const
+{
+    return m_path;
+}
+
+std::string Archive::entryNameOf(const std::filesystem::path& path)
+{
+    std::string name = path.lexically_normal().generic_string();
+    if (name.starts_with("./"))
+    {
+        name.erase(0, 2);
+    }
+    return name;
+}
+
+void Archive::mount(std::shared_ptr<const Archive> archive)
+{
+    KORELIB_VERIFY_THROW(archive != nullptr, korelib::RuntimeException, "archive is null");
+
+    std::unique_lock lock(g_mountMutex);
+    g_mounted.emplace_back(std::move(archive));
+}
+
+void Archive::unmountAll()
+{
+    std::unique_lock lock(g_mountMutex);
+    g_mounted.clear();
+}
+
+Archive::MountedEntry Archive::findMounted(const std::filesystem::path& path)
+{
+    const std::string name = entryNameOf(path);
+
+    std::shared_lock lock(g_mountMutex);
+    for (auto it = g_mounted.rbegin(); it != g_mounted.rend(); ++it)
+    {
+        if (std::span<const std::byte> data = (*it)->find(name); data.data() != nullptr)
+        {
+            return { .archive = *it, .data = data };
+        }
+    }
+
+    return {};
+}
+
+void ArchiveWriter::add(std::string name, std::vector<std::byte> data)
+{
+    KORELIB_VERIFY_THROW(!name.empty(), korelib::RuntimeException, "Archive entry name is empty");
+    m_entries.emplace_back(PendingEntry{ .name = std::move(name), .data = std::move(data) });
+}
+
+void ArchiveWriter::addFile(std::string name, const std::filesystem::path& file)
+{
+    std::ifstream stream(file, std::ios::binary);
+    KORELIB_VERIFY_THROW(stream.is_open(), korelib::RuntimeException, fmt::format("Failed to open '{}'", file.string()));
+
+    std::vector<std::byte> data(static_cast<std::size_t>(std::filesystem::file_size(file)));
+    stream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    KORELIB_VERIFY_THROW(stream.good() || data.empty(), korelib::RuntimeException, fmt::format("Failed to read '{}'", file.string()));
+
+    add(std::move(name), std::move(data));
+}
+
+void ArchiveWriter::addDirectory(const std::filesystem::path& directory, const Transform& transform)
+{
+    std::vector<std::filesystem::path> files{};
+    for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory))
+    {
+        if (entry.is_regular_file())
+        {
+            files.emplace_back(entry.path());
+        }
+    }
+
+    // Directory iteration order is unspecified, sorting keeps archives reproducible
+    std::sort(files.begin(), files.end());
+    for (const std::filesystem::path& file : files)
+    {
+        std::string name = Archive::entryNameOf(std::filesystem::relative(file, directory));
+        if (std::optional<std::vector<std::byte>> transformed = transform ? transform(file) : std::nullopt; transformed.has_value())
+        {
+            add(std::move(name), std::move(*transformed));
+            continue;
+        }
+
+        addFile(std::move(name), file);
+    }
+}
+
+std::size_t ArchiveWriter::entryCount() const
+{
+    return m_entries.size();
+}
+
+void ArchiveWriter::write(const std::filesystem::path& path) const
+{
+    std::vector<std::size_t> order(m_entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](std::size_t lhs, std::size_t rhs) {
+        return Archive::hashName(m_entries[lhs].name) < Archive::hashName(m_entries[rhs].name);
+    });
+
+    std::vector<Archive::TocEntry> toc{};
+    std::string names{};
+    std::unordered_set<std::string_view> uniqueNames{};
+    toc.reserve(m_entries.size());
+
+    uint64_t offset = alignUp(sizeof(Archive::Header), Archive::ENTRY_ALIGNMENT);
+    for (std::size_t index : order)
+    {
+        const PendingEntry& entry = m_entries[index];
+        KORELIB_VERIFY_THROW(uniqueNames.emplace(entry.name).second, korelib::RuntimeException, fmt::format("Duplicate archive entry '{}'", entry.name));
+
+        toc.emplace_back(Archive::TocEntry{
+            .nameHash = Archive::hashName(entry.name),
+            .offset = offset,
+            .size = entry.data.size(),
+            .nameOffset = static_cast<uint32_t>(names.size()),
+            .nameLength = static_cast<uint32_t>(entry.name.size())
+        });
+        names += entry.name;
+        offset = alignUp(offset + entry.data.size(), Archive::ENTRY_ALIGNMENT);
+    }
+
+    const Archive::Header header {
+        .magic = Archive::MAGIC,
+        .version = Archive::VERSION,
+        .entryCount = static_cast<uint32_t>(toc.size()),
+        .tocOffset = offset,
+        .tocSize = toc.size() * sizeof(Archive::TocEntry) + names.size()
+    };
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    KORELIB_VERIFY_THROW(stream.is_open(), korelib::RuntimeException, fmt::format("Failed to create archive '{}'", path.string()));
+
+    static constexpr std::array<char, Archive::ENTRY_ALIGNMENT> PADDING{};
+    auto padTo = [&stream](uint64_t position) {
+        const uint64_t current = static_cast<uint64_t>(stream.tellp());
+        stream.write(PADDING.data(), static_cast<std::streamsize>(position - current));
+    };
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (std::size_t tocIndex = 0; tocIndex < toc.size(); tocIndex++)
+    {
+        const PendingEntry& entry = m_entries[order[tocIndex]];
+        padTo(toc[tocIndex].offset);
+        stream.write(reinterpret_cast<const char*>(entry.data.data()), static_cast<std::streamsize>(entry.data.size()));
+    }
+
+    padTo(header.tocOffset);
+    stream.write(reinterpret_cast<const char*>(toc.data()), static_cast<std::streamsize>(toc.size() * sizeof(Archive::TocEntry)));
+    stream.write(names.data(), static_cast<std::streamsize>(names.size()));
+    KORELIB_VERIFY_THROW(stream.good(), korelib::RuntimeException, fmt::format("Failed to write archive '{}'", path.string()));
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Korelib.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only pack file holding many resources in one memory-mapped file.
+//
+// Layout, all integers little endian:
+//   Header     | magic, version, entry count, TOC offset and size
+//   Entry data | each entry starts on an ENTRY_ALIGNMENT boundary
+//   TOC        | TocEntry records sorted by name hash, followed by the entry names
+//
+// Entry names are generic relative paths such as "Textures/Grass_Block.jpg".
+// find() hands out spans into the mapping, they stay valid as long as the Archive is alive.
+class Archive
+{
+public:
+    static constexpr std::array<char, 8> MAGIC { 'L', 'O', 'G', 'L', 'P', 'A', 'K', '\0' };
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t ENTRY_ALIGNMENT = 64;
+
+    struct Header
+    {
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint64_t tocOffset;
+        uint64_t tocSize;
+    };
+
+    struct TocEntry
+    {
+        uint64_t nameHash;
+        uint64_t offset;
+        uint64_t size;
+        // Relative to the end of the TocEntry array
+        uint32_t nameOffset;
+        uint32_t nameLength;
+    };
+
+    // Keeps the archive alive, and so the mapping behind data, while the entry is in use
+    struct MountedEntry
+    {
+        std::shared_ptr<const Archive> archive;
+        std::span<const std::byte> data;
+    };
+
+    static_assert(std::endian::native == std::endian::little, "Archive files are read in place and stored little endian");
+    static_assert(sizeof(Header) == 32 && sizeof(TocEntry) == 32);
+
+public:
+    static std::shared_ptr<Archive> open(const std::filesystem::path& path);
+    ~Archive();
+
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    // Empty span when the archive has no entry with that name
+    std::span<const std::byte> find(std::string_view name) const;
+    bool contains(std::string_view name) const;
+    std::size_t entryCount() const;
+    std::string_view entryName(std::size_t index) const;
+    const std::filesystem::path& path() const;
+
+    // FNV-1a, the TOC is sorted by this value
+    static constexpr uint64_t hashName(std::string_view name)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (char character : name)
+        {
+            hash ^= static_cast<uint8_t>(character);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // Normalized entry name of a resource path, e.g. "./Textures/../Textures/Grass_Block.jpg" -> "Textures/Grass_Block.jpg"
+    static std::string entryNameOf(const std::filesystem::path& path);
+
+    // Mounted archives are searched by resources with StorageType::ARCHIVE, the most recently mounted archive first.
+    // Safe to call from any thread.
+    static void mount(std::shared_ptr<const Archive> archive);
+    static void unmountAll();
+    // archive is null when no mounted archive has the entry
+    static MountedEntry findMounted(const std::filesystem::path& path);
+
+private:
+    Archive(std::filesystem::path path, const std::byte* data, std::size_t size);
+
+    std::span<const TocEntry> tocEntries() const;
+
+private:
+    std::filesystem::path m_path;
+    const std::byte* m_data;
+    std::size_t m_size;
+    const Header* m_header;
+    const TocEntry* m_toc;
+    const char* m_names;
+    std::size_t m_namesSize;
+
+    static inline std::shared_mutex g_mountMutex {};
+    static inline std::vector<std::shared_ptr<const Archive>> g_mounted {};
+};
+
+// Builds an archive file from in-memory blobs or files on disk
+class ArchiveWriter
+{
+public:
+    // Returns the bytes to store instead of the file contents, or nothing to store the file as it is
+    using Transform = std::function<std::optional<std::vector<std::byte>>(const std::filesystem::path& file)>;
+
+public:
+    void add(std::string name, std::vector<std::byte> data);
+    void addFile(std::string name, const std::filesystem::path& file);
+    // Adds every regular file below directory, named by its path relative to directory
+    void addDirectory(const std::filesystem::path& directory, const Transform& transform = {});
+
+    std::size_t entryCount() const;
+    void write(const std::filesystem::path& path) const;
+
+private:
+    struct PendingEntry
+    {
+        std::string name;
+        std::vector<std::byte> data;
+    };
+
+    std::vector<PendingEntry> m_entries;
+};
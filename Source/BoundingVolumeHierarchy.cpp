@@ -0,0 +1,435 @@
+#include "BoundingVolumeHierarchy.hpp"
+#include "Korelib.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+    // A leaf escaping its fat bounds is refit in place unless that would grow its parent by more than this
+    constexpr float REINSERT_GROWTH = 1.25f;
+    // Keeps points and flat boxes from escaping their fat bounds on every tiny movement
+    constexpr float MIN_FAT_MARGIN = 0.01f;
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(float fatMargin) : m_fatMargin(fatMargin)
+{
+}
+
+BoundingVolumeHierarchy::ProxyId BoundingVolumeHierarchy::create(const AABB& bounds, uint32_t userData)
+{
+    const uint32_t leaf = allocateNode();
+    m_nodes[leaf].bounds = fatten(bounds);
+    m_nodes[leaf].userData = userData;
+    m_nodes[leaf].height = 0;
+
+    insertLeaf(leaf);
+    m_proxyCount++;
+
+    return leaf;
+}
+
+void BoundingVolumeHierarchy::destroy(ProxyId proxy)
+{
+    KORELIB_VERIFY_THROW(proxy < m_nodes.size() && m_nodes[proxy].isLeaf() && m_nodes[proxy].height == 0, korelib::RuntimeException, "Invalid BVH proxy");
+
+    removeLeaf(proxy);
+    freeNode(proxy);
+    m_proxyCount--;
+}
+
+bool BoundingVolumeHierarchy::move(ProxyId proxy, const AABB& bounds)
+{
+    KORELIB_VERIFY_THROW(proxy < m_nodes.size() && m_nodes[proxy].isLeaf() && m_nodes[proxy].height == 0, korelib::RuntimeException, "Invalid BVH proxy");
+
+    if (m_nodes[proxy].bounds.contains(bounds))
+    {
+        return false;
+    }
+
+    const AABB fatBounds = fatten(bounds);
+    if (const uint32_t parent = m_nodes[proxy].parent; parent != NULL_NODE)
+    {
+        const AABB& parentBounds = m_nodes[parent].bounds;
+        if (parentBounds.merged(fatBounds).surfaceArea() <= parentBounds.surfaceArea() * REINSERT_GROWTH)
+        {
+            m_nodes[proxy].bounds = fatBounds;
+            refitAncestors(parent);
+            return true;
+        }
+    }
+
+    removeLeaf(proxy);
+    m_nodes[proxy].bounds = fatBounds;
+    insertLeaf(proxy);
+
+    return true;
+}
+
+uint32_t BoundingVolumeHierarchy::userData(ProxyId proxy) const
+{
+    return m_nodes[proxy].userData;
+}
+
+void BoundingVolumeHierarchy::setUserData(ProxyId proxy, uint32_t userData)
+{
+    m_nodes[proxy].userData = userData;
+}
+
+const AABB& BoundingVolumeHierarchy::fatBounds(ProxyId proxy) const
+{
+    return m_nodes[proxy].bounds;
+}
+
+std::size_t BoundingVolumeHierarchy::proxyCount() const
+{
+    return m_proxyCount;
+}
+
+int32_t BoundingVolumeHierarchy::height() const
+{
+    return m_root == NULL_NODE ? 0 : m_nodes[m_root].height;
+}
+
+BoundingVolumeHierarchy::CullStats BoundingVolumeHierarchy::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+    PROFILE_ZONE("BoundingVolumeHierarchy::cull");
+
+    CullStats stats{};
+    if (m_root == NULL_NODE)
+    {
+        return stats;
+    }
+
+    const std::size_t firstVisible = visible.size();
+
+    std::vector<uint32_t> stack{};
+    stack.reserve(64);
+    stack.emplace_back(m_root);
+
+    std::array<uint32_t, 4> batch{};
+    std::array<float, 4> centerX{}, centerY{}, centerZ{}, extentX{}, extentY{}, extentZ{};
+    while (!stack.empty())
+    {
+        const uint32_t count = static_cast<uint32_t>(std::min<std::size_t>(stack.size(), batch.size()));
+        for (uint32_t lane = 0; lane < batch.size(); lane++)
+        {
+            if (lane >= count)
+            {
+                extentX[lane] = -1.0f;
+                continue;
+            }
+
+            batch[lane] = stack.back();
+            stack.pop_back();
+
+            const AABB& bounds = m_nodes[batch[lane]].bounds;
+            const glm::vec3 center = bounds.center();
+            const glm::vec3 extents = bounds.extents();
+            centerX[lane] = center.x;
+            centerY[lane] = center.y;
+            centerZ[lane] = center.z;
+            extentX[lane] = extents.x;
+            extentY[lane] = extents.y;
+            extentZ[lane] = extents.z;
+        }
+
+        uint32_t outsideMask{};
+        uint32_t insideMask{};
+        frustum.classify4(centerX, centerY, centerZ, extentX, extentY, extentZ, outsideMask, insideMask);
+        stats.nodesTested += count;
+
+        for (uint32_t lane = 0; lane < count; lane++)
+        {
+            const uint32_t bit = 1u << lane;
+            if ((outsideMask & bit) != 0)
+            {
+                continue;
+            }
+
+            const Node& node = m_nodes[batch[lane]];
+            if (node.isLeaf())
+            {
+                visible.emplace_back(node.userData);
+            }
+            else if ((insideMask & bit) != 0)
+            {
+                collectLeaves(batch[lane], visible);
+            }
+            else
+            {
+                stack.emplace_back(node.left);
+                stack.emplace_back(node.right);
+            }
+        }
+    }
+
+    stats.visible = static_cast<uint32_t>(visible.size() - firstVisible);
+    stats.culled = static_cast<uint32_t>(m_proxyCount) - stats.visible;
+
+    return stats;
+}
+
+uint32_t BoundingVolumeHierarchy::allocateNode()
+{
+    uint32_t index = m_freeList;
+    if (index != NULL_NODE)
+    {
+        m_freeList = m_nodes[index].parent;
+    }
+    else
+    {
+        index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    m_nodes[index] = Node{ .bounds = {}, .parent = NULL_NODE, .left = NULL_NODE, .right = NULL_NODE, .userData = 0, .height = 0 };
+    return index;
+}
+
+void BoundingVolumeHierarchy::freeNode(uint32_t index)
+{
+    m_nodes[index].parent = m_freeList;
+    m_nodes[index].height = -1;
+    m_freeList = index;
+}
+
+void BoundingVolumeHierarchy::insertLeaf(uint32_t leaf)
+{
+    if (m_root == NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Descend towards the sibling that increases the total surface area the least
+    const AABB leafBounds = m_nodes[leaf].bounds;
+    uint32_t index = m_root;
+    while (!m_nodes[index].isLeaf())
+    {
+        const Node& node = m_nodes[index];
+        const float area = node.bounds.surfaceArea();
+        const float combinedArea = node.bounds.merged(leafBounds).surfaceArea();
+
+        // Pairing with this node creates a parent of combinedArea, descending pushes the growth onto every ancestor
+        const float cost = 2.0f * combinedArea;
+        const float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto childCost = [&](uint32_t child) {
+            const Node& childNode = m_nodes[child];
+            const float mergedArea = childNode.bounds.merged(leafBounds).surfaceArea();
+            return (childNode.isLeaf() ? mergedArea : mergedArea - childNode.bounds.surfaceArea()) + inheritanceCost;
+        };
+
+        const float leftCost = childCost(node.left);
+        const float rightCost = childCost(node.right);
+        if (cost < leftCost && cost < rightCost)
+        {
+            break;
+        }
+
+        index = leftCost < rightCost ? node.left : node.right;
+    }
+
+    const uint32_t sibling = index;
+    const uint32_t oldParent = m_nodes[sibling].parent;
+    const uint32_t newParent = allocateNode();
+
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].bounds = leafBounds.merged(m_nodes[sibling].bounds);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].left = sibling;
+    m_nodes[newParent].right = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent == NULL_NODE)
+    {
+        m_root = newParent;
+    }
+    else if (m_nodes[oldParent].left == sibling)
+    {
+        m_nodes[oldParent].left = newParent;
+    }
+    else
+    {
+        m_nodes[oldParent].right = newParent;
+    }
+
+    refitAncestors(newParent);
+}
+
+void BoundingVolumeHierarchy::removeLeaf(uint32_t leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    const uint32_t parent = m_nodes[leaf].parent;
+    const uint32_t grandParent = m_nodes[parent].parent;
+    const uint32_t sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+    m_nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    if (grandParent == NULL_NODE)
+    {
+        m_root = sibling;
+        return;
+    }
+
+    if (m_nodes[grandParent].left == parent)
+    {
+        m_nodes[grandParent].left = sibling;
+    }
+    else
+    {
+        m_nodes[grandParent].right = sibling;
+    }
+
+    refitAncestors(grandParent);
+}
+
+void BoundingVolumeHierarchy::refitAncestors(uint32_t index)
+{
+    while (index != NULL_NODE)
+    {
+        index = balance(index);
+
+        Node& node = m_nodes[index];
+        const Node& left = m_nodes[node.left];
+        const Node& right = m_nodes[node.right];
+        node.height = 1 + std::max(left.height, right.height);
+        node.bounds = left.bounds.merged(right.bounds);
+
+        index = node.parent;
+    }
+}
+
+uint32_t BoundingVolumeHierarchy::balance(uint32_t indexA)
+{
+    // Rotates the taller grandchild up when the children of A differ in height by more than one, returns the new subtree root
+    Node& a = m_nodes[indexA];
+    if (a.isLeaf() || a.height < 2)
+    {
+        return indexA;
+    }
+
+    const uint32_t indexB = a.left;
+    const uint32_t indexC = a.right;
+    Node& b = m_nodes[indexB];
+    Node& c = m_nodes[indexC];
+
+    auto replaceChild = [this](uint32_t parent, uint32_t oldChild, uint32_t newChild) {
+        if (parent == NULL_NODE)
+        {
+            m_root = newChild;
+        }
+        else if (m_nodes[parent].left == oldChild)
+        {
+            m_nodes[parent].left = newChild;
+        }
+        else
+        {
+            m_nodes[parent].right = newChild;
+        }
+    };
+
+    const int32_t difference = c.height - b.height;
+    if (difference > 1)
+    {
+        const uint32_t indexF = c.left;
+        const uint32_t indexG = c.right;
+        Node& f = m_nodes[indexF];
+        Node& g = m_nodes[indexG];
+
+        c.left = indexA;
+        c.parent = a.parent;
+        a.parent = indexC;
+        replaceChild(c.parent, indexA, indexC);
+
+        if (f.height > g.height)
+        {
+            c.right = indexF;
+            a.right = indexG;
+            g.parent = indexA;
+            a.bounds = b.bounds.merged(g.bounds);
+            c.bounds = a.bounds.merged(f.bounds);
+            a.height = 1 + std::max(b.height, g.height);
+            c.height = 1 + std::max(a.height, f.height);
+        }
+        else
+        {
+            c.right = indexG;
+            a.right = indexF;
+            f.parent = indexA;
+            a.bounds = b.bounds.merged(f.bounds);
+            c.bounds = a.bounds.merged(g.bounds);
+            a.height = 1 + std::max(b.height, f.height);
+            c.height = 1 + std::max(a.height, g.height);
+        }
+
+        return indexC;
+    }
+
+    if (difference < -1)
+    {
+        const uint32_t indexD = b.left;
+        const uint32_t indexE = b.right;
+        Node& d = m_nodes[indexD];
+        Node& e = m_nodes[indexE];
+
+        b.left = indexA;
+        b.parent = a.parent;
+        a.parent = indexB;
+        replaceChild(b.parent, indexA, indexB);
+
+        if (d.height > e.height)
+        {
+            b.right = indexD;
+            a.left = indexE;
+            e.parent = indexA;
+            a.bounds = c.bounds.merged(e.bounds);
+            b.bounds = a.bounds.merged(d.bounds);
+            a.height = 1 + std::max(c.height, e.height);
+            b.height = 1 + std::max(a.height, d.height);
+        }
+        else
+        {
+            b.right = indexE;
+            a.left = indexD;
+            d.parent = indexA;
+            a.bounds = c.bounds.merged(d.bounds);
+            b.bounds = a.bounds.merged(e.bounds);
+            a.height = 1 + std::max(c.height, d.height);
+            b.height = 1 + std::max(a.height, e.height);
+        }
+
+        return indexB;
+    }
+
+    return indexA;
+}
+
+void BoundingVolumeHierarchy::collectLeaves(uint32_t index, std::vector<uint32_t>& visible) const
+{
+    const Node& node = m_nodes[index];
+    if (node.isLeaf())
+    {
+        visible.emplace_back(node.userData);
+        return;
+    }
+
+    collectLeaves(node.left, visible);
+    collectLeaves(node.right, visible);
+}
+
+AABB BoundingVolumeHierarchy::fatten(const AABB& bounds) const
+{
+    const glm::vec3 size = bounds.max - bounds.min;
+    return bounds.inflated(std::max(m_fatMargin * std::max({ size.x, size.y, size.z }), MIN_FAT_MARGIN));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Bounds.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Dynamic AABB tree over world-space bounds.
+// Leaves store fattened bounds so small movements only refit their ancestors instead of reinserting,
+// and insertion picks the sibling by surface area cost and keeps the tree balanced with rotations.
+class BoundingVolumeHierarchy
+{
+public:
+    using ProxyId = uint32_t;
+
+    static constexpr ProxyId INVALID_PROXY = std::numeric_limits<uint32_t>::max();
+    // Fraction of the largest side added around leaves
+    static constexpr float DEFAULT_FAT_MARGIN = 0.1f;
+
+    struct CullStats
+    {
+        uint32_t visible;
+        uint32_t culled;
+        uint32_t nodesTested;
+    };
+
+public:
+    explicit BoundingVolumeHierarchy(float fatMargin = DEFAULT_FAT_MARGIN);
+
+    ProxyId create(const AABB& bounds, uint32_t userData);
+    void destroy(ProxyId proxy);
+    // Returns false when bounds still fit inside the fat leaf and nothing changed
+    bool move(ProxyId proxy, const AABB& bounds);
+
+    uint32_t userData(ProxyId proxy) const;
+    void setUserData(ProxyId proxy, uint32_t userData);
+    const AABB& fatBounds(ProxyId proxy) const;
+    std::size_t proxyCount() const;
+    int32_t height() const;
+
+    // Appends the user data of every leaf not completely outside frustum.
+    // Nodes are tested four at a time, subtrees completely inside are accepted without further tests.
+    CullStats cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+private:
+    static constexpr uint32_t NULL_NODE = std::numeric_limits<uint32_t>::max();
+
+    struct Node
+    {
+        AABB bounds;
+        uint32_t parent;
+        uint32_t left;
+        uint32_t right;
+        uint32_t userData;
+        // Leaves are 0, free nodes -1
+        int32_t height;
+
+        bool isLeaf() const { return left == NULL_NODE; }
+    };
+
+    uint32_t allocateNode();
+    void freeNode(uint32_t index);
+    void insertLeaf(uint32_t leaf);
+    void removeLeaf(uint32_t leaf);
+    // Recomputes bounds and heights from index up to the root, rebalancing on the way
+    void refitAncestors(uint32_t index);
+    uint32_t balance(uint32_t index);
+    void collectLeaves(uint32_t index, std::vector<uint32_t>& visible) const;
+    AABB fatten(const AABB& bounds) const;
+
+private:
+    std::vector<Node> m_nodes;
+    uint32_t m_root { NULL_NODE };
+    uint32_t m_freeList { NULL_NODE };
+    std::size_t m_proxyCount { 0 };
+    float m_fatMargin;
+};
@@ -0,0 +1,180 @@
+#include "Bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define BOUNDS_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+AABB AABB::fromCenterExtents(const glm::vec3& center, const glm::vec3& extents)
+{
+    return { center - extents, center + extents };
+}
+
+bool AABB::isEmpty() const
+{
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+glm::vec3 AABB::center() const
+{
+    return (min + max) * 0.5f;
+}
+
+glm::vec3 AABB::extents() const
+{
+    return (max - min) * 0.5f;
+}
+
+float AABB::surfaceArea() const
+{
+    if (isEmpty())
+    {
+        return 0.0f;
+    }
+
+    const glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void AABB::expand(const glm::vec3& point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+AABB AABB::merged(const AABB& other) const
+{
+    return { glm::min(min, other.min), glm::max(max, other.max) };
+}
+
+AABB AABB::inflated(float margin) const
+{
+    return { min - glm::vec3(margin), max + glm::vec3(margin) };
+}
+
+bool AABB::contains(const AABB& other) const
+{
+    return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+}
+
+bool AABB::overlaps(const AABB& other) const
+{
+    return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+}
+
+AABB AABB::transformed(const glm::mat4& matrix) const
+{
+    if (isEmpty())
+    {
+        return *this;
+    }
+
+    // Arvo: the extents of the new box are the extents projected onto the absolute basis vectors
+    const glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+    const glm::vec3 oldExtents = extents();
+    glm::vec3 newExtents{};
+    for (int32_t row = 0; row < 3; row++)
+    {
+        newExtents[row] = std::abs(matrix[0][row]) * oldExtents.x + std::abs(matrix[1][row]) * oldExtents.y + std::abs(matrix[2][row]) * oldExtents.z;
+    }
+
+    return fromCenterExtents(newCenter, newExtents);
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+{
+    const glm::vec4 row0 { viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0] };
+    const glm::vec4 row1 { viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1] };
+    const glm::vec4 row2 { viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2] };
+    const glm::vec4 row3 { viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3] };
+
+    Frustum frustum { .planes = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 } };
+    for (glm::vec4& plane : frustum.planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+Frustum::Result Frustum::classify(const AABB& bounds) const
+{
+    const glm::vec3 center = bounds.center();
+    const glm::vec3 extents = bounds.extents();
+
+    Result result = Result::INSIDE;
+    for (const glm::vec4& plane : planes)
+    {
+        const float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+        const float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+        if (distance < -radius)
+        {
+            return Result::OUTSIDE;
+        }
+        if (distance < radius)
+        {
+            result = Result::INTERSECTS;
+        }
+    }
+
+    return result;
+}
+
+void Frustum::classify4(const std::array<float, 4>& centerX, const std::array<float, 4>& centerY, const std::array<float, 4>& centerZ,
+                        const std::array<float, 4>& extentX, const std::array<float, 4>& extentY, const std::array<float, 4>& extentZ,
+                        uint32_t& outsideMask, uint32_t& insideMask) const
+{
+#ifdef BOUNDS_SSE2
+    const __m128 cx = _mm_loadu_ps(centerX.data());
+    const __m128 cy = _mm_loadu_ps(centerY.data());
+    const __m128 cz = _mm_loadu_ps(centerZ.data());
+    const __m128 ex = _mm_loadu_ps(extentX.data());
+    const __m128 ey = _mm_loadu_ps(extentY.data());
+    const __m128 ez = _mm_loadu_ps(extentZ.data());
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 outside = _mm_cmplt_ps(ex, zero);
+    __m128 partial = zero;
+    for (const glm::vec4& plane : planes)
+    {
+        const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                                           _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+        const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex), _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey)),
+                                         _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        partial = _mm_or_ps(partial, _mm_cmplt_ps(_mm_sub_ps(distance, radius), zero));
+    }
+
+    outsideMask = static_cast<uint32_t>(_mm_movemask_ps(outside));
+    insideMask = static_cast<uint32_t>(_mm_movemask_ps(partial)) ^ 0xfu;
+    insideMask &= ~outsideMask;
+#else
+    outsideMask = 0;
+    insideMask = 0;
+    for (uint32_t lane = 0; lane < 4; lane++)
+    {
+        if (extentX[lane] < 0.0f)
+        {
+            outsideMask |= 1u << lane;
+            continue;
+        }
+
+        const AABB bounds = AABB::fromCenterExtents({ centerX[lane], centerY[lane], centerZ[lane] }, { extentX[lane], extentY[lane], extentZ[lane] });
+        switch (classify(bounds))
+        {
+            case Result::OUTSIDE:
+                outsideMask |= 1u << lane;
+                break;
+            case Result::INSIDE:
+                insideMask |= 1u << lane;
+                break;
+            default:
+                break;
+        }
+    }
+#endif
+}
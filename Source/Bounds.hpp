@@ -0,0 +1,55 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+// Axis-aligned bounding box, min > max means empty
+struct AABB
+{
+    glm::vec3 min { std::numeric_limits<float>::max() };
+    glm::vec3 max { std::numeric_limits<float>::lowest() };
+
+    static AABB fromCenterExtents(const glm::vec3& center, const glm::vec3& extents);
+
+    bool isEmpty() const;
+    glm::vec3 center() const;
+    glm::vec3 extents() const;
+    float surfaceArea() const;
+
+    void expand(const glm::vec3& point);
+    AABB merged(const AABB& other) const;
+    AABB inflated(float margin) const;
+    bool contains(const AABB& other) const;
+    bool overlaps(const AABB& other) const;
+
+    // Bounds of this box after transformation, a box around the transformed box rather than around the geometry
+    AABB transformed(const glm::mat4& matrix) const;
+};
+
+// Six inward facing planes (normal, distance) extracted from a view-projection matrix
+struct Frustum
+{
+    enum class Result : uint8_t
+    {
+        OUTSIDE,
+        INTERSECTS,
+        INSIDE
+    };
+
+    std::array<glm::vec4, 6> planes;
+
+    // Gribb/Hartmann extraction for OpenGL clip space, pass projection * view
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    Result classify(const AABB& bounds) const;
+
+    // Tests four boxes against every plane at once, SIMD lanes are boxes.
+    // Bit i of outsideMask is set when box i is completely outside, bit i of insideMask when it is completely inside.
+    // Unused lanes should hold empty extents and are reported as outside.
+    void classify4(const std::array<float, 4>& centerX, const std::array<float, 4>& centerY, const std::array<float, 4>& centerZ,
+                   const std::array<float, 4>& extentX, const std::array<float, 4>& extentY, const std::array<float, 4>& extentZ,
+                   uint32_t& outsideMask, uint32_t& insideMask) const;
+};
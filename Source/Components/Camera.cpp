@@ -30,12 +30,18 @@ const glm::mat4& Camera::projection() const
     return m_projection;
 }
 
-void Camera::update()
+void Camera::update(float)
 {
     const glm::uvec2 windowSize = Gfx::getWindowSize();
     m_projection = glm::perspective(glm::radians(m_fov), static_cast<float>(windowSize.x) / static_cast<float>(windowSize.y), m_near, m_far);
+}
 
-    const std::shared_ptr<GameObject>& parent = std::static_pointer_cast<GameObject>(getParent());
-    Gfx::Transform& transform = parent->m_transform;
-    m_view = glm::lookAt(transform.position, transform.position + transform.front(), transform.up());
+void Camera::updateView()
+{
+    // front and up are in the parent's space. Only the rotations of the ancestors take them to world space,
+    // so a scale of zero anywhere in the hierarchy can't make the view singular
+    const TransformRef transform = gameObject().transform();
+    const glm::quat parentRotation = transform.worldRotation() * glm::inverse(transform.rotation());
+    const glm::vec3 eye(transform.worldMatrix()[3]);
+    m_view = glm::lookAt(eye, eye + parentRotation * transform.front(), parentRotation * transform.up());
 }
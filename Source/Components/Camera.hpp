@@ -8,7 +8,9 @@ class Camera : public Component
 public:
     Camera(const std::shared_ptr<Entity>& parent, float fov, float near, float far);
 
-    void update() override;
+    void update(float deltaTime) override;
+    // Rebuilds the view from the world matrix, Scene calls it for the active camera once world matrices are propagated
+    void updateView();
 
     float& fov();
     float& near();
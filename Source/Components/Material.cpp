@@ -0,0 +1,68 @@
+#include "Material.hpp"
+#include "Gfx.hpp"
+
+#include "fmt/format.h"
+
+Material::Material(const std::shared_ptr<Entity>& parent) : Component("Material", parent), m_features(ShaderPermutations::NONE), m_textureLayer(0)
+{
+}
+
+Gfx::ShaderType Material::shaderProgram() const
+{
+    return m_program.has_value() ? ShaderCache::program(*m_program) : ShaderPermutations::program(features());
+}
+
+void Material::setShader(std::string_view vertexSource, std::string_view fragmentSource, std::span<const std::string_view> defines)
+{
+    m_program = ShaderCache::request(vertexSource, fragmentSource, defines);
+}
+
+ShaderPermutations::FeatureMask Material::features() const
+{
+    return m_features | ShaderPermutations::INSTANCING | (isTextureArray() ? ShaderPermutations::TEXTURE_ARRAY : ShaderPermutations::NONE);
+}
+
+void Material::setFeatures(ShaderPermutations::FeatureMask features)
+{
+    KORELIB_VERIFY_THROW((features & ShaderPermutations::VOXEL) == 0 || isTextureArray(), korelib::RuntimeException, "VOXEL needs an ARRAY texture atlas, set it before the feature");
+    m_features = features & (ShaderPermutations::LIGHTING | ShaderPermutations::FOG | ShaderPermutations::VOXEL);
+}
+
+Gfx::TextureIdType Material::textureId() const
+{
+    if (m_textureAtlas != nullptr)
+    {
+        return m_textureAtlas->getTextureId();
+    }
+
+    return m_texture != nullptr ? m_texture->getTextureId() : 0;
+}
+
+bool Material::isTextureArray() const
+{
+    return m_textureAtlas != nullptr && m_textureAtlas->getLayout() == TextureAtlas::Layout::ARRAY;
+}
+
+uint32_t Material::textureLayer() const
+{
+    return isTextureArray() ? m_textureLayer : 0;
+}
+
+void Material::setTexture(std::shared_ptr<Texture> texture)
+{
+    KORELIB_VERIFY_THROW((m_features & ShaderPermutations::VOXEL) == 0, korelib::RuntimeException, "VOXEL materials sample an ARRAY texture atlas, not a texture");
+    m_texture = std::move(texture);
+    m_textureAtlas.reset();
+    m_textureLayer = 0;
+}
+
+void Material::setTextureAtlas(std::shared_ptr<const TextureAtlas> atlas, uint32_t layer)
+{
+    KORELIB_VERIFY_THROW(atlas == nullptr || layer < atlas->getLayerCount(), korelib::RuntimeException, fmt::format("Atlas layer {} out of range", layer));
+    KORELIB_VERIFY_THROW((m_features & ShaderPermutations::VOXEL) == 0 || (atlas != nullptr && atlas->getLayout() == TextureAtlas::Layout::ARRAY), korelib::RuntimeException,
+        "VOXEL materials need an ARRAY texture atlas");
+
+    m_textureAtlas = std::move(atlas);
+    m_texture.reset();
+    m_textureLayer = layer;
+}
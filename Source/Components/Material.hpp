@@ -0,0 +1,45 @@
+#pragma once
+
+#include "SceneGraph.hpp"
+#include "ShaderCache.hpp"
+#include "ShaderPermutations.hpp"
+#include "Texture.hpp"
+#include "TextureAtlas.hpp"
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+
+class Material : public Component
+{
+public:
+    Material(const std::shared_ptr<Entity>& parent);
+
+    // The variant of features(), or the program of setShader. The default program while either is still linking.
+    Gfx::ShaderType shaderProgram() const;
+    // The program has to declare the inputs and uniforms of Gfx::DEFAULT_VERTEX_SHADER/DEFAULT_FRAGMENT_SHADER built with INSTANCING
+    void setShader(std::string_view vertexSource, std::string_view fragmentSource, std::span<const std::string_view> defines = {});
+
+    // Features the material draws with. INSTANCING is always part of them since RenderQueue draws instanced,
+    // TEXTURE_ARRAY follows the layout of the atlas.
+    ShaderPermutations::FeatureMask features() const;
+    // Only LIGHTING, FOG and VOXEL are taken from the mask, the other bits follow from how the material is drawn.
+    // VOXEL samples a texture array, it throws unless an ARRAY atlas is set and the texture setters keep it that way
+    void setFeatures(ShaderPermutations::FeatureMask features);
+
+    Gfx::TextureIdType textureId() const;
+    bool isTextureArray() const;
+    uint32_t textureLayer() const;
+    void setTexture(std::shared_ptr<Texture> texture);
+    // Materials on the same atlas share one texture binding, the mesh UVs have to be remapped into the texture region.
+    // layer is the page of that region and only matters for ARRAY atlases.
+    void setTextureAtlas(std::shared_ptr<const TextureAtlas> atlas, uint32_t layer = 0);
+
+protected:
+    std::optional<ShaderCache::ProgramKey> m_program;
+    ShaderPermutations::FeatureMask m_features;
+    std::shared_ptr<Texture> m_texture;
+    std::shared_ptr<const TextureAtlas> m_textureAtlas;
+    uint32_t m_textureLayer;
+};
@@ -0,0 +1,235 @@
+#include "MeshRenderer.hpp"
+#include "Camera.hpp"
+#include "Material.hpp"
+#include "Gfx.hpp"
+#include "MeshOptimizer.hpp"
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <unordered_map>
+
+MeshRenderer::MeshRenderer(const std::shared_ptr<Entity>& parent, PrimitiveType primitiveType) : MeshRenderer(parent, primitiveMesh(primitiveType))
+{
+}
+
+MeshRenderer::MeshRenderer(const std::shared_ptr<Entity>& parent, std::shared_ptr<const Mesh> mesh) : MeshRenderer(parent, std::vector<Lod>{ Lod{ .mesh = std::move(mesh), .error = 0.0f } })
+{
+}
+
+MeshRenderer::MeshRenderer(const std::shared_ptr<Entity>& parent, std::vector<Lod> lods) : RenderComponent("MeshRenderer", parent)
+{
+    setLods(std::move(lods));
+    m_material = gameObject().addComponent<Material>();
+}
+
+AABB MeshRenderer::localBounds() const
+{
+    // Simplified levels only keep vertices of the full mesh, so they stay inside its bounds
+    return m_mesh->getBounds();
+}
+
+void MeshRenderer::render()
+{
+    m_lodIndex = selectLod();
+    const Mesh& mesh = *m_lods[m_lodIndex].mesh;
+    RenderQueue::submit({
+        .shaderProgram = m_material->shaderProgram(),
+        .texture = m_material->textureId(),
+        .mesh = &mesh,
+        .model = mesh.hasPositionTransform() ? gameObject().transform().worldMatrix() * mesh.getPositionTransform() : gameObject().transform().worldMatrix(),
+        .textureArray = m_material->isTextureArray(),
+        .textureLayer = m_material->textureLayer()
+    });
+}
+
+const std::shared_ptr<const Mesh>& MeshRenderer::getMesh() const
+{
+    return m_mesh;
+}
+
+void MeshRenderer::setMesh(std::shared_ptr<const Mesh> mesh)
+{
+    setLods({ Lod{ .mesh = std::move(mesh), .error = 0.0f } });
+}
+
+const std::vector<MeshRenderer::Lod>& MeshRenderer::getLods() const
+{
+    return m_lods;
+}
+
+void MeshRenderer::setLods(std::vector<Lod> lods)
+{
+    KORELIB_VERIFY_THROW(!lods.empty() && std::all_of(lods.begin(), lods.end(), [](const Lod& lod) { return lod.mesh != nullptr; }), korelib::RuntimeException, "mesh is null");
+    m_lods = std::move(lods);
+    m_mesh = m_lods.front().mesh;
+    m_lodIndex = std::min(m_lodIndex, static_cast<uint32_t>(m_lods.size() - 1));
+    markBoundsDirty();
+}
+
+uint32_t MeshRenderer::lodIndex() const
+{
+    return m_lodIndex;
+}
+
+std::vector<MeshRenderer::Lod> MeshRenderer::buildLods(std::shared_ptr<const Mesh> mesh, const MeshSimplifier::LodSettings& settings)
+{
+    KORELIB_VERIFY_THROW(mesh != nullptr && !mesh->getVertices().empty(), korelib::RuntimeException, "LODs need a mesh made of Gfx::Vertex");
+
+    std::vector<MeshSimplifier::Result> levels = MeshSimplifier::buildLodChain(mesh->getVertices(), mesh->getTriangles(), settings);
+    std::vector<Lod> lods{};
+    lods.reserve(levels.size() + 1);
+    lods.push_back({ .mesh = std::move(mesh), .error = 0.0f });
+    for (MeshSimplifier::Result& level : levels)
+    {
+        // Collapses leave the triangles in no useful order
+        MeshOptimizer::optimize(level.vertices, level.triangles);
+        lods.push_back({ .mesh = std::make_shared<Mesh>(std::move(level.vertices), std::move(level.triangles)), .error = level.error });
+    }
+
+    return lods;
+}
+
+float MeshRenderer::lodErrorPixels()
+{
+    return g_lodErrorPixels;
+}
+
+void MeshRenderer::setLodErrorPixels(float pixels)
+{
+    g_lodErrorPixels = std::max(pixels, 0.0f);
+}
+
+uint32_t MeshRenderer::selectLod()
+{
+    const std::shared_ptr<Camera> camera = Gfx::getActiveCamera();
+    if (m_lods.size() == 1 || camera == nullptr)
+    {
+        return 0;
+    }
+
+    // Pixels one object space unit covers at the nearest depth of the bounds, errors project the same way
+    const glm::mat4& world = gameObject().transform().worldMatrix();
+    const float scale = std::max({ glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2])) });
+    const AABB& bounds = m_mesh->getBounds();
+    const glm::vec4 center = camera->view() * world * glm::vec4(bounds.center(), 1.0f);
+    const float depth = std::max(-center.z - glm::length(bounds.extents()) * scale, camera->near());
+    const float pixelsPerUnit = camera->projection()[1][1] * 0.5f * static_cast<float>(Gfx::getWindowSize().y) * scale / depth;
+
+    uint32_t level = std::min(m_lodIndex, static_cast<uint32_t>(m_lods.size() - 1));
+    while (level > 0 && m_lods[level].error * pixelsPerUnit > g_lodErrorPixels)
+    {
+        level--;
+    }
+    while (level + 1 < m_lods.size() && m_lods[level + 1].error * pixelsPerUnit <= g_lodErrorPixels * (1.0f - LOD_HYSTERESIS))
+    {
+        level++;
+    }
+
+    return level;
+}
+
+std::shared_ptr<const Mesh> MeshRenderer::primitiveMesh(PrimitiveType primitiveType)
+{
+    // Every renderer of a primitive shares one mesh, which is what lets RenderQueue instance them
+    static std::unordered_map<PrimitiveType, std::weak_ptr<const Mesh>> primitives{};
+    if (std::shared_ptr<const Mesh> mesh = primitives[primitiveType].lock(); mesh != nullptr)
+    {
+        return mesh;
+    }
+
+    std::vector<Gfx::Vertex> vertices{};
+    std::vector<std::array<uint32_t, 3>> triangles{};
+
+    switch (primitiveType)
+    {
+        case PrimitiveType::CUBE:
+        {
+            vertices.reserve(24);
+            vertices = {
+                /*[ 0]*/ {{-0.5f, -0.5f,  0.5f},     {0.0f, 1.0f / 3}},  // front  - bottom - left
+                /*[ 1]*/ {{-0.5f,  0.5f,  0.5f}, {0.0f, 1.0f / 3 * 2}},  // front  - top    - left
+                /*[ 2]*/ {{ 0.5f,  0.5f,  0.5f}, {1.0f, 1.0f / 3 * 2}},  // front  - top    - right
+                /*[ 3]*/ {{ 0.5f, -0.5f,  0.5f},     {1.0f, 1.0f / 3}},  // front  - bottom - right
+                /*[ 4]*/ {{-0.5f, -0.5f, -0.5f},     {0.0f, 1.0f / 3}},  // back   - bottom - left
+                /*[ 5]*/ {{-0.5f,  0.5f, -0.5f}, {0.0f, 1.0f / 3 * 2}},  // back   - top    - left
+                /*[ 6]*/ {{ 0.5f,  0.5f, -0.5f}, {1.0f, 1.0f / 3 * 2}},  // back   - top    - right
+                /*[ 7]*/ {{ 0.5f, -0.5f, -0.5f},     {1.0f, 1.0f / 3}},  // back   - bottom - right
+                /*[ 8]*/ {{-0.5f, -0.5f, -0.5f},     {0.0f, 1.0f / 3}},  // left   - bottom - back
+                /*[ 9]*/ {{-0.5f,  0.5f, -0.5f}, {0.0f, 1.0f / 3 * 2}},  // left   - top    - back
+                /*[10]*/ {{-0.5f,  0.5f,  0.5f}, {1.0f, 1.0f / 3 * 2}},  // left   - top    - front
+                /*[11]*/ {{-0.5f, -0.5f,  0.5f},     {1.0f, 1.0f / 3}},  // left   - bottom - front
+                /*[12]*/ {{ 0.5f, -0.5f, -0.5f},     {0.0f, 1.0f / 3}},  // right  - bottom - back
+                /*[13]*/ {{ 0.5f,  0.5f, -0.5f}, {0.0f, 1.0f / 3 * 2}},  // right  - top    - back
+                /*[14]*/ {{ 0.5f,  0.5f,  0.5f}, {1.0f, 1.0f / 3 * 2}},  // right  - top    - front
+                /*[15]*/ {{ 0.5f, -0.5f,  0.5f},     {1.0f, 1.0f / 3}},  // right  - bottom - front
+                /*[16]*/ {{-0.5f,  0.5f,  0.5f}, {0.0f, 1.0f / 3 * 2}},  // top    - near   - left
+                /*[17]*/ {{-0.5f,  0.5f, -0.5f},         {0.0f, 1.0f}},  // top    - far    - left
+                /*[18]*/ {{ 0.5f,  0.5f, -0.5f},         {1.0f, 1.0f}},  // top    - far    - right
+                /*[19]*/ {{ 0.5f,  0.5f,  0.5f}, {1.0f, 1.0f / 3 * 2}},  // top    - near   - right
+                /*[20]*/ {{-0.5f, -0.5f,  0.5f},         {0.0f, 0.0f}},  // bottom - near   - left
+                /*[21]*/ {{-0.5f, -0.5f, -0.5f},     {0.0f, 1.0f / 3}},  // bottom - far    - left
+                /*[22]*/ {{ 0.5f, -0.5f, -0.5f},     {1.0f, 1.0f / 3}},  // bottom - far    - right
+                /*[23]*/ {{ 0.5f, -0.5f,  0.5f},         {1.0f, 0.0f}},  // bottom - near   - right
+            };
+
+            triangles.reserve(36);
+            triangles = {
+                 { 2,  1,  0},  {0,  3,  2}, // front
+                 { 7,  5,  6},  {7,  4,  5}, // back
+                 { 8, 11, 10},  {9,  8, 10}, // left
+                 {15, 12, 13}, {13, 14, 15}, // right
+                 {17, 16, 19}, {18, 17, 19}, // top
+                 {21, 22, 20}, {23, 20, 22}, // bottom
+            };
+            break;
+        }
+        case PrimitiveType::SPHERE:
+        {
+            static constexpr uint32_t RINGS = 24;
+            static constexpr uint32_t SEGMENTS = 48;
+
+            // The first and last column and every pole vertex are doubled, they differ only in their UVs
+            vertices.reserve((RINGS + 1) * (SEGMENTS + 1));
+            for (uint32_t ring = 0; ring <= RINGS; ring++)
+            {
+                const float phi = std::numbers::pi_v<float> * static_cast<float>(ring) / RINGS;
+                for (uint32_t segment = 0; segment <= SEGMENTS; segment++)
+                {
+                    const float theta = 2.0f * std::numbers::pi_v<float> * static_cast<float>(segment) / SEGMENTS;
+                    vertices.push_back({
+                        {0.5f * std::sin(phi) * std::cos(theta), 0.5f * std::cos(phi), 0.5f * std::sin(phi) * std::sin(theta)},
+                        {static_cast<float>(segment) / SEGMENTS, 1.0f - static_cast<float>(ring) / RINGS}
+                    });
+                }
+            }
+
+            triangles.reserve(2 * (RINGS - 1) * SEGMENTS);
+            for (uint32_t ring = 0; ring < RINGS; ring++)
+            {
+                for (uint32_t segment = 0; segment < SEGMENTS; segment++)
+                {
+                    const uint32_t above = ring * (SEGMENTS + 1) + segment;
+                    const uint32_t below = above + SEGMENTS + 1;
+                    // The rows at the poles collapse to a point and only need one triangle per segment
+                    if (ring != 0)
+                    {
+                        triangles.push_back({above, above + 1, below});
+                    }
+                    if (ring != RINGS - 1)
+                    {
+                        triangles.push_back({above + 1, below + 1, below});
+                    }
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    std::shared_ptr<const Mesh> mesh = std::make_shared<Mesh>(std::move(vertices), std::move(triangles));
+    primitives[primitiveType] = mesh;
+    return mesh;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SceneGraph.hpp"
+#include "Mesh.hpp"
+#include "MeshSimplifier.hpp"
+
+#include <memory>
+#include <vector>
+
+class MeshRenderer : public RenderComponent
+{
+public:
+    enum class PrimitiveType : uint8_t
+    {
+        CUBE,
+        // UV sphere of radius 0.5, dense enough to be worth simplifying
+        SPHERE,
+    };
+
+    struct Lod
+    {
+        std::shared_ptr<const Mesh> mesh;
+        // Object space distance to the full detail surface
+        float error;
+    };
+
+    // Screen space error a level may show before a finer one is drawn
+    static constexpr float DEFAULT_LOD_ERROR_PIXELS = 1.0f;
+    // A coarser level is only picked once its error is this much below the threshold, so a renderer sitting right
+    // at a switching distance doesn't flip between two levels every frame
+    static constexpr float LOD_HYSTERESIS = 0.25f;
+
+public:
+    MeshRenderer(const std::shared_ptr<Entity>& parent, PrimitiveType primitiveType);
+    MeshRenderer(const std::shared_ptr<Entity>& parent, std::shared_ptr<const Mesh> mesh);
+    // lods[0] is the full detail mesh, the following levels have growing errors
+    MeshRenderer(const std::shared_ptr<Entity>& parent, std::vector<Lod> lods);
+
+    AABB localBounds() const override;
+    void render() override;
+
+    // The full detail mesh
+    const std::shared_ptr<const Mesh>& getMesh() const;
+    // Drops the LODs, the mesh becomes the only level
+    void setMesh(std::shared_ptr<const Mesh> mesh);
+    const std::vector<Lod>& getLods() const;
+    void setLods(std::vector<Lod> lods);
+    // Level drawn by the last render()
+    uint32_t lodIndex() const;
+
+    static std::shared_ptr<const Mesh> primitiveMesh(PrimitiveType primitiveType);
+    // Simplifies mesh into a chain starting with mesh itself, the mesh has to be made of Gfx::Vertex
+    static std::vector<Lod> buildLods(std::shared_ptr<const Mesh> mesh, const MeshSimplifier::LodSettings& settings = {});
+
+    static float lodErrorPixels();
+    static void setLodErrorPixels(float pixels);
+
+protected:
+    uint32_t selectLod();
+
+protected:
+    std::shared_ptr<const Mesh> m_mesh;
+    std::vector<Lod> m_lods;
+    uint32_t m_lodIndex { 0 };
+    std::shared_ptr<class Material> m_material;
+
+    static inline float g_lodErrorPixels { DEFAULT_LOD_ERROR_PIXELS };
+};
@@ -0,0 +1,258 @@
+#include "VoxelChunk.hpp"
+#include "Material.hpp"
+#include "Profiler.hpp"
+#include "RenderQueue.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+namespace
+{
+    bool isInside(const glm::ivec3& position)
+    {
+        return glm::all(glm::greaterThanEqual(position, glm::ivec3(0))) && glm::all(glm::lessThan(position, glm::ivec3(VoxelChunk::SIZE)));
+    }
+}
+
+VoxelChunk::VoxelChunk(const std::shared_ptr<Entity>& parent, std::shared_ptr<const VoxelPalette> palette) : RenderComponent("VoxelChunk", parent), m_palette(std::move(palette))
+{
+    KORELIB_VERIFY_THROW(m_palette != nullptr, korelib::RuntimeException, "palette is null");
+    m_material = gameObject().addComponent<Material>();
+    m_material->setTextureAtlas(m_palette->getAtlas());
+    m_material->setFeatures(ShaderPermutations::VOXEL);
+}
+
+VoxelChunk::~VoxelChunk()
+{
+    // The faces of the neighbours towards this chunk are visible now
+    for (std::size_t side = 0; side < m_neighbours.size(); side++)
+    {
+        unlinkNeighbour(static_cast<Side>(side));
+    }
+}
+
+VoxelChunk::BlockId VoxelChunk::getBlock(const glm::ivec3& position) const
+{
+    return isInside(position) ? m_blocks[VoxelMesher::blockIndex(position.x, position.y, position.z)] : VoxelMesher::AIR;
+}
+
+void VoxelChunk::setBlock(const glm::ivec3& position, BlockId block)
+{
+    KORELIB_VERIFY_THROW(isInside(position), korelib::RuntimeException, fmt::format("Block ({}, {}, {}) is outside the chunk", position.x, position.y, position.z));
+    KORELIB_VERIFY_THROW(block <= m_palette->maxBlockId(), korelib::RuntimeException, fmt::format("Block ID {} is not in the palette", block));
+
+    BlockId& current = m_blocks[VoxelMesher::blockIndex(position.x, position.y, position.z)];
+    if (current == block)
+    {
+        return;
+    }
+
+    current = block;
+    markDirty();
+
+    for (int32_t axis = 0; axis < 3; axis++)
+    {
+        if (position[axis] == 0 || position[axis] == SIZE - 1)
+        {
+            const Side side = static_cast<Side>(axis * 2 + (position[axis] == 0 ? 0 : 1));
+            if (std::shared_ptr<VoxelChunk> neighbour = m_neighbours[static_cast<std::size_t>(side)].lock(); neighbour != nullptr)
+            {
+                neighbour->markDirty();
+            }
+        }
+    }
+}
+
+void VoxelChunk::fill(const glm::ivec3& min, const glm::ivec3& max, BlockId block)
+{
+    const glm::ivec3 first = glm::max(min, glm::ivec3(0));
+    const glm::ivec3 last = glm::min(max, glm::ivec3(SIZE - 1));
+    for (int32_t z = first.z; z <= last.z; z++)
+    {
+        for (int32_t y = first.y; y <= last.y; y++)
+        {
+            for (int32_t x = first.x; x <= last.x; x++)
+            {
+                setBlock({ x, y, z }, block);
+            }
+        }
+    }
+}
+
+void VoxelChunk::setNeighbour(Side side, const std::shared_ptr<VoxelChunk>& neighbour)
+{
+    KORELIB_VERIFY_THROW(neighbour.get() != this, korelib::RuntimeException, "A chunk can't neighbour itself");
+
+    unlinkNeighbour(side);
+    markDirty();
+    if (neighbour != nullptr)
+    {
+        // The chunk it was linked to on that side loses it
+        neighbour->unlinkNeighbour(opposite(side));
+        m_neighbours[static_cast<std::size_t>(side)] = neighbour;
+        neighbour->m_neighbours[static_cast<std::size_t>(opposite(side))] = std::static_pointer_cast<VoxelChunk>(shared_from_this());
+        neighbour->markDirty();
+    }
+}
+
+void VoxelChunk::unlinkNeighbour(Side side)
+{
+    const std::shared_ptr<VoxelChunk> previous = std::exchange(m_neighbours[static_cast<std::size_t>(side)], {}).lock();
+    if (previous == nullptr)
+    {
+        return;
+    }
+
+    // Compared by owner, in the destructor the link back to this chunk has already expired
+    std::weak_ptr<VoxelChunk>& back = previous->m_neighbours[static_cast<std::size_t>(opposite(side))];
+    const std::weak_ptr<Entity> self = weak_from_this();
+    if (!back.owner_before(self) && !self.owner_before(back))
+    {
+        back.reset();
+    }
+    previous->markDirty();
+}
+
+bool VoxelChunk::isDirty() const
+{
+    return m_dirty;
+}
+
+bool VoxelChunk::isMeshing() const
+{
+    return m_job != nullptr;
+}
+
+const std::shared_ptr<const Mesh>& VoxelChunk::getMesh() const
+{
+    return m_mesh;
+}
+
+const VoxelMesher::Stats& VoxelChunk::meshStats() const
+{
+    return m_meshStats;
+}
+
+AABB VoxelChunk::localBounds() const
+{
+    // The whole chunk until there is a mesh, nothing is drawn then anyway
+    return m_mesh != nullptr ? m_mesh->getBounds() : AABB{ .min = glm::vec3(-0.5f), .max = glm::vec3(SIZE - 0.5f) };
+}
+
+void VoxelChunk::update(float)
+{
+    // Edits made while a job runs wait for it, at most one job per chunk is in flight
+    if (m_job == nullptr && m_dirty)
+    {
+        startMeshing();
+    }
+
+    if (m_job != nullptr && JobSystem::isDone(m_job->counter))
+    {
+        finishMeshing();
+    }
+}
+
+void VoxelChunk::render()
+{
+    if (m_mesh == nullptr)
+    {
+        return;
+    }
+
+    RenderQueue::submit({
+        .shaderProgram = m_material->shaderProgram(),
+        .texture = m_material->textureId(),
+        .mesh = m_mesh.get(),
+        .model = gameObject().transform().worldMatrix(),
+        .textureArray = true,
+        .textureLayer = 0
+    });
+}
+
+VoxelChunk::Side VoxelChunk::opposite(Side side)
+{
+    return static_cast<Side>(static_cast<uint8_t>(side) ^ 1);
+}
+
+void VoxelChunk::markDirty()
+{
+    m_dirty = true;
+}
+
+void VoxelChunk::startMeshing()
+{
+    PROFILE_ZONE("VoxelChunk::startMeshing");
+
+    m_job = std::make_shared<MeshJob>();
+    m_job->blocks.fill(VoxelMesher::AIR);
+    for (int32_t z = 0; z < SIZE; z++)
+    {
+        for (int32_t y = 0; y < SIZE; y++)
+        {
+            const auto row = m_blocks.begin() + VoxelMesher::blockIndex(0, y, z);
+            std::copy(row, row + SIZE, m_job->blocks.begin() + VoxelMesher::paddedIndex(0, y, z));
+        }
+    }
+
+    // The mesher only looks across faces, so the border needs the facing layer of each neighbour but no edges or corners
+    for (std::size_t sideIndex = 0; sideIndex < m_neighbours.size(); sideIndex++)
+    {
+        const std::shared_ptr<VoxelChunk> neighbour = m_neighbours[sideIndex].lock();
+        if (neighbour == nullptr)
+        {
+            continue;
+        }
+
+        const int32_t axis = static_cast<int32_t>(sideIndex / 2);
+        const bool positive = sideIndex % 2 == 1;
+        for (int32_t j = 0; j < SIZE; j++)
+        {
+            for (int32_t i = 0; i < SIZE; i++)
+            {
+                glm::ivec3 border{};
+                border[axis] = positive ? SIZE : -1;
+                border[(axis + 1) % 3] = i;
+                border[(axis + 2) % 3] = j;
+                glm::ivec3 source = border;
+                source[axis] = positive ? 0 : SIZE - 1;
+                m_job->blocks[VoxelMesher::paddedIndex(border.x, border.y, border.z)] = neighbour->getBlock(source);
+            }
+        }
+    }
+
+    m_dirty = false;
+
+    JobSystem::Job meshJob = [job = m_job, palette = m_palette]()
+    {
+        job->result = VoxelMesher::mesh(job->blocks, *palette);
+    };
+
+    // Background, so a parallelFor waiting on the main thread never picks up a whole chunk inline
+    JobSystem::submitBackground(std::move(meshJob), &m_job->counter);
+}
+
+void VoxelChunk::finishMeshing()
+{
+    PROFILE_ZONE("VoxelChunk::finishMeshing");
+
+    // Released first so a job that threw is not picked up again next frame, wait() returns at once and rethrows
+    const std::shared_ptr<MeshJob> job = std::move(m_job);
+    JobSystem::wait(job->counter);
+
+    VoxelMesher::Result& result = job->result;
+    m_meshStats = result.stats;
+    if (result.vertices.empty())
+    {
+        m_mesh.reset();
+    }
+    else
+    {
+        const std::span<const std::byte> vertexData = std::as_bytes(std::span(result.vertices));
+        m_mesh = std::make_shared<Mesh>(std::vector<std::byte>(vertexData.begin(), vertexData.end()), static_cast<uint32_t>(sizeof(VoxelMesher::Vertex)), VoxelMesher::vertexLayout(), std::move(result.triangles), result.bounds);
+    }
+    markBoundsDirty();
+}
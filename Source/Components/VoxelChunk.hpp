@@ -0,0 +1,83 @@
+#pragma once
+
+#include "SceneGraph.hpp"
+#include "JobSystem.hpp"
+#include "Mesh.hpp"
+#include "VoxelMesher.hpp"
+
+#include <array>
+#include <memory>
+
+// CHUNK_SIZE³ blocks drawn as one mesh.
+// Editing a block only marks the chunk dirty, update() then snapshots the blocks and the border of its neighbours
+// and remeshes on a JobSystem worker. The previous mesh keeps drawing until the new one is uploaded.
+class VoxelChunk : public RenderComponent
+{
+public:
+    using BlockId = VoxelMesher::BlockId;
+
+    static constexpr int32_t SIZE = VoxelMesher::CHUNK_SIZE;
+
+    enum class Side : uint8_t
+    {
+        NEGATIVE_X,
+        POSITIVE_X,
+        NEGATIVE_Y,
+        POSITIVE_Y,
+        NEGATIVE_Z,
+        POSITIVE_Z
+    };
+
+public:
+    VoxelChunk(const std::shared_ptr<Entity>& parent, std::shared_ptr<const VoxelPalette> palette);
+    ~VoxelChunk() override;
+
+    // Coordinates outside [0, SIZE) read as air
+    BlockId getBlock(const glm::ivec3& position) const;
+    // Blocks on the border also dirty the neighbour on that side, its faces towards this chunk may change
+    void setBlock(const glm::ivec3& position, BlockId block);
+    // Fills the box [min, max] clamped to the chunk
+    void fill(const glm::ivec3& min, const glm::ivec3& max, BlockId block);
+
+    // Links both chunks, which culls the faces between them. neighbour lies on side of this chunk.
+    // The chunks previously linked on that side of either chunk are unlinked and remeshed, null only unlinks.
+    void setNeighbour(Side side, const std::shared_ptr<VoxelChunk>& neighbour);
+
+    bool isDirty() const;
+    bool isMeshing() const;
+    // Null until the first mesh is done and while the chunk is empty
+    const std::shared_ptr<const Mesh>& getMesh() const;
+    const VoxelMesher::Stats& meshStats() const;
+
+    AABB localBounds() const override;
+    // Picks up finished meshes and starts remeshing dirty chunks, creates GPU buffers so it runs on the render thread
+    void update(float deltaTime) override;
+    void render() override;
+
+private:
+    // Shared with the meshing job, which may outlive the chunk
+    struct MeshJob
+    {
+        std::array<BlockId, VoxelMesher::PADDED_BLOCK_COUNT> blocks;
+        VoxelMesher::Result result;
+        JobSystem::Counter counter { 0 };
+    };
+
+    static Side opposite(Side side);
+    void markDirty();
+    // Clears the link on side and the link back from the chunk there
+    void unlinkNeighbour(Side side);
+    void startMeshing();
+    void finishMeshing();
+
+private:
+    std::shared_ptr<const VoxelPalette> m_palette;
+    std::shared_ptr<class Material> m_material;
+    std::array<BlockId, VoxelMesher::CHUNK_BLOCK_COUNT> m_blocks {};
+    std::array<std::weak_ptr<VoxelChunk>, 6> m_neighbours {};
+    bool m_dirty { true };
+
+    std::shared_ptr<MeshJob> m_job;
+    std::shared_ptr<const Mesh> m_mesh;
+    VoxelMesher::Stats m_meshStats {};
+};
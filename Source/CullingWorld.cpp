@@ -0,0 +1,97 @@
+#include "CullingWorld.hpp"
+#include "Profiler.hpp"
+#include "SceneGraph.hpp"
+
+#include <utility>
+
+void CullingWorld::add(RenderComponent& component)
+{
+    component.m_cullingIndex = static_cast<uint32_t>(m_components.size());
+    component.m_proxy = BoundingVolumeHierarchy::INVALID_PROXY;
+    m_components.emplace_back(&component);
+}
+
+void CullingWorld::remove(RenderComponent& component)
+{
+    const uint32_t index = component.m_cullingIndex;
+    if (component.m_proxy != BoundingVolumeHierarchy::INVALID_PROXY)
+    {
+        m_tree.destroy(component.m_proxy);
+    }
+
+    // Swap the last component into the hole and point its proxy at the new slot
+    RenderComponent* last = m_components.back();
+    m_components[index] = last;
+    last->m_cullingIndex = index;
+    if (last->m_proxy != BoundingVolumeHierarchy::INVALID_PROXY)
+    {
+        m_tree.setUserData(last->m_proxy, index);
+    }
+
+    m_components.pop_back();
+    component.m_proxy = BoundingVolumeHierarchy::INVALID_PROXY;
+}
+
+void CullingWorld::refit(const TransformStorage& transforms)
+{
+    PROFILE_ZONE("CullingWorld::refit");
+
+    m_stats.refitted = 0;
+    for (RenderComponent* component : m_components)
+    {
+        const TransformStorage::Handle handle = component->gameObject().transformHandle();
+        const bool boundsDirty = std::exchange(component->m_boundsDirty, false);
+        if (component->m_proxy == BoundingVolumeHierarchy::INVALID_PROXY)
+        {
+            component->m_proxy = m_tree.create(component->localBounds().transformed(transforms.getWorldMatrix(handle)), component->m_cullingIndex);
+            continue;
+        }
+
+        if ((boundsDirty || transforms.hasWorldChanged(handle)) && m_tree.move(component->m_proxy, component->localBounds().transformed(transforms.getWorldMatrix(handle))))
+        {
+            m_stats.refitted++;
+        }
+    }
+}
+
+void CullingWorld::render(const std::optional<Frustum>& frustum)
+{
+    if (!frustum.has_value())
+    {
+        for (RenderComponent* component : m_components)
+        {
+            component->render();
+        }
+
+        m_stats.visible = static_cast<uint32_t>(m_components.size());
+        m_stats.culled = 0;
+        m_stats.nodesTested = 0;
+        return;
+    }
+
+    m_visible.clear();
+    const BoundingVolumeHierarchy::CullStats cullStats = m_tree.cull(*frustum, m_visible);
+    m_stats.visible = cullStats.visible;
+    m_stats.culled = cullStats.culled;
+    m_stats.nodesTested = cullStats.nodesTested;
+
+    for (uint32_t index : m_visible)
+    {
+        m_components[index]->render();
+    }
+}
+
+const CullingWorld::Stats& CullingWorld::stats() const
+{
+    return m_stats;
+}
+
+std::size_t CullingWorld::size() const
+{
+    return m_components.size();
+}
+
+const BoundingVolumeHierarchy& CullingWorld::tree() const
+{
+    return m_tree;
+}
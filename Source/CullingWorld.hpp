@@ -0,0 +1,43 @@
+#pragma once
+
+#include "BoundingVolumeHierarchy.hpp"
+#include "TransformStorage.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+class RenderComponent;
+
+// Render components of one Scene and a BVH over their world bounds.
+// Components get a proxy on the first refit after they are added, after that only components whose world matrix
+// changed in the last TransformStorage::updateWorldMatrices or that marked their bounds dirty move their proxy.
+class CullingWorld
+{
+public:
+    struct Stats
+    {
+        uint32_t visible;
+        uint32_t culled;
+        uint32_t nodesTested;
+        uint32_t refitted;
+    };
+
+public:
+    void add(RenderComponent& component);
+    void remove(RenderComponent& component);
+
+    void refit(const TransformStorage& transforms);
+    // Calls render() on every component not outside frustum, or on all of them without a frustum
+    void render(const std::optional<Frustum>& frustum);
+
+    const Stats& stats() const;
+    std::size_t size() const;
+    const BoundingVolumeHierarchy& tree() const;
+
+private:
+    BoundingVolumeHierarchy m_tree;
+    std::vector<RenderComponent*> m_components;
+    std::vector<uint32_t> m_visible;
+    Stats m_stats{};
+};
@@ -2,6 +2,11 @@
 #include "Assertion.hpp"
 #include "fmt/format.h"
 #include "RuntimeException.hpp"
+#include "Profiler.hpp"
+#include "RenderQueue.hpp"
+#include "ResourceManager.hpp"
+#include "ShaderCache.hpp"
+#include "TextureLoader.hpp"
 
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
@@ -9,6 +14,12 @@
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <numeric>
+#include <thread>
+
 void glfwErrorCallback(int errorCode, const char* errorMessage)
 {
     throw korelib::RuntimeException(fmt::format("[glfw] error: Message:\"{}\". ErrorCode:{}", errorMessage, errorCode));
@@ -66,8 +77,21 @@ glm::mat4 Gfx::Transform::model() const
     return (glm::translate(position) * glm::toMat4(rotation) * glm::scale(scale));
 }
 
-void Gfx::initialize(uint32_t width, uint32_t height, const std::string& title, WindowFlags flags)
+void Gfx::initialize(uint32_t width, uint32_t height, const std::string& title, WindowFlags flags, Backend backend)
 {
+    Profiler::setThreadName("Main");
+
+    g_backend = backend;
+    if (isHeadless())
+    {
+        g_headlessWindowSize = { width, height };
+        g_defaultShader = linkShaderProgram(compileShader(insertShaderDefines(DEFAULT_VERTEX_SHADER, { &INSTANCING_DEFINE, 1 }), ShaderKind::VERTEX), compileShader(insertShaderDefines(DEFAULT_FRAGMENT_SHADER, { &INSTANCING_DEFINE, 1 }), ShaderKind::FRAGMENT));
+        g_instanceBufferObject = createVertexBufferObject();
+        g_cameraUniformBufferObject = createVertexBufferObject();
+        g_environmentUniformBufferObject = createVertexBufferObject();
+        return;
+    }
+
     KORELIB_VERIFY_THROW(glfwInit() == GLFW_TRUE, korelib::RuntimeException, "Failed to initialize glfw");
 
     glfwSetErrorCallback(glfwErrorCallback);
@@ -80,6 +104,7 @@ void Gfx::initialize(uint32_t width, uint32_t height, const std::string& title,
     KORELIB_VERIFY_THROW(g_window != nullptr, korelib::RuntimeException, "[glfw] error: failed to initialize window");
 
     glfwMakeContextCurrent(g_window);
+    applySwapInterval();
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -94,28 +119,77 @@ void Gfx::initialize(uint32_t width, uint32_t height, const std::string& title,
 
     KORELIB_VERIFY_THROW(gladLoadGLLoader((GLADloadproc)glfwGetProcAddress), korelib::RuntimeException, "Failed to initialize glad");
 
+    // Lets the driver compile and link on its own threads, ShaderCache polls for completion instead of blocking
+    g_parallelShaderCompile = GLAD_GL_KHR_parallel_shader_compile != 0;
+    if (g_parallelShaderCompile)
+    {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+
     glViewport(0, 0, width, height);
     glfwSetFramebufferSizeCallback(g_window, glfwWindowResizeCallback);
 
     glFrontFace(GL_CCW);
     glEnable(GL_CULL_FACE);
 
-    ShaderType defaultVertexShader = compileShader(DEFAULT_VERTEX_SHADER, ShaderKind::VERTEX);
-    ShaderType defaultFragmentShader = compileShader(DEFAULT_FRAGMENT_SHADER, ShaderKind::FRAGMENT);
+    ShaderType defaultVertexShader = compileShader(insertShaderDefines(DEFAULT_VERTEX_SHADER, { &INSTANCING_DEFINE, 1 }), ShaderKind::VERTEX);
+    ShaderType defaultFragmentShader = compileShader(insertShaderDefines(DEFAULT_FRAGMENT_SHADER, { &INSTANCING_DEFINE, 1 }), ShaderKind::FRAGMENT);
 
     g_defaultShader = linkShaderProgram(defaultVertexShader, defaultFragmentShader);
     
     destroyShader(defaultVertexShader);
     destroyShader(defaultFragmentShader);
+
+    g_instanceBufferObject = createVertexBufferObject();
+
+    g_cameraUniformBufferObject = createVertexBufferObject();
+    glBindBuffer(GL_UNIFORM_BUFFER, g_cameraUniformBufferObject);
+    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BLOCK_BINDING, g_cameraUniformBufferObject);
+
+    g_environmentUniformBufferObject = createVertexBufferObject();
+    glBindBuffer(GL_UNIFORM_BUFFER, g_environmentUniformBufferObject);
+    glBufferData(GL_UNIFORM_BUFFER, 5 * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, ENVIRONMENT_UNIFORM_BLOCK_BINDING, g_environmentUniformBufferObject);
+    setEnvironment(g_environment);
 }
 
 void Gfx::beginFrame()
 {
-    float currentTime = glfwGetTime();
-    g_deltaTime = currentTime - g_lastFrameTime;
+    Profiler::beginFrame();
+    PROFILE_ZONE("Gfx::beginFrame");
+    resolveGpuTimers();
+
+    // Absolute times stay in double, a float of the steady clock epoch is only good to milliseconds
+    const double currentTime = isHeadless() ? std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count() : glfwGetTime();
+    // The first frame has nothing to measure against, the steady clock epoch would make it last since boot
+    const double frameTime = g_frameIndex > 0 ? currentTime - g_lastFrameTime : 0.0;
+    g_deltaTime = static_cast<float>(frameTime);
     g_lastFrameTime = currentTime;
+    if (g_frameIndex > 0)
+    {
+        recordFrameTime(frameTime * 1000.0);
+    }
+
+    g_frameStats = {};
+    g_recordedCommands.clear();
+
+    {
+        const GpuPass gpuPass { "TextureLoader::processUploads" };
+        TextureLoader::processUploads();
+    }
+    ResourceManager::collect();
+    ShaderCache::update();
+    {
+        PROFILE_ZONE("Gfx::clearBackground");
+        const GpuPass gpuPass { "Gfx::clearBackground" };
+        clearBackground();
+    }
 
-    clearBackground();
+    if (isHeadless())
+    {
+        return;
+    }
 
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -138,11 +212,21 @@ float Gfx::deltaTime()
 
 bool Gfx::windowShouldClose()
 {
+    if (isHeadless())
+    {
+        return false;
+    }
+
     return glfwWindowShouldClose(g_window);
 }
 
 glm::uvec2 Gfx::getWindowSize()
 {
+    if (isHeadless())
+    {
+        return g_headlessWindowSize;
+    }
+
     int w{};
     int h{};
     glfwGetWindowSize(Gfx::g_window, &w, &h);
@@ -153,12 +237,22 @@ glm::uvec2 Gfx::getWindowSize()
 glm::ivec2 Gfx::getWindowPosition()
 {
     glm::ivec2 windowPos{};
+    if (isHeadless())
+    {
+        return windowPos;
+    }
+
     glfwGetWindowPos(g_window, &windowPos.x, &windowPos.y);
     return windowPos;
 }
 
 std::vector<Gfx::MonitorType> Gfx::getMonitors()
 {
+    if (isHeadless())
+    {
+        return {};
+    }
+
     int monitorsCount{};
     Gfx::MonitorType* nativeMonitors = glfwGetMonitors(&monitorsCount);
 
@@ -175,6 +269,11 @@ std::vector<Gfx::MonitorType> Gfx::getMonitors()
 glm::ivec2 Gfx::getMonitorOffset(MonitorType monitor)
 {
     glm::ivec2 monitorOffset{};
+    if (isHeadless())
+    {
+        return monitorOffset;
+    }
+
     glfwGetMonitorPos(monitor, &monitorOffset.x, &monitorOffset.y);
 
     return monitorOffset;
@@ -182,26 +281,54 @@ glm::ivec2 Gfx::getMonitorOffset(MonitorType monitor)
 
 Gfx::VideoModeType Gfx::getVideoModeForMonitor(MonitorType monitor)
 {
+    if (isHeadless())
+    {
+        return nullptr;
+    }
+
     return glfwGetVideoMode(monitor);
 }
 
 void Gfx::setClearColor(float r, float g, float b, float a)
 {
+    g_frameStats.stateChanges++;
+    if (isHeadless())
+    {
+        return;
+    }
+
     glClearColor(r, g, b, a);
 }
 
 void Gfx::clearBackground()
 {
+    if (isHeadless())
+    {
+        record(Command::Kind::CLEAR, 0, 0);
+        return;
+    }
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);;
 }
 
 void Gfx::swap()
 {
+    if (isHeadless())
+    {
+        record(Command::Kind::SWAP, 0, 0);
+        return;
+    }
+
     glfwSwapBuffers(g_window);
 }
 
 Gfx::VertexBufferObjectType Gfx::createVertexBufferObject()
 {
+    if (isHeadless())
+    {
+        return createHeadlessObject();
+    }
+
     Gfx::VertexBufferObjectType vertexBufferObject{};
     glGenBuffers(1, &vertexBufferObject);
 
@@ -210,14 +337,50 @@ Gfx::VertexBufferObjectType Gfx::createVertexBufferObject()
 
 Gfx::VertexArrayObjectType Gfx::createVertexArrayObject()
 {
+    if (isHeadless())
+    {
+        return createHeadlessObject();
+    }
+
     Gfx::VertexArrayObjectType vertexArrayObject{};
     glGenVertexArrays(1, &vertexArrayObject);
 
     return vertexArrayObject;
 }
 
+Gfx::ElementBufferObjectType Gfx::createElementBufferObject()
+{
+    return createVertexBufferObject();
+}
+
+void Gfx::destroyBufferObject(uint32_t bufferObject)
+{
+    // Objects that outlive the context were released together with it
+    if (isHeadless() || g_window == nullptr)
+    {
+        return;
+    }
+
+    glDeleteBuffers(1, &bufferObject);
+}
+
+void Gfx::destroyVertexArrayObject(VertexArrayObjectType vertexArrayObject)
+{
+    if (isHeadless() || g_window == nullptr)
+    {
+        return;
+    }
+
+    glDeleteVertexArrays(1, &vertexArrayObject);
+}
+
 Gfx::ShaderType Gfx::compileShader(const std::string& source, ShaderKind kind)
 {
+    if (isHeadless())
+    {
+        return createHeadlessObject();
+    }
+
     Gfx::ShaderType shader {0};
     switch (kind)
     {
@@ -250,6 +413,11 @@ Gfx::ShaderType Gfx::compileShader(const std::string& source, ShaderKind kind)
 
 Gfx::ShaderType Gfx::linkShaderProgram(ShaderType vertexShader, ShaderType fragmentShader)
 {
+    if (isHeadless())
+    {
+        return createHeadlessObject();
+    }
+
     Gfx::ShaderType shaderProgram;
     shaderProgram = glCreateProgram();
 
@@ -259,58 +427,426 @@ Gfx::ShaderType Gfx::linkShaderProgram(ShaderType vertexShader, ShaderType fragm
 
     int  success;
     char info[512];
-    glGetShaderiv(shaderProgram, GL_LINK_STATUS, &success);
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
     if(!success)
     {
-        glGetShaderInfoLog(shaderProgram, 512, NULL, info);
+        glGetProgramInfoLog(shaderProgram, 512, NULL, info);
         KORELIB_VERIFY_THROW(success, korelib::RuntimeException, fmt::format("Failed to link shader: {}", info));
     }
 
+    reflectUniforms(shaderProgram);
+
     return shaderProgram;
 }
 
-void Gfx::setShaderUniformBoolValue(ShaderType shaderProgram, const std::string& name, bool value)
+void Gfx::reflectUniforms(ShaderType shaderProgram)
+{
+    UniformTable& uniforms = g_uniformTables[shaderProgram];
+    uniforms.clear();
+
+    int32_t uniformCount{};
+    int32_t maxNameLength{};
+    glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::string name(static_cast<size_t>(maxNameLength), '\0');
+    for (int32_t uniformIndex = 0; uniformIndex < uniformCount; uniformIndex++)
+    {
+        GLsizei nameLength{};
+        GLint size{};
+        GLenum type{};
+        glGetActiveUniform(shaderProgram, uniformIndex, maxNameLength, &nameLength, &size, &type, name.data());
+
+        // Members of uniform blocks have no location and are written through their buffer instead
+        const std::string uniformName = name.substr(0, nameLength);
+        const UniformLocationType location = glGetUniformLocation(shaderProgram, uniformName.c_str());
+        if (location < 0)
+        {
+            continue;
+        }
+
+        uniforms.emplace(uniformName, location);
+        if (uniformName.ends_with("[0]"))
+        {
+            uniforms.emplace(uniformName.substr(0, uniformName.size() - 3), location);
+        }
+    }
+}
+
+Gfx::UniformLocationType Gfx::getUniformLocation(ShaderType shaderProgram, std::string_view name)
+{
+    auto programIt = g_uniformTables.find(shaderProgram);
+    if (programIt == g_uniformTables.end())
+    {
+        return -1;
+    }
+
+    auto uniformIt = programIt->second.find(name);
+    return uniformIt != programIt->second.end() ? uniformIt->second : -1;
+}
+
+void Gfx::setShaderUniformBoolValue(ShaderType shaderProgram, std::string_view name, bool value)
+{
+    setShaderUniformBoolValue(shaderProgram, getUniformLocation(shaderProgram, name), value);
+}
+
+void Gfx::setShaderUniformBoolValue(ShaderType shaderProgram, UniformLocationType location, bool value)
+{
+    g_frameStats.uniformWrites++;
+    if (isHeadless())
+    {
+        record(Command::Kind::SET_UNIFORM, shaderProgram, sizeof(int32_t));
+        return;
+    }
+
+    glUniform1i(location, static_cast<uint32_t>(value));
+}
+
+void Gfx::setShaderUniformIntValue(ShaderType shaderProgram, std::string_view name, int32_t value)
+{
+    setShaderUniformIntValue(shaderProgram, getUniformLocation(shaderProgram, name), value);
+}
+
+void Gfx::setShaderUniformIntValue(ShaderType shaderProgram, UniformLocationType location, int32_t value)
+{
+    g_frameStats.uniformWrites++;
+    if (isHeadless())
+    {
+        record(Command::Kind::SET_UNIFORM, shaderProgram, sizeof(int32_t));
+        return;
+    }
+
+    glUniform1i(location, value);
+}
+
+void Gfx::setShaderUniformIntValue(ShaderType shaderProgram, std::string_view name, float value)
+{
+    setShaderUniformIntValue(shaderProgram, getUniformLocation(shaderProgram, name), value);
+}
+
+void Gfx::setShaderUniformIntValue(ShaderType shaderProgram, UniformLocationType location, float value)
+{
+    g_frameStats.uniformWrites++;
+    if (isHeadless())
+    {
+        record(Command::Kind::SET_UNIFORM, shaderProgram, sizeof(float));
+        return;
+    }
+
+    glUniform1f(location, value);
+}
+
+void Gfx::setShaderMat4x4Value(ShaderType shaderProgram, std::string_view name, const glm::mat4& value)
 {
-    glUniform1i(glGetUniformLocation(shaderProgram, name.c_str()), static_cast<uint32_t>(value));
+    setShaderMat4x4Value(shaderProgram, getUniformLocation(shaderProgram, name), value);
 }
 
-void Gfx::setShaderUniformIntValue(ShaderType shaderProgram, const std::string& name, int32_t value)
+void Gfx::setShaderMat4x4Value(ShaderType shaderProgram, UniformLocationType location, const glm::mat4& value)
 {
-    glUniform1i(glGetUniformLocation(shaderProgram, name.c_str()), value);
+    g_frameStats.uniformWrites++;
+    if (isHeadless())
+    {
+        record(Command::Kind::SET_UNIFORM, shaderProgram, sizeof(glm::mat4));
+        return;
+    }
+
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
 }
 
-void Gfx::setShaderUniformIntValue(ShaderType shaderProgram, const std::string& name, float value)
+void Gfx::updateCameraData(const glm::mat4& view, const glm::mat4& projection)
 {
-    glUniform1f(glGetUniformLocation(shaderProgram, name.c_str()), value);
+    const std::array<glm::mat4, 2> cameraData { view, projection };
+
+    g_frameStats.uploadedBytes += sizeof(cameraData);
+    if (isHeadless())
+    {
+        record(Command::Kind::UPLOAD_UNIFORM_BUFFER, g_cameraUniformBufferObject, sizeof(cameraData));
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, g_cameraUniformBufferObject);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(cameraData), cameraData.data());
+}
+
+void Gfx::setEnvironment(const Environment& environment)
+{
+    g_environment = environment;
+
+    // std140 layout of EnvironmentData
+    const std::array<glm::vec4, 5> environmentData {
+        glm::vec4(glm::length(environment.lightDirection) > 0.0f ? glm::normalize(environment.lightDirection) : glm::vec3(0.0f, -1.0f, 0.0f), 0.0f),
+        glm::vec4(environment.lightColor, 1.0f),
+        glm::vec4(environment.ambientColor, 1.0f),
+        glm::vec4(environment.fogColor, 1.0f),
+        glm::vec4(environment.fogStart, std::max(environment.fogEnd, environment.fogStart + 0.001f), 0.0f, 0.0f)
+    };
+
+    g_frameStats.uploadedBytes += sizeof(environmentData);
+    if (isHeadless())
+    {
+        record(Command::Kind::UPLOAD_UNIFORM_BUFFER, g_environmentUniformBufferObject, sizeof(environmentData));
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, g_environmentUniformBufferObject);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(environmentData), environmentData.data());
 }
 
-void Gfx::setShaderMat4x4Value(ShaderType shaderProgram, const std::string& name, const glm::mat4& value)
+const Gfx::Environment& Gfx::environment()
 {
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+    return g_environment;
 }
 
 void Gfx::setShaderProgram(Gfx::ShaderType program)
 {
+    g_frameStats.stateChanges++;
+    if (isHeadless())
+    {
+        record(Command::Kind::SET_SHADER_PROGRAM, program, 0);
+        return;
+    }
+
     glUseProgram(program);
 }
 
 void Gfx::destroyShader(Gfx::ShaderType shader)
 {
+    if (isHeadless())
+    {
+        return;
+    }
+
     glDeleteShader(shader);
 }
 
+Gfx::ShaderType Gfx::beginShaderProgram(const std::string& vertexSource, const std::string& fragmentSource)
+{
+    if (isHeadless())
+    {
+        return createHeadlessObject();
+    }
+
+    const ShaderType shaderProgram = glCreateProgram();
+    const std::array<std::pair<GLenum, const std::string*>, 2> stages { std::pair{ GL_VERTEX_SHADER, &vertexSource }, std::pair{ GL_FRAGMENT_SHADER, &fragmentSource } };
+    for (const auto& [stage, source] : stages)
+    {
+        const ShaderType shader = glCreateShader(stage);
+        const char* sourcePtr = source->data();
+        glShaderSource(shader, 1, &sourcePtr, nullptr);
+        glCompileShader(shader);
+        glAttachShader(shaderProgram, shader);
+        // Only flagged while attached, finishShaderProgram still reads its log and detaching releases it
+        glDeleteShader(shader);
+    }
+
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(shaderProgram);
+
+    return shaderProgram;
+}
+
+bool Gfx::isShaderProgramCompleted(ShaderType shaderProgram)
+{
+    if (isHeadless() || !g_parallelShaderCompile)
+    {
+        return true;
+    }
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(shaderProgram, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+void Gfx::finishShaderProgram(ShaderType shaderProgram)
+{
+    if (isHeadless())
+    {
+        return;
+    }
+
+    std::array<GLuint, 2> shaders{};
+    GLsizei shaderCount{};
+    glGetAttachedShaders(shaderProgram, static_cast<GLsizei>(shaders.size()), &shaderCount, shaders.data());
+
+    std::string errors{};
+    char info[512];
+    for (GLsizei shaderIndex = 0; shaderIndex < shaderCount; shaderIndex++)
+    {
+        int success;
+        glGetShaderiv(shaders[shaderIndex], GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(shaders[shaderIndex], 512, NULL, info);
+            errors += fmt::format("Failed to compile shader: {}", info);
+        }
+        glDetachShader(shaderProgram, shaders[shaderIndex]);
+    }
+
+    int success;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(shaderProgram, 512, NULL, info);
+        errors += fmt::format("Failed to link shader: {}", info);
+    }
+
+    KORELIB_VERIFY_THROW(errors.empty(), korelib::RuntimeException, errors);
+    reflectUniforms(shaderProgram);
+}
+
+Gfx::ShaderProgramBinary Gfx::getShaderProgramBinary(ShaderType shaderProgram)
+{
+    ShaderProgramBinary binary{ .format = 0, .data = {} };
+    if (isHeadless())
+    {
+        return binary;
+    }
+
+    GLint formatCount{};
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    GLint length{};
+    glGetProgramiv(shaderProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (formatCount == 0 || length <= 0)
+    {
+        return binary;
+    }
+
+    GLenum format{};
+    binary.data.resize(static_cast<size_t>(length));
+    glGetProgramBinary(shaderProgram, length, &length, &format, binary.data.data());
+    binary.data.resize(static_cast<size_t>(length));
+    binary.format = format;
+
+    return binary;
+}
+
+Gfx::ShaderType Gfx::shaderProgramFromBinary(uint32_t format, std::span<const std::byte> data)
+{
+    if (isHeadless())
+    {
+        return 0;
+    }
+
+    const ShaderType shaderProgram = glCreateProgram();
+    glProgramBinary(shaderProgram, format, data.data(), static_cast<GLsizei>(data.size()));
+
+    int success;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(shaderProgram);
+        return 0;
+    }
+
+    reflectUniforms(shaderProgram);
+    return shaderProgram;
+}
+
+void Gfx::destroyShaderProgram(ShaderType shaderProgram)
+{
+    g_uniformTables.erase(shaderProgram);
+    if (isHeadless() || g_window == nullptr)
+    {
+        return;
+    }
+
+    glDeleteProgram(shaderProgram);
+}
+
+std::string Gfx::insertShaderDefines(std::string_view source, std::span<const std::string_view> defines)
+{
+    if (defines.empty())
+    {
+        return std::string(source);
+    }
+
+    // #version has to stay the first directive, everything else may follow the defines
+    size_t insertAt = 0;
+    if (const size_t version = source.find("#version"); version != std::string_view::npos)
+    {
+        const size_t lineEnd = source.find('\n', version);
+        insertAt = lineEnd != std::string_view::npos ? lineEnd + 1 : source.size();
+    }
+
+    std::string result(source.substr(0, insertAt));
+    if (!result.empty() && result.back() != '\n')
+    {
+        result += '\n';
+    }
+    for (std::string_view define : defines)
+    {
+        result += fmt::format("#define {}\n", define);
+    }
+    result += source.substr(insertAt);
+
+    return result;
+}
+
+std::string Gfx::driverIdentity()
+{
+    if (isHeadless())
+    {
+        return {};
+    }
+
+    const auto string = [](GLenum name) {
+        const GLubyte* value = glGetString(name);
+        return value != nullptr ? reinterpret_cast<const char*>(value) : "";
+    };
+
+    return fmt::format("{}|{}|{}", string(GL_VENDOR), string(GL_RENDERER), string(GL_VERSION));
+}
+
 void Gfx::updateVertexBufferData(VertexBufferObjectType vertexBufferObject, const std::vector<Vertex> &vertices)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(std::vector<Vertex>::value_type) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    updateVertexBufferData(vertexBufferObject, std::as_bytes(std::span(vertices)));
 }
 
-void Gfx::drawIndexedGeometry(const Gfx::Transform& transform, const std::vector<std::array<uint32_t, 3>>& triangles, ShaderType shaderProgram, VertexBufferObjectType vertexBufferObject, VertexArrayObjectType vertexArrayObject, const std::vector<Attribute>& attributesDataOffsets)
+void Gfx::updateVertexBufferData(VertexBufferObjectType vertexBufferObject, std::span<const std::byte> vertexData)
 {
-    Gfx::setShaderMat4x4Value(Gfx::defaultShaderProgram(), "model", transform.model());
+    const uint64_t size = vertexData.size();
+    g_frameStats.uploadedBytes += size;
+    if (isHeadless())
+    {
+        record(Command::Kind::UPLOAD_VERTEX_BUFFER, vertexBufferObject, size);
+        return;
+    }
 
     glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(size), vertexData.data(), GL_STATIC_DRAW);
+}
+
+void Gfx::updateElementBufferData(VertexArrayObjectType vertexArrayObject, ElementBufferObjectType elementBufferObject, const std::vector<std::array<uint32_t, 3>>& triangles)
+{
+    const uint64_t size = sizeof(std::array<uint32_t, 3>) * triangles.size();
+    g_frameStats.uploadedBytes += size;
+    if (isHeadless())
+    {
+        record(Command::Kind::UPLOAD_ELEMENT_BUFFER, elementBufferObject, size);
+        return;
+    }
+
+    // GL_ELEMENT_ARRAY_BUFFER binding is part of the vertex array state
+    glBindVertexArray(vertexArrayObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferObject);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, triangles.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+}
+
+void Gfx::setupVertexArray(VertexArrayObjectType vertexArrayObject, VertexBufferObjectType vertexBufferObject, ElementBufferObjectType elementBufferObject, std::span<const Attribute> attributesDataOffsets)
+{
+    if (isHeadless())
+    {
+        for (auto&& attributePointer : attributesDataOffsets)
+        {
+            record(Command::Kind::SET_VERTEX_ATTRIBUTE, attributePointer.index, attributePointer.stride);
+        }
+        return;
+    }
+
     glBindVertexArray(vertexArrayObject);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferObject);
     for (auto&& attributePointer : attributesDataOffsets)
     {
         GLenum attributeType {};
@@ -344,32 +880,238 @@ void Gfx::drawIndexedGeometry(const Gfx::Transform& transform, const std::vector
         glVertexAttribPointer(attributePointer.index, attributePointer.numComponents, attributeType, attributePointer.aligned, attributePointer.stride, (void*)attributePointer.offset);
         glEnableVertexAttribArray(attributePointer.index);
     }
-    glDrawElements(GL_TRIANGLES, triangles.size() * 3, GL_UNSIGNED_INT, triangles.data());
+
+    // The model matrix is fed as four vec4 columns from the shared instance buffer, draws pick their range with a base instance
+    glBindBuffer(GL_ARRAY_BUFFER, g_instanceBufferObject);
+    for (uint32_t column = 0; column < 4; column++)
+    {
+        const uint32_t index = INSTANCE_MODEL_ATTRIBUTE_INDEX + column;
+        glVertexAttribPointer(index, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(index, 1);
+        glEnableVertexAttribArray(index);
+    }
+
+    glVertexAttribPointer(INSTANCE_PARAMETERS_ATTRIBUTE_INDEX, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, parameters));
+    glVertexAttribDivisor(INSTANCE_PARAMETERS_ATTRIBUTE_INDEX, 1);
+    glEnableVertexAttribArray(INSTANCE_PARAMETERS_ATTRIBUTE_INDEX);
+
+    glBindVertexArray(0);
+}
+
+void Gfx::bindVertexArray(VertexArrayObjectType vertexArrayObject)
+{
+    g_frameStats.stateChanges++;
+    if (isHeadless())
+    {
+        record(Command::Kind::BIND_VERTEX_ARRAY, vertexArrayObject, 0);
+        return;
+    }
+
+    glBindVertexArray(vertexArrayObject);
+}
+
+void Gfx::updateInstanceBufferData(const std::vector<InstanceData>& instances)
+{
+    const uint64_t size = sizeof(InstanceData) * instances.size();
+    g_frameStats.uploadedBytes += size;
+    if (isHeadless())
+    {
+        record(Command::Kind::UPLOAD_VERTEX_BUFFER, g_instanceBufferObject, size);
+        return;
+    }
+
+    // Respecifying the storage orphans last frame's data instead of waiting for the GPU to finish with it
+    glBindBuffer(GL_ARRAY_BUFFER, g_instanceBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, size, instances.data(), GL_STREAM_DRAW);
+}
+
+void Gfx::drawIndexedGeometryInstanced(uint32_t firstInstance, uint32_t instanceCount, uint32_t indexCount)
+{
+    g_frameStats.drawCalls++;
+    g_frameStats.triangles += static_cast<uint64_t>(indexCount / 3) * instanceCount;
+    if (isHeadless())
+    {
+        record(Command::Kind::DRAW_INDEXED_INSTANCED, instanceCount, indexCount);
+        return;
+    }
+
+    glDrawElementsInstancedBaseInstance(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr, instanceCount, firstInstance);
 }
 
 Gfx::TextureIdType Gfx::createTextureObject()
 {
+    if (isHeadless())
+    {
+        return createHeadlessObject();
+    }
+
     Gfx::TextureIdType texture{};
     glGenTextures(1, &texture);
 
     return texture;
 }
 
+void Gfx::destroyTextureObject(TextureIdType textureId)
+{
+    if (isHeadless() || g_window == nullptr)
+    {
+        return;
+    }
+
+    glDeleteTextures(1, &textureId);
+}
+
 void Gfx::setActiveTexture(TextureIdType textureId)
 {
+    g_frameStats.stateChanges++;
+    if (isHeadless())
+    {
+        record(Command::Kind::BIND_TEXTURE, textureId, 0);
+        return;
+    }
+
     glBindTexture(GL_TEXTURE_2D, textureId);
 }
 
-Gfx::TextureIdType Gfx::textureFromData(uint8_t* data, int32_t width, int32_t height)
+void Gfx::setActiveTextureArray(TextureIdType textureId)
+{
+    g_frameStats.stateChanges++;
+    if (isHeadless())
+    {
+        record(Command::Kind::BIND_TEXTURE, textureId, 0);
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+}
+
+Gfx::TextureIdType Gfx::textureFromData(TextureCompression::Format format, std::span<const TextureCompression::Level> levels)
 {
+    KORELIB_VERIFY_THROW(!levels.empty(), korelib::RuntimeException, "Texture has no levels");
+
     Gfx::TextureIdType textureId = Gfx::createTextureObject();
     Gfx::setActiveTexture(textureId);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    if (isHeadless())
+    {
+        for (const TextureCompression::Level& level : levels)
+        {
+            g_frameStats.uploadedBytes += level.data.size();
+            record(Command::Kind::UPLOAD_TEXTURE, textureId, level.data.size());
+        }
+        return textureId;
+    }
+
+    GLenum internalFormat{};
+    GLenum pixelFormat{};
+    switch (format)
+    {
+        case TextureCompression::Format::R8:
+        {
+            internalFormat = GL_R8;
+            pixelFormat = GL_RED;
+            const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+            break;
+        }
+        case TextureCompression::Format::RG8:
+        {
+            // Grey plus alpha
+            internalFormat = GL_RG8;
+            pixelFormat = GL_RG;
+            const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+            break;
+        }
+        case TextureCompression::Format::RGB8:
+            internalFormat = GL_RGB8;
+            pixelFormat = GL_RGB;
+            break;
+        case TextureCompression::Format::RGBA8:
+            internalFormat = GL_RGBA8;
+            pixelFormat = GL_RGBA;
+            break;
+        case TextureCompression::Format::BC1:
+            internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            break;
+        case TextureCompression::Format::BC3:
+            internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            break;
+        case TextureCompression::Format::BC7:
+            internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+            break;
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size() - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    // Rows of RGB and single channel levels are not 4 byte aligned
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (std::size_t levelIndex = 0; levelIndex < levels.size(); levelIndex++)
+    {
+        const TextureCompression::Level& level = levels[levelIndex];
+        g_frameStats.uploadedBytes += level.data.size();
+
+        if (TextureCompression::isCompressed(format))
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(levelIndex), internalFormat, level.width, level.height, 0, static_cast<GLsizei>(level.data.size()), level.data.data());
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(levelIndex), static_cast<GLint>(internalFormat), level.width, level.height, 0, pixelFormat, GL_UNSIGNED_BYTE, level.data.data());
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    return textureId;
+}
+
+Gfx::TextureIdType Gfx::textureArrayFromData(TextureCompression::Format format, uint32_t layerCount, std::span<const TextureCompression::Level> levels)
+{
+    KORELIB_VERIFY_THROW(!levels.empty() && layerCount > 0, korelib::RuntimeException, "Texture array has no levels or layers");
+    KORELIB_VERIFY_THROW(!TextureCompression::isCompressed(format), korelib::RuntimeException, "Texture arrays are uploaded uncompressed");
+
+    Gfx::TextureIdType textureId = Gfx::createTextureObject();
+    Gfx::setActiveTextureArray(textureId);
+
+    if (isHeadless())
+    {
+        for (const TextureCompression::Level& level : levels)
+        {
+            g_frameStats.uploadedBytes += level.data.size();
+            record(Command::Kind::UPLOAD_TEXTURE, textureId, level.data.size());
+        }
+        return textureId;
+    }
+
+    // Indexed by the uncompressed formats, which come first in TextureCompression::Format
+    static constexpr std::array<GLenum, 4> INTERNAL_FORMATS { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+    static constexpr std::array<GLenum, 4> PIXEL_FORMATS { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    const std::size_t formatIndex = static_cast<std::size_t>(format);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size() - 1));
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (std::size_t levelIndex = 0; levelIndex < levels.size(); levelIndex++)
+    {
+        const TextureCompression::Level& level = levels[levelIndex];
+        KORELIB_VERIFY_THROW(level.data.size() == TextureCompression::levelSize(format, level.width, level.height) * layerCount, korelib::RuntimeException, "Texture array level size does not match its layers");
+
+        g_frameStats.uploadedBytes += level.data.size();
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(levelIndex), static_cast<GLint>(INTERNAL_FORMATS[formatIndex]), level.width, level.height, static_cast<GLsizei>(layerCount), 0, PIXEL_FORMATS[formatIndex], GL_UNSIGNED_BYTE, level.data.data());
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     return textureId;
 }
@@ -386,39 +1128,353 @@ void Gfx::setActiveCamera(std::shared_ptr<Camera> camera)
 
 void Gfx::endFrame()
 {
-    glfwPollEvents();
+    {
+        PROFILE_ZONE("Gfx::endFrame");
+        {
+            const GpuPass gpuPass { "RenderQueue::flush" };
+            RenderQueue::flush();
+        }
 
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        if (!isHeadless())
+        {
+            glfwPollEvents();
+
+            PROFILE_ZONE("ImGui::Render");
+            ImGui::Render();
+            {
+                const GpuPass gpuPass { "ImGui::Render" };
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            }
+
+            // Platform windows render in their own contexts, which timer queries of the main context can't see
+            if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+            {
+                PROFILE_ZONE("ImGui::RenderPlatformWindows");
+                GLFWwindow* backup_current_context = glfwGetCurrentContext();
+                ImGui::UpdatePlatformWindows();
+                ImGui::RenderPlatformWindowsDefault();
+                glfwMakeContextCurrent(backup_current_context);
+            }
+        }
 
-    if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
-    {
-        GLFWwindow* backup_current_context = glfwGetCurrentContext();
-        ImGui::UpdatePlatformWindows();
-        ImGui::RenderPlatformWindowsDefault();
-        glfwMakeContextCurrent(backup_current_context);
+        waitForFrameDeadline();
+
+        PROFILE_ZONE("Gfx::swap");
+        swap();
     }
 
-    swap();
+    g_frameIndex++;
+    Profiler::endFrame();
 }
 
 void Gfx::destroy()
 {
+    g_activeCamera.reset();
+    if (isHeadless())
+    {
+        return;
+    }
+
+    for (GpuTimerFrame& timerFrame : g_gpuTimerFrames)
+    {
+        for (const GpuTimerQuery& query : timerFrame.queries)
+        {
+            glDeleteQueries(1, &query.query);
+        }
+        timerFrame = {};
+    }
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
     glfwDestroyWindow(g_window);
     glfwTerminate();
+    g_window = nullptr;
+}
+
+void Gfx::beginGpuPass(const char* name)
+{
+    KORELIB_VERIFY_THROW(!g_gpuPassActive, korelib::RuntimeException, fmt::format("GPU pass '{}' began inside another pass, timer queries can't nest", name));
+
+    GpuTimerFrame& timerFrame = g_gpuTimerFrames[g_frameIndex % GPU_TIMER_LATENCY];
+    if (timerFrame.used == timerFrame.queries.size())
+    {
+        GpuTimerQuery& query = timerFrame.queries.emplace_back(GpuTimerQuery{ .name = nullptr, .query = 0, .begin = 0, .end = 0 });
+        if (!isHeadless())
+        {
+            glGenQueries(1, &query.query);
+        }
+    }
+
+    GpuTimerQuery& query = timerFrame.queries[timerFrame.used++];
+    query.name = name;
+    g_gpuPassActive = true;
+
+    if (isHeadless())
+    {
+        record(Command::Kind::BEGIN_GPU_PASS, timerFrame.used - 1, 0);
+        query.begin = Profiler::now();
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, query.query);
+}
+
+void Gfx::endGpuPass()
+{
+    KORELIB_VERIFY_THROW(g_gpuPassActive, korelib::RuntimeException, "endGpuPass without an active GPU pass");
+    endGpuPassUnchecked();
+}
+
+void Gfx::endGpuPassUnchecked() noexcept
+{
+    g_gpuPassActive = false;
+
+    GpuTimerFrame& timerFrame = g_gpuTimerFrames[g_frameIndex % GPU_TIMER_LATENCY];
+    if (isHeadless())
+    {
+        timerFrame.queries[timerFrame.used - 1].end = Profiler::now();
+        record(Command::Kind::END_GPU_PASS, timerFrame.used - 1, 0);
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+std::span<const Gfx::GpuPassTiming> Gfx::gpuPassTimings()
+{
+    return g_gpuPassTimings;
+}
+
+uint64_t Gfx::gpuTimingsFrame()
+{
+    return g_gpuTimingsFrame;
+}
+
+uint64_t Gfx::frameIndex()
+{
+    return g_frameIndex;
+}
+
+void Gfx::resolveGpuTimers()
+{
+    GpuTimerFrame& timerFrame = g_gpuTimerFrames[g_frameIndex % GPU_TIMER_LATENCY];
+    if (timerFrame.used > 0)
+    {
+        // Queries finish in submission order, so the last one being available means all of them are.
+        // A GPU that is more than GPU_TIMER_LATENCY frames behind loses these timings instead of stalling the CPU
+        GLint available = GL_TRUE;
+        if (!isHeadless())
+        {
+            glGetQueryObjectiv(timerFrame.queries[timerFrame.used - 1].query, GL_QUERY_RESULT_AVAILABLE, &available);
+        }
+
+        if (available == GL_TRUE)
+        {
+            g_gpuPassTimings.clear();
+            for (uint32_t index = 0; index < timerFrame.used; index++)
+            {
+                const GpuTimerQuery& query = timerFrame.queries[index];
+                GLuint64 elapsed = query.end - query.begin;
+                if (!isHeadless())
+                {
+                    glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &elapsed);
+                }
+
+                g_gpuPassTimings.emplace_back(GpuPassTiming{ .name = query.name, .milliseconds = elapsed / 1.0e6 });
+            }
+
+            g_gpuTimingsFrame = timerFrame.frame;
+        }
+    }
+
+    timerFrame.frame = g_frameIndex;
+    timerFrame.used = 0;
+}
+
+void Gfx::setPacingMode(PacingMode mode)
+{
+    if (mode == g_pacingMode)
+    {
+        return;
+    }
+
+    g_pacingMode = mode;
+    g_frameDeadline = {};
+    resetFrameTimes();
+    applySwapInterval();
+}
+
+Gfx::PacingMode Gfx::pacingMode()
+{
+    return g_pacingMode;
+}
+
+void Gfx::setTargetFrameRate(double framesPerSecond)
+{
+    KORELIB_VERIFY_THROW(framesPerSecond > 0.0, korelib::RuntimeException, fmt::format("Target frame rate has to be positive, got {}", framesPerSecond));
+    g_targetFrameRate = framesPerSecond;
+}
+
+double Gfx::targetFrameRate()
+{
+    return g_targetFrameRate;
+}
+
+Gfx::FrameTimeStats Gfx::frameTimeStats()
+{
+    if (g_frameTimeCount == 0)
+    {
+        return FrameTimeStats{ .samples = 0, .average = 0.0, .p50 = 0.0, .p95 = 0.0, .p99 = 0.0, .max = 0.0 };
+    }
+
+    std::array<float, FRAME_TIME_HISTORY> sorted = g_frameTimes;
+    const auto first = sorted.begin();
+    const auto last = first + g_frameTimeCount;
+
+    // Nearest rank, each nth_element only has to look at the part above the previous percentile
+    auto percentile = [&](double fraction, auto from) {
+        const auto nth = first + static_cast<ptrdiff_t>(std::ceil(fraction * g_frameTimeCount)) - 1;
+        std::nth_element(from, nth, last);
+        return nth;
+    };
+
+    const auto p50 = percentile(0.50, first);
+    const auto p95 = percentile(0.95, p50);
+    const auto p99 = percentile(0.99, p95);
+
+    return FrameTimeStats{
+        .samples = g_frameTimeCount,
+        .average = std::accumulate(first, last, 0.0) / g_frameTimeCount,
+        .p50 = *p50,
+        .p95 = *p95,
+        .p99 = *p99,
+        .max = *std::max_element(p99, last)
+    };
+}
+
+std::span<const uint32_t> Gfx::frameTimeHistogram()
+{
+    return g_frameTimeHistogram;
+}
+
+void Gfx::resetFrameTimes()
+{
+    g_frameTimeCount = 0;
+    g_frameTimeCursor = 0;
+    g_frameTimeHistogram = {};
+}
+
+void Gfx::applySwapInterval()
+{
+    if (isHeadless() || g_window == nullptr)
+    {
+        return;
+    }
+
+    glfwSwapInterval(g_pacingMode == PacingMode::VSYNC ? 1 : 0);
+}
+
+void Gfx::waitForFrameDeadline()
+{
+    using Clock = std::chrono::steady_clock;
+
+    // sleep_for can't be trusted below this, and a single bad wake up doesn't get to spin whole frames
+    static constexpr Clock::duration MIN_SPIN = std::chrono::microseconds(200);
+    static constexpr Clock::duration MAX_SPIN = std::chrono::milliseconds(4);
+
+    if (g_pacingMode != PacingMode::FIXED)
+    {
+        return;
+    }
+
+    PROFILE_ZONE("Gfx::waitForFrameDeadline");
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / g_targetFrameRate));
+    Clock::time_point now = Clock::now();
+
+    // Deadlines advance by whole periods so waking up a little late doesn't add up over frames.
+    // A frame that misses its slot restarts the cadence rather than rushing the following frames to catch up
+    g_frameDeadline += period;
+    if (g_frameDeadline <= now)
+    {
+        g_frameDeadline = now;
+        return;
+    }
+
+    const Clock::duration spin = std::clamp(g_sleepOvershoot + MIN_SPIN, MIN_SPIN, MAX_SPIN);
+    if (g_frameDeadline - now > spin)
+    {
+        const Clock::duration requested = g_frameDeadline - now - spin;
+        std::this_thread::sleep_for(requested);
+
+        const Clock::time_point woken = Clock::now();
+        const Clock::duration overshoot = std::max(Clock::duration::zero(), woken - now - requested);
+        // Follows a slower scheduler right away and relaxes over a few dozen frames
+        g_sleepOvershoot = std::max(overshoot, g_sleepOvershoot - g_sleepOvershoot / 16);
+        now = woken;
+    }
+
+    while (now < g_frameDeadline)
+    {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+}
+
+void Gfx::recordFrameTime(double milliseconds)
+{
+    const auto bucket = [](float frameTime) {
+        return std::min(static_cast<uint32_t>(frameTime / FRAME_TIME_BUCKET_MILLISECONDS), FRAME_TIME_BUCKET_COUNT - 1);
+    };
+
+    if (g_frameTimeCount == FRAME_TIME_HISTORY)
+    {
+        g_frameTimeHistogram[bucket(g_frameTimes[g_frameTimeCursor])]--;
+    }
+    else
+    {
+        g_frameTimeCount++;
+    }
+
+    const float frameTime = static_cast<float>(std::max(milliseconds, 0.0));
+    g_frameTimes[g_frameTimeCursor] = frameTime;
+    g_frameTimeHistogram[bucket(frameTime)]++;
+    g_frameTimeCursor = (g_frameTimeCursor + 1) % FRAME_TIME_HISTORY;
+}
+
+uint32_t Gfx::createHeadlessObject()
+{
+    return ++g_lastHeadlessObject;
+}
+
+void Gfx::record(Command::Kind kind, uint32_t object, uint64_t size)
+{
+    if (g_backend != Backend::RECORDING)
+    {
+        return;
+    }
+
+    g_recordedCommands.emplace_back(Command{ .kind = kind, .object = object, .size = size });
 }
 
 bool Input::GetKeyDown(uint32_t keyCode)
 {
+    if (Gfx::isHeadless())
+    {
+        return false;
+    }
+
     return glfwGetKey(Gfx::g_window, keyCode) == GLFW_PRESS;
 }
 
 glm::vec2 Input::GetMousePosition()
 {
+    if (Gfx::isHeadless())
+    {
+        return {};
+    }
+
     double x; 
     double y;
 
@@ -429,5 +1485,10 @@ glm::vec2 Input::GetMousePosition()
 
 bool Input::GetMouseButtonDown(uint32_t keyCode)
 {
+    if (Gfx::isHeadless())
+    {
+        return false;
+    }
+
     return glfwGetMouseButton(Gfx::g_window, keyCode) == GLFW_PRESS;
 }
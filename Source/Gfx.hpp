@@ -1,13 +1,21 @@
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "Korelib.hpp"
+#include "TextureCompression.hpp"
 
 #include "glm/glm.hpp"
 #include "glm/gtx/matrix_decompose.hpp"
@@ -29,22 +37,73 @@ class Gfx final : public korelib::StaticOnlyClass
     friend class Input;
 
 public:
+    // Every ShaderPermutations variant is built from this pair, features are switched on by defines.
+    // The default program is the INSTANCING variant.
     static constexpr auto DEFAULT_VERTEX_SHADER = R"(
         #version 460 core
 
         layout (location = 0) in vec3 inPos;
         layout (location = 1) in vec2 inUV;
 
-        uniform mat4 model;
-        uniform mat4 view;
-        uniform mat4 projection;
+        layout (std140, binding = 0) uniform CameraData
+        {
+            mat4 view;
+            mat4 projection;
+        };
+
+    #ifdef INSTANCING
+        layout (location = 2) in mat4 inModel;
+        layout (location = 6) in vec4 inParameters;
+    #else
+        layout (location = 0) uniform mat4 model;
+    #endif
+
+    #ifdef TEXTURE_ARRAY
+        #ifndef INSTANCING
+        layout (location = 1) uniform float u_layer;
+        #endif
+        flat out float layer;
+    #endif
+    #ifdef VOXEL
+        layout (location = 7) in vec4 inRegion;
+        layout (location = 8) in float inLayer;
+        flat out vec4 region;
+    #endif
+    #ifdef LIGHTING
+        out vec3 worldPosition;
+    #endif
+    #ifdef FOG
+        out float viewDistance;
+    #endif
 
         out vec2 uv;
 
         void main()
         {
-            gl_Position = projection * view * model * vec4(inPos, 1.0);
+        #ifdef INSTANCING
+            mat4 world = inModel;
+        #else
+            mat4 world = model;
+        #endif
+            vec4 worldPos = world * vec4(inPos, 1.0);
+            vec4 viewPos = view * worldPos;
+            gl_Position = projection * viewPos;
             uv = inUV;
+
+        #if defined(VOXEL)
+            layer = inLayer;
+            region = inRegion;
+        #elif defined(TEXTURE_ARRAY) && defined(INSTANCING)
+            layer = inParameters.x;
+        #elif defined(TEXTURE_ARRAY)
+            layer = u_layer;
+        #endif
+        #ifdef LIGHTING
+            worldPosition = worldPos.xyz;
+        #endif
+        #ifdef FOG
+            viewDistance = length(viewPos.xyz);
+        #endif
         }
     )";
 
@@ -55,20 +114,175 @@ public:
 
         in vec2 uv;
 
-        uniform sampler2D u_texture;
+    #ifdef TEXTURE_ARRAY
+        flat in float layer;
+        layout (binding = 0) uniform sampler2DArray u_texture;
+    #else
+        layout (binding = 0) uniform sampler2D u_texture;
+    #endif
+
+    #ifdef VOXEL
+        flat in vec4 region;
+    #endif
+
+    #if defined(LIGHTING) || defined(FOG)
+        layout (std140, binding = 1) uniform EnvironmentData
+        {
+            vec4 lightDirection;
+            vec4 lightColor;
+            vec4 ambientColor;
+            vec4 fogColor;
+            vec4 fogRange;
+        };
+    #endif
+    #ifdef LIGHTING
+        in vec3 worldPosition;
+    #endif
+    #ifdef FOG
+        in float viewDistance;
+    #endif
 
         void main()
         {
-            FragColor = texture(u_texture, uv);
+        #if defined(VOXEL)
+            // uv counts blocks across a merged quad and every block repeats the region of its face.
+            // The gradients of the unwrapped uv keep fract from picking the smallest mip along block edges
+            vec4 color = textureGrad(u_texture, vec3(region.xy + fract(uv) * region.zw, layer), dFdx(uv) * region.zw, dFdy(uv) * region.zw);
+        #elif defined(TEXTURE_ARRAY)
+            vec4 color = texture(u_texture, vec3(uv, layer));
+        #else
+            vec4 color = texture(u_texture, uv);
+        #endif
+
+        #ifdef LIGHTING
+            // Face normal from the screen space derivatives of the position, so meshes don't need normals
+            vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+            color.rgb *= ambientColor.rgb + lightColor.rgb * max(dot(normal, -lightDirection.xyz), 0.0);
+        #endif
+        #ifdef FOG
+            color.rgb = mix(color.rgb, fogColor.rgb, clamp((viewDistance - fogRange.x) / (fogRange.y - fogRange.x), 0.0, 1.0));
+        #endif
+
+            FragColor = color;
         }
     )";
-    
+
+    // mat4 per instance, occupies locations 2..5
+    static constexpr uint32_t INSTANCE_MODEL_ATTRIBUTE_INDEX = 2;
+    // vec4 per instance, x is the texture array layer
+    static constexpr uint32_t INSTANCE_PARAMETERS_ATTRIBUTE_INDEX = 6;
+    // vec4 page region and float layer per voxel vertex, read by the VOXEL variants
+    static constexpr uint32_t VOXEL_REGION_ATTRIBUTE_INDEX = 7;
+    static constexpr uint32_t VOXEL_LAYER_ATTRIBUTE_INDEX = 8;
+
+    // Explicit uniform locations of the default shaders, written without any lookup
+    static constexpr int32_t MODEL_UNIFORM_LOCATION = 0;
+    static constexpr int32_t TEXTURE_LAYER_UNIFORM_LOCATION = 1;
+    // Define that selects the per instance inputs of the default shaders
+    static constexpr std::string_view INSTANCING_DEFINE = "INSTANCING";
+
+    // Uniform block binding point of CameraData, shared by every program
+    static constexpr uint32_t CAMERA_UNIFORM_BLOCK_BINDING = 0;
+    // Uniform block binding point of EnvironmentData, read by the LIGHTING and FOG variants
+    static constexpr uint32_t ENVIRONMENT_UNIFORM_BLOCK_BINDING = 1;
+
+    // Frames between recording a GPU pass and reading its timer query back, one query pool per frame in flight
+    static constexpr uint32_t GPU_TIMER_LATENCY = 3;
+
+    static constexpr double DEFAULT_TARGET_FRAME_RATE = 60.0;
+
+    // Frame times kept for frameTimeStats() and the histogram
+    static constexpr uint32_t FRAME_TIME_HISTORY = 1024;
+    // Histogram resolution, frames slower than the last bucket are counted in it
+    static constexpr double FRAME_TIME_BUCKET_MILLISECONDS = 0.25;
+    static constexpr uint32_t FRAME_TIME_BUCKET_COUNT = 200;
+
 public:
     enum class WindowFlags : uint32_t
     {
         NONE = 0x00000000
     };
 
+    enum class Backend : uint8_t
+    {
+        OPENGL,
+        NONE,      // no window, no context, every call is a no-op
+        RECORDING  // same as NONE, but every call is appended to recordedCommands()
+    };
+
+    enum class PacingMode : uint8_t
+    {
+        UNLIMITED, // swap interval 0, frames start as soon as the previous one is swapped
+        FIXED,     // swap interval 0, endFrame waits until targetFrameRate() allows the next swap
+        VSYNC      // swap interval 1, the driver blocks in swap. Headless backends don't wait at all.
+    };
+
+    // Milliseconds between consecutive beginFrame calls over the last FRAME_TIME_HISTORY frames
+    struct FrameTimeStats
+    {
+        uint32_t samples;
+        double average;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
+
+    struct FrameStats
+    {
+        uint64_t drawCalls;
+        uint64_t triangles;
+        uint64_t stateChanges;
+        uint64_t uploadedBytes;
+        uint64_t uniformWrites;
+    };
+
+    struct Command
+    {
+        enum class Kind : uint8_t
+        {
+            CLEAR,
+            SET_SHADER_PROGRAM,
+            SET_UNIFORM,
+            BIND_TEXTURE,
+            BIND_VERTEX_BUFFER,
+            BIND_VERTEX_ARRAY,
+            SET_VERTEX_ATTRIBUTE,
+            UPLOAD_VERTEX_BUFFER,
+            UPLOAD_ELEMENT_BUFFER,
+            UPLOAD_TEXTURE,
+            UPLOAD_UNIFORM_BUFFER,
+            DRAW_INDEXED_INSTANCED,
+            BEGIN_GPU_PASS,
+            END_GPU_PASS,
+            SWAP
+        };
+
+        Kind kind;
+        uint32_t object;
+        uint64_t size;
+    };
+
+    // Scene wide parameters of the LIGHTING and FOG variants
+    struct Environment
+    {
+        // Direction the light travels in, normalized on upload
+        glm::vec3 lightDirection;
+        glm::vec3 lightColor;
+        glm::vec3 ambientColor;
+        glm::vec3 fogColor;
+        // View distances where fog starts and where it fully covers the surface
+        float fogStart;
+        float fogEnd;
+    };
+
+    struct InstanceData
+    {
+        glm::mat4 model;
+        // x: texture array layer
+        glm::vec4 parameters;
+    };
+
     struct Vertex
     {
         glm::vec3 position;
@@ -82,8 +296,11 @@ public:
 
     using VertexBufferObjectType = uint32_t; // stores data
     using VertexArrayObjectType = uint32_t; // stores pointers in data buffer
+    using ElementBufferObjectType = uint32_t; // stores indices
     using ShaderType = uint32_t;
     using TextureIdType = uint32_t;
+    using UniformLocationType = int32_t;
+    using UniformBufferObjectType = uint32_t;
 
     struct Transform
     {
@@ -132,8 +349,43 @@ public:
         bool aligned;
     };
 
+    // Driver specific program blob, only loadable by the driver that produced it
+    struct ShaderProgramBinary
+    {
+        uint32_t format;
+        std::vector<std::byte> data;
+    };
+
+    struct GpuPassTiming
+    {
+        const char* name;
+        double milliseconds;
+    };
+
+    // Times everything submitted between construction and destruction as one GPU pass
+    class GpuPass
+    {
+    public:
+        explicit GpuPass(const char* name)
+        {
+            beginGpuPass(name);
+        }
+
+        // Destructors can't report errors, a pass someone already ended by hand is left alone
+        ~GpuPass()
+        {
+            if (g_gpuPassActive)
+            {
+                endGpuPassUnchecked();
+            }
+        }
+
+        GpuPass(const GpuPass&) = delete;
+        GpuPass& operator=(const GpuPass&) = delete;
+    };
+
 public:
-    static void initialize(uint32_t width, uint32_t height, const std::string& title, WindowFlags flags);
+    static void initialize(uint32_t width, uint32_t height, const std::string& title, WindowFlags flags, Backend backend = Backend::OPENGL);
     static void beginFrame();
     static float deltaTime();
     static bool windowShouldClose();
@@ -147,24 +399,81 @@ public:
     static void swap();
     static VertexBufferObjectType createVertexBufferObject();
     static VertexArrayObjectType createVertexArrayObject();
+    static ElementBufferObjectType createElementBufferObject();
+    static void destroyBufferObject(uint32_t bufferObject);
+    static void destroyVertexArrayObject(VertexArrayObjectType vertexArrayObject);
     static ShaderType compileShader(const std::string& source, ShaderKind kind);
     static ShaderType linkShaderProgram(ShaderType vertexShader, ShaderType fragmentShader);
-    static void setShaderUniformBoolValue(ShaderType shaderProgram, const std::string& name, bool value);
-    static void setShaderUniformIntValue(ShaderType shaderProgram, const std::string& name, int32_t value);
-    static void setShaderUniformIntValue(ShaderType shaderProgram, const std::string& name, float value);
-    static void setShaderMat4x4Value(ShaderType shaderProgram, const std::string& name, const glm::mat4& value);
+    static UniformLocationType getUniformLocation(ShaderType shaderProgram, std::string_view name);
+    static void setShaderUniformBoolValue(ShaderType shaderProgram, std::string_view name, bool value);
+    static void setShaderUniformBoolValue(ShaderType shaderProgram, UniformLocationType location, bool value);
+    static void setShaderUniformIntValue(ShaderType shaderProgram, std::string_view name, int32_t value);
+    static void setShaderUniformIntValue(ShaderType shaderProgram, UniformLocationType location, int32_t value);
+    static void setShaderUniformIntValue(ShaderType shaderProgram, std::string_view name, float value);
+    static void setShaderUniformIntValue(ShaderType shaderProgram, UniformLocationType location, float value);
+    static void setShaderMat4x4Value(ShaderType shaderProgram, std::string_view name, const glm::mat4& value);
+    static void setShaderMat4x4Value(ShaderType shaderProgram, UniformLocationType location, const glm::mat4& value);
+    static void updateCameraData(const glm::mat4& view, const glm::mat4& projection);
+    static void setEnvironment(const Environment& environment);
+    static const Environment& environment();
     static void setShaderProgram(ShaderType program);
     static void destroyShader(ShaderType shader);
+    // Compiles and links without querying any status, so a driver with parallel compilation returns right away
+    static ShaderType beginShaderProgram(const std::string& vertexSource, const std::string& fragmentSource);
+    // False while the driver is still compiling or linking in the background.
+    // Always true without GL_KHR_parallel_shader_compile, finishShaderProgram blocks instead.
+    static bool isShaderProgramCompleted(ShaderType shaderProgram);
+    // Throws with the info logs when compiling or linking failed, reflects the uniforms otherwise
+    static void finishShaderProgram(ShaderType shaderProgram);
+    // Empty data when the driver supports no binary formats
+    static ShaderProgramBinary getShaderProgramBinary(ShaderType shaderProgram);
+    // 0 when the driver rejects the binary, which is expected after driver updates
+    static ShaderType shaderProgramFromBinary(uint32_t format, std::span<const std::byte> data);
+    static void destroyShaderProgram(ShaderType shaderProgram);
+    // Inserts "#define <define>" lines after the #version line, in the given order
+    static std::string insertShaderDefines(std::string_view source, std::span<const std::string_view> defines);
+    // Vendor, renderer and version strings, program binaries of another driver identity are never loaded
+    static std::string driverIdentity();
     static void updateVertexBufferData(VertexBufferObjectType vertexBufferObject, const std::vector<Vertex>& vertices);
-    static void drawIndexedGeometry(const Transform& transform, const std::vector<std::array<uint32_t, 3>>& triangles, ShaderType shaderProgram, VertexBufferObjectType vertexBufferObject, VertexArrayObjectType vertexArrayObject, const std::vector<Attribute>& attributesDataOffsets);
+    static void updateVertexBufferData(VertexBufferObjectType vertexBufferObject, std::span<const std::byte> vertexData);
+    static void updateElementBufferData(VertexArrayObjectType vertexArrayObject, ElementBufferObjectType elementBufferObject, const std::vector<std::array<uint32_t, 3>>& triangles);
+    static void setupVertexArray(VertexArrayObjectType vertexArrayObject, VertexBufferObjectType vertexBufferObject, ElementBufferObjectType elementBufferObject, std::span<const Attribute> attributesDataOffsets);
+    static void bindVertexArray(VertexArrayObjectType vertexArrayObject);
+    static void updateInstanceBufferData(const std::vector<InstanceData>& instances);
+    // For the bound INSTANCING program, instances are read from the instance buffer starting at firstInstance
+    static void drawIndexedGeometryInstanced(uint32_t firstInstance, uint32_t instanceCount, uint32_t indexCount);
     static TextureIdType createTextureObject();
+    static void destroyTextureObject(TextureIdType textureId);
     static void setActiveTexture(TextureIdType textureId);
-    static TextureIdType textureFromData(uint8_t* data, int32_t width, int32_t height);
+    // Uploads a whole mip chain, level 0 first. Block compressed levels go through glCompressedTexImage2D as they are.
+    static TextureIdType textureFromData(TextureCompression::Format format, std::span<const TextureCompression::Level> levels);
+    // Uncompressed 2D array texture, the data of each level holds all layers back to back
+    static TextureIdType textureArrayFromData(TextureCompression::Format format, uint32_t layerCount, std::span<const TextureCompression::Level> levels);
+    static void setActiveTextureArray(TextureIdType textureId);
     static std::shared_ptr<class Camera> getActiveCamera();
     static void setActiveCamera(std::shared_ptr<Camera> camera);
     static void endFrame();
     static void destroy();
 
+    // Takes effect on the next swap, changing the mode also clears the frame time history
+    static void setPacingMode(PacingMode mode);
+    static PacingMode pacingMode();
+    static void setTargetFrameRate(double framesPerSecond);
+    static double targetFrameRate();
+    static FrameTimeStats frameTimeStats();
+    // FRAME_TIME_BUCKET_COUNT frame counts, bucket i covers [i, i + 1) * FRAME_TIME_BUCKET_MILLISECONDS
+    static std::span<const uint32_t> frameTimeHistogram();
+    static void resetFrameTimes();
+
+    // GL_TIME_ELAPSED queries can't nest, so a pass has to end before the next one begins.
+    // name has to outlive the timings, headless backends time the CPU side of the pass instead.
+    static void beginGpuPass(const char* name);
+    static void endGpuPass();
+    // Passes of gpuTimingsFrame() in recording order, GPU_TIMER_LATENCY frames old
+    static std::span<const GpuPassTiming> gpuPassTimings();
+    static uint64_t gpuTimingsFrame();
+    static uint64_t frameIndex();
+
     static WindowReizeDelegate& onWindowSizeChangedDelegate()
     {
         return g_onWindowSizeChanged;
@@ -175,13 +484,112 @@ public:
         return g_defaultShader;
     }
 
+    static Backend backend()
+    {
+        return g_backend;
+    }
+
+    static bool isHeadless()
+    {
+        return g_backend != Backend::OPENGL;
+    }
+
+    static bool supportsParallelShaderCompile()
+    {
+        return g_parallelShaderCompile;
+    }
+
+    static const FrameStats& frameStats()
+    {
+        return g_frameStats;
+    }
+
+    static const std::vector<Command>& recordedCommands()
+    {
+        return g_recordedCommands;
+    }
+
+private:
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view value) const
+        {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    // Active uniform name -> location, reflected once when the program is linked
+    using UniformTable = std::unordered_map<std::string, UniformLocationType, StringHash, std::equal_to<>>;
+
+    struct GpuTimerQuery
+    {
+        const char* name;
+        uint32_t query;
+        // Stand-in timestamps of the headless backends
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    struct GpuTimerFrame
+    {
+        uint64_t frame;
+        uint32_t used;
+        std::vector<GpuTimerQuery> queries;
+    };
+
+    // Reads back the pool of the frame that is about to be reused, when the GPU finished it
+    static void resolveGpuTimers();
+    // endGpuPass without the check for an active pass, which GpuPass does without throwing
+    static void endGpuPassUnchecked() noexcept;
+    static void applySwapInterval();
+    // Sleeps until shortly before the deadline of the FIXED mode, then spins the rest so the swap isn't late
+    static void waitForFrameDeadline();
+    static void recordFrameTime(double milliseconds);
+    static void reflectUniforms(ShaderType shaderProgram);
+    static uint32_t createHeadlessObject();
+    static void record(Command::Kind kind, uint32_t object, uint64_t size);
+
 private:
     static inline WindowType g_window { nullptr };
     static inline WindowReizeDelegate g_onWindowSizeChanged {};
     static inline ShaderType g_defaultShader {};
+    static inline VertexBufferObjectType g_instanceBufferObject {};
+    static inline UniformBufferObjectType g_cameraUniformBufferObject {};
+    static inline UniformBufferObjectType g_environmentUniformBufferObject {};
+    static inline Environment g_environment {
+        .lightDirection = { -0.4f, -1.0f, -0.3f },
+        .lightColor = { 0.9f, 0.9f, 0.85f },
+        .ambientColor = { 0.25f, 0.25f, 0.3f },
+        .fogColor = { 0.2f, 0.3f, 0.3f },
+        .fogStart = 10.0f,
+        .fogEnd = 60.0f
+    };
+    static inline bool g_parallelShaderCompile { false };
+    static inline std::unordered_map<ShaderType, UniformTable> g_uniformTables {};
     static inline float g_deltaTime {};
-    static inline float g_lastFrameTime{};
+    static inline double g_lastFrameTime{};
     static inline std::shared_ptr<class Camera> g_activeCamera{};
+    static inline Backend g_backend { Backend::OPENGL };
+    static inline glm::uvec2 g_headlessWindowSize {};
+    static inline uint32_t g_lastHeadlessObject {};
+    static inline FrameStats g_frameStats {};
+    static inline std::vector<Command> g_recordedCommands {};
+    static inline uint64_t g_frameIndex { 0 };
+    static inline std::array<GpuTimerFrame, GPU_TIMER_LATENCY> g_gpuTimerFrames {};
+    static inline bool g_gpuPassActive { false };
+    static inline std::vector<GpuPassTiming> g_gpuPassTimings {};
+    static inline uint64_t g_gpuTimingsFrame { 0 };
+    static inline PacingMode g_pacingMode { PacingMode::VSYNC };
+    static inline double g_targetFrameRate { DEFAULT_TARGET_FRAME_RATE };
+    static inline std::chrono::steady_clock::time_point g_frameDeadline {};
+    // How late sleep_for has been waking up recently, the part of a wait that is spun instead of slept
+    static inline std::chrono::steady_clock::duration g_sleepOvershoot {};
+    static inline std::array<float, FRAME_TIME_HISTORY> g_frameTimes {};
+    static inline uint32_t g_frameTimeCount { 0 };
+    static inline uint32_t g_frameTimeCursor { 0 };
+    static inline std::array<uint32_t, FRAME_TIME_BUCKET_COUNT> g_frameTimeHistogram {};
 };
 
 
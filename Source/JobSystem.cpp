@@ -0,0 +1,277 @@
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <utility>
+
+void JobSystem::initialize(uint32_t workerCount)
+{
+    KORELIB_VERIFY_THROW(!g_running, korelib::RuntimeException, "JobSystem is already initialized");
+
+    g_running = true;
+    g_queues.clear();
+    for (uint32_t queueIndex = 0; queueIndex < workerCount + 1; queueIndex++)
+    {
+        g_queues.emplace_back(std::make_unique<Queue>());
+    }
+
+    t_queueIndex = 0;
+    for (uint32_t workerIndex = 0; workerIndex < workerCount; workerIndex++)
+    {
+        g_workers.emplace_back(workerMain, workerIndex + 1);
+    }
+}
+
+void JobSystem::destroy()
+{
+    {
+        std::lock_guard lock(g_sleepMutex);
+        g_running = false;
+    }
+    g_wakeCondition.notify_all();
+
+    for (std::thread& worker : g_workers)
+    {
+        worker.join();
+    }
+
+    g_workers.clear();
+
+    // Whatever is still queued runs here, so every counter reaches zero and the captures of the jobs are released.
+    // With the workers gone, jobs that submit more work run it inline or leave it in queue 0 for runOne
+    while (true)
+    {
+        if (!g_queues.empty() && runOne(t_queueIndex))
+        {
+            continue;
+        }
+
+        Task task{};
+        if (!popBackground(task))
+        {
+            break;
+        }
+
+        g_queuedTasks.fetch_sub(1, std::memory_order_acq_rel);
+        execute(task);
+    }
+
+    g_queues.clear();
+    g_queuedTasks = 0;
+}
+
+uint32_t JobSystem::defaultWorkerCount()
+{
+    return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+uint32_t JobSystem::workerCount()
+{
+    return static_cast<uint32_t>(g_workers.size());
+}
+
+void JobSystem::submit(Job job, Counter* counter)
+{
+    Task task { std::move(job), counter };
+    if (counter != nullptr)
+    {
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (g_queues.empty())
+    {
+        execute(task);
+        return;
+    }
+
+    // Count the task before it becomes visible so a thief can never take it below zero
+    {
+        std::lock_guard lock(g_sleepMutex);
+        g_queuedTasks.fetch_add(1, std::memory_order_release);
+    }
+
+    Queue& queue = *g_queues[t_queueIndex];
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.emplace_back(std::move(task));
+    }
+    g_wakeCondition.notify_one();
+}
+
+void JobSystem::submitBackground(Job job, Counter* counter)
+{
+    Task task { std::move(job), counter };
+    if (counter != nullptr)
+    {
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (g_workers.empty())
+    {
+        execute(task);
+        return;
+    }
+
+    {
+        std::lock_guard lock(g_sleepMutex);
+        g_queuedTasks.fetch_add(1, std::memory_order_release);
+    }
+
+    {
+        std::lock_guard lock(g_backgroundQueue.mutex);
+        g_backgroundQueue.tasks.emplace_back(std::move(task));
+    }
+    g_wakeCondition.notify_one();
+}
+
+void JobSystem::wait(Counter& counter)
+{
+    while (!isDone(counter))
+    {
+        if (!runOne(t_queueIndex))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    if (counter.failed.load(std::memory_order_relaxed))
+    {
+        counter.failed.store(false, std::memory_order_relaxed);
+        std::rethrow_exception(std::exchange(counter.exception, nullptr));
+    }
+}
+
+bool JobSystem::isDone(const Counter& counter)
+{
+    return counter.pending.load(std::memory_order_acquire) == 0;
+}
+
+void JobSystem::parallelFor(std::size_t count, std::size_t batchSize, const std::function<void(std::size_t begin, std::size_t end)>& fn)
+{
+    batchSize = std::max<std::size_t>(batchSize, 1);
+    if (g_workers.empty() || count <= batchSize)
+    {
+        if (count > 0)
+        {
+            fn(0, count);
+        }
+        return;
+    }
+
+    Counter counter { 0 };
+    for (std::size_t begin = 0; begin < count; begin += batchSize)
+    {
+        const std::size_t end = std::min(begin + batchSize, count);
+        submit([&fn, begin, end]() { fn(begin, end); }, &counter);
+    }
+
+    wait(counter);
+}
+
+void JobSystem::workerMain(uint32_t queueIndex)
+{
+    t_queueIndex = queueIndex;
+    Profiler::setThreadName(fmt::format("Worker {}", queueIndex));
+
+    // Leaves after the current job once destroy() started, which runs everything still queued
+    while (g_running.load(std::memory_order_acquire))
+    {
+        if (runOne(queueIndex))
+        {
+            continue;
+        }
+
+        if (Task task{}; popBackground(task))
+        {
+            g_queuedTasks.fetch_sub(1, std::memory_order_acq_rel);
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock lock(g_sleepMutex);
+        g_wakeCondition.wait(lock, []() { return !g_running || g_queuedTasks.load(std::memory_order_acquire) > 0; });
+    }
+}
+
+bool JobSystem::runOne(uint32_t queueIndex)
+{
+    Task task{};
+    if (!popOwn(queueIndex, task) && !steal(queueIndex, task))
+    {
+        return false;
+    }
+
+    g_queuedTasks.fetch_sub(1, std::memory_order_acq_rel);
+    execute(task);
+    return true;
+}
+
+bool JobSystem::popOwn(uint32_t queueIndex, Task& task)
+{
+    Queue& queue = *g_queues[queueIndex];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty())
+    {
+        return false;
+    }
+
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool JobSystem::steal(uint32_t thiefIndex, Task& task)
+{
+    const std::size_t queueCount = g_queues.size();
+    for (std::size_t offset = 1; offset < queueCount; offset++)
+    {
+        Queue& victim = *g_queues[(thiefIndex + offset) % queueCount];
+        std::lock_guard lock(victim.mutex);
+        if (victim.tasks.empty())
+        {
+            continue;
+        }
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+
+    return false;
+}
+
+bool JobSystem::popBackground(Task& task)
+{
+    std::lock_guard lock(g_backgroundQueue.mutex);
+    if (g_backgroundQueue.tasks.empty())
+    {
+        return false;
+    }
+
+    task = std::move(g_backgroundQueue.tasks.front());
+    g_backgroundQueue.tasks.pop_front();
+    return true;
+}
+
+void JobSystem::execute(Task& task)
+{
+    if (task.counter == nullptr)
+    {
+        task.job();
+        return;
+    }
+
+    try
+    {
+        task.job();
+    }
+    catch (...)
+    {
+        // Only the first exception is kept, the decrement below publishes it to wait()
+        if (!task.counter->failed.exchange(true, std::memory_order_relaxed))
+        {
+            task.counter->exception = std::current_exception();
+        }
+    }
+    task.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
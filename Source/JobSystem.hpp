@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Korelib.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads with one job queue per thread.
+// A thread pops its own newest job first and steals the oldest job of another queue when it runs dry.
+// The thread that called initialize() owns queue 0 and helps out while it waits.
+// Background jobs go to a separate queue that only workers take from, once the per-thread queues are empty,
+// so a long job can never end up running inline inside a wait() on the frame's critical path.
+// An exception thrown by a job is stored in its counter and rethrown by wait(). Jobs submitted without a counter
+// must not throw, on a worker thread that ends in std::terminate like any exception escaping a std::thread.
+// destroy() lets every worker finish its current job and runs the jobs still queued on the calling thread.
+class JobSystem final : public korelib::StaticOnlyClass
+{
+public:
+    using Job = std::function<void()>;
+
+    // Jobs still to run, and the first exception one of them threw
+    struct Counter
+    {
+        std::atomic<uint32_t> pending { 0 };
+        std::atomic<bool> failed { false };
+        std::exception_ptr exception {};
+    };
+
+public:
+    static void initialize(uint32_t workerCount = defaultWorkerCount());
+    static void destroy();
+
+    static uint32_t defaultWorkerCount();
+    static uint32_t workerCount();
+
+    // counter, when provided, is incremented now and decremented once the job has run
+    static void submit(Job job, Counter* counter = nullptr);
+    // Low priority work that may span frames, poll the counter with isDone() instead of waiting on it.
+    // Runs inline when there are no workers.
+    static void submitBackground(Job job, Counter* counter = nullptr);
+    // Helps out until every job of counter ran, then rethrows the first exception of them, if any
+    static void wait(Counter& counter);
+    static bool isDone(const Counter& counter);
+
+    // Splits [0, count) into ranges of at most batchSize and blocks until fn ran for all of them
+    static void parallelFor(std::size_t count, std::size_t batchSize, const std::function<void(std::size_t begin, std::size_t end)>& fn);
+
+private:
+    struct Task
+    {
+        Job job;
+        Counter* counter;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    static void workerMain(uint32_t queueIndex);
+    static bool runOne(uint32_t queueIndex);
+    static bool popOwn(uint32_t queueIndex, Task& task);
+    static bool steal(uint32_t thiefIndex, Task& task);
+    static bool popBackground(Task& task);
+    static void execute(Task& task);
+
+private:
+    static inline std::vector<std::unique_ptr<Queue>> g_queues {};
+    static inline Queue g_backgroundQueue {};
+    static inline std::vector<std::thread> g_workers {};
+    static inline std::atomic<bool> g_running { false };
+    static inline std::atomic<uint32_t> g_queuedTasks { 0 };
+    static inline std::mutex g_sleepMutex {};
+    static inline std::condition_variable g_wakeCondition {};
+    static inline thread_local uint32_t t_queueIndex { 0 };
+};
@@ -0,0 +1,137 @@
+#include "Mesh.hpp"
+#include "MeshOptimizer.hpp"
+
+#include "fmt/format.h"
+
+#include <cstddef>
+
+Mesh::Mesh(std::vector<Gfx::Vertex> vertices, std::vector<std::array<uint32_t, 3>> triangles) :
+    m_vertices(std::move(vertices)),
+    m_vertexStride(sizeof(Gfx::Vertex)),
+    m_triangles(std::move(triangles)),
+    m_positionTransform(1.0f),
+    m_hasPositionTransform(false),
+    m_vertexBufferObject(Gfx::createVertexBufferObject()),
+    m_elementBufferObject(Gfx::createElementBufferObject()),
+    m_vertexArrayObject(Gfx::createVertexArrayObject())
+{
+    Gfx::updateVertexBufferData(m_vertexBufferObject, m_vertices);
+    Gfx::updateElementBufferData(m_vertexArrayObject, m_elementBufferObject, m_triangles);
+    Gfx::setupVertexArray(m_vertexArrayObject, m_vertexBufferObject, m_elementBufferObject, vertexLayout());
+
+    for (const Gfx::Vertex& vertex : m_vertices)
+    {
+        m_bounds.expand(vertex.position);
+    }
+}
+
+Mesh::Mesh(std::vector<std::byte> vertexData, uint32_t vertexStride, std::span<const Gfx::Attribute> layout, std::vector<std::array<uint32_t, 3>> triangles, const AABB& bounds,
+           const glm::mat4& positionTransform) :
+    m_vertexData(std::move(vertexData)),
+    m_vertexStride(vertexStride),
+    m_triangles(std::move(triangles)),
+    m_bounds(bounds),
+    m_positionTransform(positionTransform),
+    m_hasPositionTransform(positionTransform != glm::mat4(1.0f)),
+    m_vertexBufferObject(Gfx::createVertexBufferObject()),
+    m_elementBufferObject(Gfx::createElementBufferObject()),
+    m_vertexArrayObject(Gfx::createVertexArrayObject())
+{
+    KORELIB_VERIFY_THROW(vertexStride > 0 && m_vertexData.size() % vertexStride == 0, korelib::RuntimeException, fmt::format("Vertex data of {} bytes is no multiple of the {} byte stride", m_vertexData.size(), vertexStride));
+
+    Gfx::updateVertexBufferData(m_vertexBufferObject, m_vertexData);
+    Gfx::updateElementBufferData(m_vertexArrayObject, m_elementBufferObject, m_triangles);
+    Gfx::setupVertexArray(m_vertexArrayObject, m_vertexBufferObject, m_elementBufferObject, layout);
+}
+
+Mesh::~Mesh()
+{
+    Gfx::destroyVertexArrayObject(m_vertexArrayObject);
+    Gfx::destroyBufferObject(m_elementBufferObject);
+    Gfx::destroyBufferObject(m_vertexBufferObject);
+}
+
+std::span<const Gfx::Attribute> Mesh::vertexLayout()
+{
+    static constexpr std::array<Gfx::Attribute, 2> attributes
+    {{
+        {
+            .index = 0,
+            .numComponents = 3,
+            .stride = sizeof(Gfx::Vertex),
+            .type = Gfx::Attribute::Type::FLOAT,
+            .offset = offsetof(Gfx::Vertex, position),
+            .aligned = false
+        },
+        {
+            .index = 1,
+            .numComponents = 2,
+            .stride = sizeof(Gfx::Vertex),
+            .type = Gfx::Attribute::Type::FLOAT,
+            .offset = offsetof(Gfx::Vertex, uv),
+            .aligned = false
+        }
+    }};
+
+    return attributes;
+}
+
+std::shared_ptr<Mesh> Mesh::quantized(const Mesh& mesh)
+{
+    KORELIB_VERIFY_THROW(!mesh.getVertices().empty(), korelib::RuntimeException, "Only meshes made of Gfx::Vertex can be quantized");
+
+    const MeshOptimizer::QuantizedVertices quantized = MeshOptimizer::quantize(mesh.getVertices());
+    const std::span<const std::byte> vertexData = std::as_bytes(std::span(quantized.vertices));
+    return std::make_shared<Mesh>(std::vector<std::byte>(vertexData.begin(), vertexData.end()), static_cast<uint32_t>(sizeof(MeshOptimizer::QuantizedVertex)), MeshOptimizer::quantizedVertexLayout(),
+                                  mesh.getTriangles(), quantized.bounds, quantized.positionTransform);
+}
+
+const std::vector<Gfx::Vertex>& Mesh::getVertices() const
+{
+    return m_vertices;
+}
+
+std::span<const std::byte> Mesh::getVertexData() const
+{
+    return m_vertexData.empty() ? std::as_bytes(std::span(m_vertices)) : std::span<const std::byte>(m_vertexData);
+}
+
+uint32_t Mesh::getVertexStride() const
+{
+    return m_vertexStride;
+}
+
+uint32_t Mesh::getVertexCount() const
+{
+    return static_cast<uint32_t>(getVertexData().size() / m_vertexStride);
+}
+
+const std::vector<std::array<uint32_t, 3>>& Mesh::getTriangles() const
+{
+    return m_triangles;
+}
+
+uint32_t Mesh::getIndexCount() const
+{
+    return static_cast<uint32_t>(m_triangles.size() * 3);
+}
+
+const AABB& Mesh::getBounds() const
+{
+    return m_bounds;
+}
+
+const glm::mat4& Mesh::getPositionTransform() const
+{
+    return m_positionTransform;
+}
+
+bool Mesh::hasPositionTransform() const
+{
+    return m_hasPositionTransform;
+}
+
+Gfx::VertexArrayObjectType Mesh::getVertexArrayObject() const
+{
+    return m_vertexArrayObject;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Gfx.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Indexed triangle mesh living in GPU buffers.
+// Vertices and indices are uploaded once on construction and the attribute layout is baked into the vertex array,
+// so drawing only needs to bind vertexArrayObject(). The CPU copy is kept for processing on the CPU side.
+// Vertices are Gfx::Vertex unless the mesh was built from raw vertex data with its own layout.
+class Mesh
+{
+public:
+    Mesh(std::vector<Gfx::Vertex> vertices, std::vector<std::array<uint32_t, 3>> triangles);
+    // layout describes one vertex of vertexStride bytes, bounds are taken as given since positions may be encoded.
+    // positionTransform maps the positions the shader reads into object space, renderers apply it before the model matrix.
+    Mesh(std::vector<std::byte> vertexData, uint32_t vertexStride, std::span<const Gfx::Attribute> layout, std::vector<std::array<uint32_t, 3>> triangles, const AABB& bounds,
+         const glm::mat4& positionTransform = glm::mat4(1.0f));
+    ~Mesh();
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    static std::span<const Gfx::Attribute> vertexLayout();
+    // Copy of a Gfx::Vertex mesh with MeshOptimizer::QuantizedVertex vertices, the triangles are kept as they are
+    static std::shared_ptr<Mesh> quantized(const Mesh& mesh);
+
+    // Empty for meshes built from raw vertex data
+    const std::vector<Gfx::Vertex>& getVertices() const;
+    std::span<const std::byte> getVertexData() const;
+    uint32_t getVertexStride() const;
+    uint32_t getVertexCount() const;
+    const std::vector<std::array<uint32_t, 3>>& getTriangles() const;
+    uint32_t getIndexCount() const;
+    // Object space bounds of every vertex
+    const AABB& getBounds() const;
+    const glm::mat4& getPositionTransform() const;
+    bool hasPositionTransform() const;
+
+    Gfx::VertexArrayObjectType getVertexArrayObject() const;
+
+private:
+    std::vector<Gfx::Vertex> m_vertices;
+    std::vector<std::byte> m_vertexData;
+    uint32_t m_vertexStride;
+    std::vector<std::array<uint32_t, 3>> m_triangles;
+    AABB m_bounds;
+    glm::mat4 m_positionTransform;
+    bool m_hasPositionTransform;
+
+    Gfx::VertexBufferObjectType m_vertexBufferObject;
+    Gfx::ElementBufferObjectType m_elementBufferObject;
+    Gfx::VertexArrayObjectType m_vertexArrayObject;
+};
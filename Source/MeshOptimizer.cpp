@@ -0,0 +1,348 @@
+#include "MeshOptimizer.hpp"
+#include "Profiler.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+namespace
+{
+    constexpr float UNORM16_MAX = 65535.0f;
+
+    uint16_t toUnorm16(float value)
+    {
+        return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * UNORM16_MAX));
+    }
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(std::span<const std::array<uint32_t, 3>> triangles, std::size_t vertexCount, uint32_t cacheSize)
+{
+    // A vertex is cached while fewer than cacheSize misses happened since it was loaded
+    std::vector<uint32_t> loadedAt(vertexCount, 0);
+    uint32_t misses = 0;
+    uint32_t referenced = 0;
+    for (const std::array<uint32_t, 3>& triangle : triangles)
+    {
+        for (uint32_t index : triangle)
+        {
+            if (loadedAt[index] != 0 && misses - loadedAt[index] < cacheSize)
+            {
+                continue;
+            }
+
+            referenced += loadedAt[index] == 0 ? 1 : 0;
+            loadedAt[index] = ++misses;
+        }
+    }
+
+    return {
+        .triangles = static_cast<uint32_t>(triangles.size()),
+        .transformedVertices = misses,
+        .acmr = triangles.empty() ? 0.0f : static_cast<float>(misses) / static_cast<float>(triangles.size()),
+        .atvr = referenced == 0 ? 0.0f : static_cast<float>(misses) / static_cast<float>(referenced)
+    };
+}
+
+void MeshOptimizer::optimizeVertexCache(std::span<std::array<uint32_t, 3>> triangles, std::size_t vertexCount, uint32_t cacheSize)
+{
+    PROFILE_ZONE("MeshOptimizer::optimizeVertexCache");
+    if (triangles.empty())
+    {
+        return;
+    }
+
+    // Triangles around every vertex, and how many of them are still to be emitted
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (const std::array<uint32_t, 3>& triangle : triangles)
+    {
+        for (uint32_t index : triangle)
+        {
+            adjacencyOffsets[index + 1]++;
+        }
+    }
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+    std::vector<uint32_t> adjacency(triangles.size() * 3);
+    std::vector<uint32_t> live(vertexCount, 0);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t triangleIndex = 0; triangleIndex < triangles.size(); triangleIndex++)
+        {
+            for (uint32_t index : triangles[triangleIndex])
+            {
+                adjacency[fill[index]++] = triangleIndex;
+                live[index]++;
+            }
+        }
+    }
+
+    std::vector<std::array<uint32_t, 3>> ordered{};
+    ordered.reserve(triangles.size());
+    std::vector<uint8_t> emitted(triangles.size(), 0);
+    // Same FIFO model as analyzeVertexCache, a vertex is cached while time - cacheTime <= cacheSize
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    // Vertices of emitted triangles, newest last, to continue from when the fan runs out of good candidates
+    std::vector<uint32_t> deadEnd{};
+    std::vector<uint32_t> candidates{};
+    uint32_t cursor = 0;
+
+    int64_t fan = triangles[0][0];
+    while (fan >= 0)
+    {
+        candidates.clear();
+        for (uint32_t adjacencyIndex = adjacencyOffsets[fan]; adjacencyIndex < adjacencyOffsets[fan + 1]; adjacencyIndex++)
+        {
+            const uint32_t triangleIndex = adjacency[adjacencyIndex];
+            if (emitted[triangleIndex] != 0)
+            {
+                continue;
+            }
+
+            emitted[triangleIndex] = 1;
+            ordered.push_back(triangles[triangleIndex]);
+            for (uint32_t index : triangles[triangleIndex])
+            {
+                deadEnd.push_back(index);
+                candidates.push_back(index);
+                live[index]--;
+                if (time - cacheTime[index] > cacheSize)
+                {
+                    cacheTime[index] = time++;
+                }
+            }
+        }
+
+        // Next fan: the candidate that stays in the cache while its remaining triangles are emitted, oldest first
+        fan = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t candidate : candidates)
+        {
+            if (live[candidate] == 0)
+            {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if (time - cacheTime[candidate] + 2 * live[candidate] <= cacheSize)
+            {
+                priority = time - cacheTime[candidate];
+            }
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fan = candidate;
+            }
+        }
+
+        // Otherwise the most recent vertex that still has triangles, then the next one in index order
+        while (fan < 0 && !deadEnd.empty())
+        {
+            const uint32_t candidate = deadEnd.back();
+            deadEnd.pop_back();
+            fan = live[candidate] > 0 ? static_cast<int64_t>(candidate) : -1;
+        }
+        while (fan < 0 && cursor < vertexCount)
+        {
+            fan = live[cursor] > 0 ? static_cast<int64_t>(cursor) : -1;
+            cursor++;
+        }
+    }
+
+    std::copy(ordered.begin(), ordered.end(), triangles.begin());
+}
+
+void MeshOptimizer::optimizeOverdraw(std::span<std::array<uint32_t, 3>> triangles, std::span<const Gfx::Vertex> vertices, uint32_t cacheSize)
+{
+    PROFILE_ZONE("MeshOptimizer::optimizeOverdraw");
+    if (triangles.empty())
+    {
+        return;
+    }
+
+    // A cluster starts wherever all three vertices of a triangle miss the cache, the cache order jumped there anyway
+    std::vector<uint32_t> clusterStarts{ 0 };
+    {
+        std::vector<uint32_t> loadedAt(vertices.size(), 0);
+        uint32_t misses = 0;
+        for (uint32_t triangleIndex = 0; triangleIndex < triangles.size(); triangleIndex++)
+        {
+            uint32_t triangleMisses = 0;
+            for (uint32_t index : triangles[triangleIndex])
+            {
+                if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize)
+                {
+                    loadedAt[index] = ++misses;
+                    triangleMisses++;
+                }
+            }
+            if (triangleMisses == 3 && triangleIndex != 0)
+            {
+                clusterStarts.push_back(triangleIndex);
+            }
+        }
+    }
+    clusterStarts.push_back(static_cast<uint32_t>(triangles.size()));
+    const std::size_t clusterCount = clusterStarts.size() - 1;
+
+    // Area weighted centroid and normal of every cluster and of the whole mesh
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (std::size_t cluster = 0; cluster < clusterCount; cluster++)
+    {
+        float clusterArea = 0.0f;
+        for (uint32_t triangleIndex = clusterStarts[cluster]; triangleIndex < clusterStarts[cluster + 1]; triangleIndex++)
+        {
+            const std::array<uint32_t, 3>& triangle = triangles[triangleIndex];
+            const glm::vec3& p0 = vertices[triangle[0]].position;
+            const glm::vec3& p1 = vertices[triangle[1]].position;
+            const glm::vec3& p2 = vertices[triangle[2]].position;
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(normal) * 0.5f;
+
+            clusterCentroids[cluster] = clusterCentroids[cluster] + (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormals[cluster] = clusterNormals[cluster] + normal;
+            clusterArea += area;
+        }
+
+        meshCentroid = meshCentroid + clusterCentroids[cluster];
+        meshArea += clusterArea;
+        clusterCentroids[cluster] = clusterArea > 0.0f ? clusterCentroids[cluster] / clusterArea : glm::vec3(0.0f);
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    // Clusters far out along their own normal are likely on the hull and occlude the rest, so they go first
+    std::vector<float> keys(clusterCount, 0.0f);
+    for (std::size_t cluster = 0; cluster < clusterCount; cluster++)
+    {
+        const float normalLength = glm::length(clusterNormals[cluster]);
+        keys[cluster] = normalLength > 0.0f ? glm::dot(clusterCentroids[cluster] - meshCentroid, clusterNormals[cluster] / normalLength) : 0.0f;
+    }
+
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0u);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+    std::vector<std::array<uint32_t, 3>> ordered{};
+    ordered.reserve(triangles.size());
+    for (uint32_t cluster : clusterOrder)
+    {
+        ordered.insert(ordered.end(), triangles.begin() + clusterStarts[cluster], triangles.begin() + clusterStarts[cluster + 1]);
+    }
+    std::copy(ordered.begin(), ordered.end(), triangles.begin());
+}
+
+std::vector<uint32_t> MeshOptimizer::vertexFetchRemap(std::span<const std::array<uint32_t, 3>> triangles, std::size_t vertexCount)
+{
+    std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    uint32_t next = 0;
+    for (const std::array<uint32_t, 3>& triangle : triangles)
+    {
+        for (uint32_t index : triangle)
+        {
+            if (remap[index] == UINT32_MAX)
+            {
+                remap[index] = next++;
+            }
+        }
+    }
+
+    return remap;
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Gfx::Vertex>& vertices, std::span<std::array<uint32_t, 3>> triangles)
+{
+    PROFILE_ZONE("MeshOptimizer::optimizeVertexFetch");
+
+    const std::vector<uint32_t> remap = vertexFetchRemap(triangles, vertices.size());
+    std::vector<Gfx::Vertex> ordered(vertices.size() - static_cast<std::size_t>(std::count(remap.begin(), remap.end(), UINT32_MAX)));
+    for (std::size_t vertexIndex = 0; vertexIndex < vertices.size(); vertexIndex++)
+    {
+        if (remap[vertexIndex] != UINT32_MAX)
+        {
+            ordered[remap[vertexIndex]] = vertices[vertexIndex];
+        }
+    }
+
+    for (std::array<uint32_t, 3>& triangle : triangles)
+    {
+        for (uint32_t& index : triangle)
+        {
+            index = remap[index];
+        }
+    }
+    vertices = std::move(ordered);
+}
+
+void MeshOptimizer::optimize(std::vector<Gfx::Vertex>& vertices, std::span<std::array<uint32_t, 3>> triangles)
+{
+    optimizeVertexCache(triangles, vertices.size());
+    optimizeOverdraw(triangles, vertices);
+    optimizeVertexFetch(vertices, triangles);
+}
+
+MeshOptimizer::QuantizedVertices MeshOptimizer::quantize(std::span<const Gfx::Vertex> vertices)
+{
+    PROFILE_ZONE("MeshOptimizer::quantize");
+
+    QuantizedVertices result{ .vertices = {}, .bounds = {}, .positionTransform = glm::mat4(1.0f) };
+    for (const Gfx::Vertex& vertex : vertices)
+    {
+        result.bounds.expand(vertex.position);
+        KORELIB_VERIFY_THROW(vertex.uv.x >= 0.0f && vertex.uv.x <= 1.0f && vertex.uv.y >= 0.0f && vertex.uv.y <= 1.0f, korelib::RuntimeException,
+            fmt::format("UV ({}, {}) is outside [0, 1] and can't be stored as unorm16", vertex.uv.x, vertex.uv.y));
+    }
+    if (vertices.empty())
+    {
+        return result;
+    }
+
+    // Flat axes keep a scale of 1 so the division stays defined, every vertex sits at 0 there
+    const glm::vec3 size = result.bounds.max - result.bounds.min;
+    const glm::vec3 scale(size.x > 0.0f ? size.x : 1.0f, size.y > 0.0f ? size.y : 1.0f, size.z > 0.0f ? size.z : 1.0f);
+
+    result.vertices.reserve(vertices.size());
+    for (const Gfx::Vertex& vertex : vertices)
+    {
+        const glm::vec3 normalized = (vertex.position - result.bounds.min) / scale;
+        result.vertices.push_back({
+            .position = { toUnorm16(normalized.x), toUnorm16(normalized.y), toUnorm16(normalized.z), 0 },
+            .uv = { toUnorm16(vertex.uv.x), toUnorm16(vertex.uv.y) }
+        });
+    }
+
+    result.positionTransform[0][0] = scale.x;
+    result.positionTransform[1][1] = scale.y;
+    result.positionTransform[2][2] = scale.z;
+    result.positionTransform[3] = glm::vec4(result.bounds.min, 1.0f);
+    return result;
+}
+
+std::span<const Gfx::Attribute> MeshOptimizer::quantizedVertexLayout()
+{
+    static constexpr std::array<Gfx::Attribute, 2> attributes
+    {{
+        {
+            .index = 0,
+            .numComponents = 3,
+            .stride = sizeof(QuantizedVertex),
+            .type = Gfx::Attribute::Type::UNSIGNED_SHORT,
+            .offset = offsetof(QuantizedVertex, position),
+            .aligned = true
+        },
+        {
+            .index = 1,
+            .numComponents = 2,
+            .stride = sizeof(QuantizedVertex),
+            .type = Gfx::Attribute::Type::UNSIGNED_SHORT,
+            .offset = offsetof(QuantizedVertex, uv),
+            .aligned = true
+        }
+    }};
+
+    return attributes;
+}
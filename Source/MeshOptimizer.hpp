@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Gfx.hpp"
+#include "Korelib.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Reorders and packs indexed meshes for the GPU, CPU only.
+//   vertex cache: Tipsify (Sander et al. 2007), fans around recently used vertices so the post-transform cache hits
+//   overdraw: sorts the clusters the cache order leaves behind so outward facing ones on the hull are drawn first
+//   vertex fetch: renumbers vertices in the order the triangles use them, so fetches walk the buffer forwards
+//   quantization: unorm16 positions inside the bounds and unorm16 UVs, 12 instead of 20 bytes per vertex
+class MeshOptimizer final : public korelib::StaticOnlyClass
+{
+public:
+    // Post-transform cache of current GPUs behaves roughly like a FIFO of this many vertices
+    static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+    struct CacheStats
+    {
+        uint32_t triangles;
+        uint32_t transformedVertices;
+        // Average cache miss ratio, vertex shader runs per triangle. 0.5 is the limit for large regular meshes, 3 the worst.
+        float acmr;
+        // Average transform to vertex ratio, vertex shader runs per referenced vertex. 1 is ideal.
+        float atvr;
+    };
+
+    // Positions are relative to the bounds, w is padding that keeps the vertex 4 byte aligned
+    struct QuantizedVertex
+    {
+        std::array<uint16_t, 4> position;
+        std::array<uint16_t, 2> uv;
+    };
+
+    static_assert(sizeof(QuantizedVertex) == 12);
+
+    struct QuantizedVertices
+    {
+        std::vector<QuantizedVertex> vertices;
+        AABB bounds;
+        // Maps the unorm positions the shader reads back into object space
+        glm::mat4 positionTransform;
+    };
+
+public:
+    // Simulates a FIFO cache over the index order
+    static CacheStats analyzeVertexCache(std::span<const std::array<uint32_t, 3>> triangles, std::size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+    static void optimizeVertexCache(std::span<std::array<uint32_t, 3>> triangles, std::size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+    // Expects triangles in cache order, only moves whole clusters so the cache efficiency stays the same
+    static void optimizeOverdraw(std::span<std::array<uint32_t, 3>> triangles, std::span<const Gfx::Vertex> vertices, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+    // New index of every vertex in order of first use, UINT32_MAX for vertices no triangle uses
+    static std::vector<uint32_t> vertexFetchRemap(std::span<const std::array<uint32_t, 3>> triangles, std::size_t vertexCount);
+    // Applies vertexFetchRemap to both and drops unused vertices
+    static void optimizeVertexFetch(std::vector<Gfx::Vertex>& vertices, std::span<std::array<uint32_t, 3>> triangles);
+    // Cache, overdraw and fetch order in one go
+    static void optimize(std::vector<Gfx::Vertex>& vertices, std::span<std::array<uint32_t, 3>> triangles);
+
+    // UVs have to lie in [0, 1], which holds for atlas remapped and primitive meshes
+    static QuantizedVertices quantize(std::span<const Gfx::Vertex> vertices);
+    static std::span<const Gfx::Attribute> quantizedVertexLayout();
+};
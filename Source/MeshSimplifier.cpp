@@ -0,0 +1,354 @@
+#include "MeshSimplifier.hpp"
+#include "Bounds.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+    // Sum of squared distances to weighted planes, the symmetric 4x4 matrix stored as its 10 unique entries.
+    // Q(p) = p^T A p + 2 b.p + c
+    struct Quadric
+    {
+        float a00, a01, a02, a11, a12, a22;
+        float b0, b1, b2;
+        float c;
+        float weight;
+
+        static Quadric fromPlane(const glm::vec3& normal, float distance, float weight)
+        {
+            return {
+                .a00 = weight * normal.x * normal.x, .a01 = weight * normal.x * normal.y, .a02 = weight * normal.x * normal.z,
+                .a11 = weight * normal.y * normal.y, .a12 = weight * normal.y * normal.z, .a22 = weight * normal.z * normal.z,
+                .b0 = weight * normal.x * distance, .b1 = weight * normal.y * distance, .b2 = weight * normal.z * distance,
+                .c = weight * distance * distance,
+                .weight = weight
+            };
+        }
+
+        void add(const Quadric& other)
+        {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02;
+            a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+        }
+
+        // Mean squared distance of p to the planes
+        float evaluate(const glm::vec3& p) const
+        {
+            const float rx = a00 * p.x + a01 * p.y + a02 * p.z + 2.0f * b0;
+            const float ry = a01 * p.x + a11 * p.y + a12 * p.z + 2.0f * b1;
+            const float rz = a02 * p.x + a12 * p.y + a22 * p.z + 2.0f * b2;
+            const float error = p.x * rx + p.y * ry + p.z * rz + c;
+            return weight > 0.0f ? std::max(error, 0.0f) / weight : 0.0f;
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float cost;
+    };
+
+    float extentOf(std::span<const Gfx::Vertex> vertices)
+    {
+        AABB bounds{};
+        for (const Gfx::Vertex& vertex : vertices)
+        {
+            bounds.expand(vertex.position);
+        }
+
+        const glm::vec3 size = bounds.isEmpty() ? glm::vec3(0.0f) : bounds.max - bounds.min;
+        const float extent = std::max(size.x, std::max(size.y, size.z));
+        return extent > 0.0f ? extent : 1.0f;
+    }
+
+    uint64_t edgeKey(uint32_t a, uint32_t b)
+    {
+        return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+    }
+}
+
+MeshSimplifier::Result MeshSimplifier::simplify(std::span<const Gfx::Vertex> vertices, std::span<const std::array<uint32_t, 3>> triangles, std::size_t targetTriangleCount, float targetError)
+{
+    PROFILE_ZONE("MeshSimplifier::simplify");
+
+    Result result{ .vertices = {}, .triangles = { triangles.begin(), triangles.end() }, .error = 0.0f };
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+    // Positions scaled into the unit cube keep the quadrics well conditioned and the error relative to the extent
+    AABB bounds{};
+    for (const Gfx::Vertex& vertex : vertices)
+    {
+        bounds.expand(vertex.position);
+    }
+    const float extent = extentOf(vertices);
+    std::vector<glm::vec3> positions(vertexCount);
+    for (uint32_t vertexIndex = 0; vertexIndex < vertexCount; vertexIndex++)
+    {
+        positions[vertexIndex] = (vertices[vertexIndex].position - bounds.min) / extent;
+    }
+
+    // Vertices split by a UV seam share a position, welded maps each of them to the first one of its position
+    std::vector<uint32_t> welded(vertexCount);
+    std::vector<uint8_t> locked(vertexCount, 0);
+    {
+        std::vector<uint32_t> order(vertexCount);
+        std::iota(order.begin(), order.end(), 0u);
+        const auto lessPosition = [&positions](uint32_t a, uint32_t b)
+        {
+            const glm::vec3& pa = positions[a];
+            const glm::vec3& pb = positions[b];
+            return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+        };
+        std::sort(order.begin(), order.end(), lessPosition);
+
+        for (uint32_t first = 0; first < vertexCount;)
+        {
+            uint32_t last = first + 1;
+            while (last < vertexCount && !lessPosition(order[first], order[last]))
+            {
+                last++;
+            }
+            for (uint32_t member = first; member < last; member++)
+            {
+                welded[order[member]] = order[first];
+                // Moving one side of a seam would tear the UVs apart
+                locked[order[member]] = last - first > 1 ? 1 : 0;
+            }
+            first = last;
+        }
+    }
+
+    // Open borders and non-manifold edges keep their vertices, collapsing them would shrink holes and outlines
+    {
+        std::unordered_map<uint64_t, uint32_t> edgeUses{};
+        edgeUses.reserve(result.triangles.size() * 3);
+        for (const std::array<uint32_t, 3>& triangle : result.triangles)
+        {
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                edgeUses[edgeKey(welded[triangle[corner]], welded[triangle[(corner + 1) % 3]])]++;
+            }
+        }
+
+        for (const auto& [edge, uses] : edgeUses)
+        {
+            if (uses != 2)
+            {
+                locked[static_cast<uint32_t>(edge >> 32)] = 1;
+                locked[static_cast<uint32_t>(edge & 0xFFFFFFFFu)] = 1;
+            }
+        }
+        for (uint32_t vertexIndex = 0; vertexIndex < vertexCount; vertexIndex++)
+        {
+            locked[vertexIndex] |= locked[welded[vertexIndex]];
+        }
+    }
+
+    // Area weighted planes of the triangles around each position
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (const std::array<uint32_t, 3>& triangle : result.triangles)
+    {
+        const glm::vec3& p0 = positions[triangle[0]];
+        glm::vec3 normal = glm::cross(positions[triangle[1]] - p0, positions[triangle[2]] - p0);
+        const float doubleArea = glm::length(normal);
+        if (doubleArea <= 0.0f)
+        {
+            continue;
+        }
+
+        normal = normal / doubleArea;
+        const Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5f);
+        for (uint32_t index : triangle)
+        {
+            quadrics[welded[index]].add(plane);
+        }
+    }
+
+    const float maxCost = targetError * targetError;
+    float appliedCost = 0.0f;
+    std::vector<Collapse> collapses{};
+    std::vector<uint32_t> adjacencyOffsets{};
+    std::vector<uint32_t> adjacency{};
+    std::vector<uint8_t> touched{};
+
+    // Each pass applies the cheapest collapses whose neighbourhoods don't overlap, then rebuilds the triangle list
+    while (result.triangles.size() > targetTriangleCount)
+    {
+        collapses.clear();
+        for (const std::array<uint32_t, 3>& triangle : result.triangles)
+        {
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                const uint32_t a = triangle[corner];
+                const uint32_t b = triangle[(corner + 1) % 3];
+                if (locked[a] == 0)
+                {
+                    collapses.push_back({ .from = a, .to = b, .cost = quadrics[a].evaluate(positions[b]) });
+                }
+                if (locked[b] == 0)
+                {
+                    collapses.push_back({ .from = b, .to = a, .cost = quadrics[b].evaluate(positions[a]) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        adjacencyOffsets.assign(vertexCount + 1, 0);
+        for (const std::array<uint32_t, 3>& triangle : result.triangles)
+        {
+            for (uint32_t index : triangle)
+            {
+                adjacencyOffsets[index + 1]++;
+            }
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(result.triangles.size() * 3);
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t triangleIndex = 0; triangleIndex < result.triangles.size(); triangleIndex++)
+            {
+                for (uint32_t index : result.triangles[triangleIndex])
+                {
+                    adjacency[fill[index]++] = triangleIndex;
+                }
+            }
+        }
+
+        touched.assign(vertexCount, 0);
+        const std::size_t removable = result.triangles.size() - targetTriangleCount;
+        std::size_t removed = 0;
+        uint32_t applied = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.cost > maxCost || removed >= removable)
+            {
+                break;
+            }
+            if (touched[collapse.from] != 0 || touched[welded[collapse.to]] != 0)
+            {
+                continue;
+            }
+
+            // Triangles around from that survive must not turn over or tilt by more than about 75 degrees
+            const std::span<const uint32_t> around(adjacency.data() + adjacencyOffsets[collapse.from], adjacencyOffsets[collapse.from + 1] - adjacencyOffsets[collapse.from]);
+            bool flips = false;
+            uint32_t collapsing = 0;
+            for (uint32_t triangleIndex : around)
+            {
+                const std::array<uint32_t, 3>& triangle = result.triangles[triangleIndex];
+                if (welded[triangle[0]] == welded[collapse.to] || welded[triangle[1]] == welded[collapse.to] || welded[triangle[2]] == welded[collapse.to])
+                {
+                    collapsing++;
+                    continue;
+                }
+
+                std::array<glm::vec3, 3> corners{ positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+                const glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    if (triangle[corner] == collapse.from)
+                    {
+                        corners[corner] = positions[collapse.to];
+                    }
+                }
+                const glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+                {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips)
+            {
+                continue;
+            }
+
+            for (uint32_t triangleIndex : around)
+            {
+                for (uint32_t index : result.triangles[triangleIndex])
+                {
+                    touched[welded[index]] = 1;
+                }
+            }
+
+            for (uint32_t triangleIndex : around)
+            {
+                for (uint32_t& index : result.triangles[triangleIndex])
+                {
+                    index = index == collapse.from ? collapse.to : index;
+                }
+            }
+            quadrics[welded[collapse.to]].add(quadrics[collapse.from]);
+            appliedCost = std::max(appliedCost, collapse.cost);
+            removed += collapsing;
+            applied++;
+        }
+
+        std::erase_if(result.triangles, [&welded](const std::array<uint32_t, 3>& triangle)
+        {
+            return welded[triangle[0]] == welded[triangle[1]] || welded[triangle[1]] == welded[triangle[2]] || welded[triangle[0]] == welded[triangle[2]];
+        });
+
+        if (applied == 0)
+        {
+            break;
+        }
+    }
+
+    // Only the vertices still referenced, in order of first use
+    std::vector<uint32_t> compacted(vertexCount, UINT32_MAX);
+    for (std::array<uint32_t, 3>& triangle : result.triangles)
+    {
+        for (uint32_t& index : triangle)
+        {
+            if (compacted[index] == UINT32_MAX)
+            {
+                compacted[index] = static_cast<uint32_t>(result.vertices.size());
+                result.vertices.push_back(vertices[index]);
+            }
+            index = compacted[index];
+        }
+    }
+
+    result.error = std::sqrt(appliedCost) * extent;
+    return result;
+}
+
+std::vector<MeshSimplifier::Result> MeshSimplifier::buildLodChain(std::span<const Gfx::Vertex> vertices, std::span<const std::array<uint32_t, 3>> triangles, const LodSettings& settings)
+{
+    PROFILE_ZONE("MeshSimplifier::buildLodChain");
+
+    const float errorBudget = settings.maxError * extentOf(vertices);
+    std::vector<Result> levels{};
+    levels.reserve(settings.maxLevels);
+
+    float accumulatedError = 0.0f;
+    std::span<const Gfx::Vertex> levelVertices = vertices;
+    std::span<const std::array<uint32_t, 3>> levelTriangles = triangles;
+    while (levels.size() < settings.maxLevels && errorBudget > accumulatedError)
+    {
+        const std::size_t target = static_cast<std::size_t>(static_cast<float>(levelTriangles.size()) * settings.reduction);
+        Result level = simplify(levelVertices, levelTriangles, target, (errorBudget - accumulatedError) / extentOf(levelVertices));
+        if (level.triangles.empty() || static_cast<float>(level.triangles.size()) > static_cast<float>(levelTriangles.size()) * settings.minReduction)
+        {
+            break;
+        }
+
+        // Errors of consecutive levels add up, each one is measured against the level before
+        accumulatedError += level.error;
+        level.error = accumulatedError;
+        levels.push_back(std::move(level));
+        levelVertices = levels.back().vertices;
+        levelTriangles = levels.back().triangles;
+    }
+
+    return levels;
+}
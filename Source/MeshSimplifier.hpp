@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Gfx.hpp"
+#include "Korelib.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Quadric error metric simplification (Garland/Heckbert) for Gfx::Vertex meshes.
+// Edges are collapsed onto one of their endpoints, so every remaining vertex keeps its original position and UV and
+// the result never needs new attributes. The error of a collapse is the squared distance of the removed vertex to the
+// planes of the triangles it was merged into. Vertices on UV seams and open borders are locked.
+// Pure CPU work, LOD chains can be built on any thread and uploaded later.
+class MeshSimplifier final : public korelib::StaticOnlyClass
+{
+public:
+    struct Result
+    {
+        std::vector<Gfx::Vertex> vertices;
+        std::vector<std::array<uint32_t, 3>> triangles;
+        // Largest distance between the simplified and the original surface, in object space units
+        float error;
+    };
+
+    struct LodSettings
+    {
+        // Triangle count of each level relative to the previous one
+        float reduction { 0.5f };
+        // Levels after the original mesh
+        uint32_t maxLevels { 4 };
+        // Stops once a level would move the surface further than this, relative to the mesh extent
+        float maxError { 0.1f };
+        // Stops once a level can't get below this share of the previous triangle count
+        float minReduction { 0.85f };
+    };
+
+public:
+    // Collapses edges cheapest first until targetTriangleCount is reached or the next collapse would exceed targetError,
+    // which is relative to the mesh extent
+    static Result simplify(std::span<const Gfx::Vertex> vertices, std::span<const std::array<uint32_t, 3>> triangles, std::size_t targetTriangleCount, float targetError);
+
+    // Every level is simplified from the previous one and carries the accumulated error, the original mesh is not part of it
+    static std::vector<Result> buildLodChain(std::span<const Gfx::Vertex> vertices, std::span<const std::array<uint32_t, 3>> triangles, const LodSettings& settings);
+};
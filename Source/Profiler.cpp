@@ -0,0 +1,461 @@
+#include "Profiler.hpp"
+#include "Gfx.hpp"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <unordered_map>
+
+namespace
+{
+    const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+    thread_local uint16_t t_depth = 0;
+
+    void writeJsonString(std::ofstream& stream, std::string_view value)
+    {
+        stream << '"';
+        for (char character : value)
+        {
+            if (character == '"' || character == '\\')
+            {
+                stream << '\\';
+            }
+            stream << character;
+        }
+        stream << '"';
+    }
+
+    ImU32 zoneColor(const char* name)
+    {
+        const std::size_t hash = std::hash<const void*>{}(name) * 0x9E3779B97F4A7C15ull;
+        return IM_COL32(80 + (hash >> 8 & 0x7f), 80 + (hash >> 24 & 0x7f), 80 + (hash >> 40 & 0x7f), 255);
+    }
+}
+
+Profiler::Zone::Zone(const char* name) : m_name(g_enabled.load(std::memory_order_relaxed) ? name : nullptr), m_begin(0)
+{
+    if (m_name != nullptr)
+    {
+        t_depth++;
+        m_begin = now();
+    }
+}
+
+Profiler::Zone::~Zone()
+{
+    if (m_name == nullptr)
+    {
+        return;
+    }
+
+    const uint64_t end = now();
+    t_depth--;
+
+    ThreadBuffer& buffer = threadBuffer();
+    push(buffer, Event{ .name = m_name, .begin = m_begin, .end = end, .thread = buffer.index, .depth = t_depth });
+}
+
+uint64_t Profiler::now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_epoch).count());
+}
+
+const char* Profiler::intern(std::string_view name)
+{
+    std::lock_guard lock(g_mutex);
+    if (auto it = g_names.find(name); it != g_names.end())
+    {
+        return it->c_str();
+    }
+
+    return g_names.emplace(name).first->c_str();
+}
+
+void Profiler::setThreadName(std::string_view name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard lock(g_mutex);
+    buffer.name = name;
+}
+
+std::string Profiler::threadName(uint16_t thread)
+{
+    std::lock_guard lock(g_mutex);
+    return thread < g_threads.size() ? g_threads[thread]->name : std::string{};
+}
+
+bool Profiler::isEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::isPaused()
+{
+    return g_paused;
+}
+
+void Profiler::setPaused(bool paused)
+{
+    g_paused = paused;
+}
+
+void Profiler::beginFrame()
+{
+    g_frameBegin = now();
+}
+
+void Profiler::endFrame()
+{
+    Frame frame { .index = g_frameIndex++, .begin = g_frameBegin, .end = now(), .events = {} };
+
+    {
+        std::lock_guard lock(g_mutex);
+        for (std::unique_ptr<ThreadBuffer>& buffer : g_threads)
+        {
+            // Read before head, so every zone of an exited thread is drained before its events are freed
+            const bool exited = buffer->exited.load(std::memory_order_acquire);
+            const uint64_t head = buffer->head.load(std::memory_order_acquire);
+            const uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+            if (!g_paused)
+            {
+                for (uint64_t position = tail; position < head; position++)
+                {
+                    frame.events.emplace_back((*buffer->events)[position % EVENTS_PER_THREAD]);
+                }
+            }
+
+            buffer->tail.store(head, std::memory_order_release);
+            if (exited)
+            {
+                buffer->events.reset();
+            }
+        }
+    }
+
+    if (g_paused)
+    {
+        return;
+    }
+
+    g_frames.emplace_back(std::move(frame));
+    if (g_frames.size() > FRAME_HISTORY)
+    {
+        g_frames.pop_front();
+    }
+}
+
+const std::deque<Profiler::Frame>& Profiler::frames()
+{
+    return g_frames;
+}
+
+uint64_t Profiler::droppedEvents()
+{
+    std::lock_guard lock(g_mutex);
+    uint64_t dropped = 0;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : g_threads)
+    {
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+
+    return dropped;
+}
+
+void Profiler::writeChromeTrace(const std::filesystem::path& path)
+{
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    KORELIB_VERIFY_THROW(stream.is_open(), korelib::RuntimeException, fmt::format("Failed to open '{}' for writing", path.string()));
+
+    // Complete ("X") events with microsecond timestamps, one tid per profiled thread.
+    // Fixed notation keeps nanosecond resolution, the default 6 significant digits round to 100 us after 100 s of runtime
+    stream << std::fixed << std::setprecision(3);
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+
+    {
+        std::lock_guard lock(g_mutex);
+        for (const std::unique_ptr<ThreadBuffer>& buffer : g_threads)
+        {
+            stream << (first ? "" : ",") << "\n{\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->index << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+            writeJsonString(stream, buffer->name);
+            stream << "}}";
+            first = false;
+        }
+    }
+
+    for (const Frame& frame : g_frames)
+    {
+        stream << (first ? "" : ",") << "\n{\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"name\":\"Frame " << frame.index << "\",\"ts\":" << frame.begin / 1000.0 << "}";
+        first = false;
+
+        for (const Event& event : frame.events)
+        {
+            stream << ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread << ",\"name\":";
+            writeJsonString(stream, event.name);
+            stream << ",\"ts\":" << event.begin / 1000.0 << ",\"dur\":" << (event.end - event.begin) / 1000.0 << "}";
+        }
+    }
+
+    stream << "\n]}\n";
+    KORELIB_VERIFY_THROW(stream.good(), korelib::RuntimeException, fmt::format("Failed to write '{}'", path.string()));
+}
+
+void Profiler::drawTimeline()
+{
+    static constexpr float LABEL_WIDTH = 120.0f;
+    static constexpr float ROW_HEIGHT = 18.0f;
+    static constexpr std::size_t TOP_ZONES = 25;
+    static int32_t selectedFrame = 0;
+    static std::string exportStatus{};
+
+    PROFILE_ZONE("Profiler::drawTimeline");
+
+    ImGui::Begin("Profiler");
+
+    bool enabled = isEnabled();
+    if (ImGui::Checkbox("Enabled", &enabled))
+    {
+        setEnabled(enabled);
+    }
+    ImGui::SameLine();
+    bool paused = isPaused();
+    if (ImGui::Checkbox("Pause", &paused))
+    {
+        setPaused(paused);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome trace"))
+    {
+        try
+        {
+            writeChromeTrace("profile.json");
+            exportStatus = "Wrote profile.json";
+        }
+        catch (const std::exception& exception)
+        {
+            exportStatus = exception.what();
+        }
+    }
+    if (!exportStatus.empty())
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted(exportStatus.c_str());
+    }
+
+    if (g_frames.empty())
+    {
+        ImGui::End();
+        return;
+    }
+
+    std::vector<float> frameTimes{};
+    frameTimes.reserve(g_frames.size());
+    for (const Frame& frame : g_frames)
+    {
+        frameTimes.emplace_back((frame.end - frame.begin) / 1.0e6f);
+    }
+    ImGui::PlotHistogram("##FrameTimes", frameTimes.data(), static_cast<int32_t>(frameTimes.size()), 0, "Frame time (ms)", 0.0f, *std::max_element(frameTimes.begin(), frameTimes.end()), ImVec2(-1.0f, 48.0f));
+
+    // 0 is the newest frame, older frames can only be picked while paused
+    if (paused)
+    {
+        ImGui::SliderInt("Frames back", &selectedFrame, 0, static_cast<int32_t>(g_frames.size()) - 1);
+    }
+    else
+    {
+        selectedFrame = 0;
+    }
+    selectedFrame = std::clamp(selectedFrame, 0, static_cast<int32_t>(g_frames.size()) - 1);
+
+    const Frame& frame = g_frames[g_frames.size() - 1 - selectedFrame];
+    const uint64_t frameDuration = std::max<uint64_t>(frame.end - frame.begin, 1);
+    ImGui::Text("Frame %llu: %.3f ms, %zu zones, %llu dropped", static_cast<unsigned long long>(frame.index), frameDuration / 1.0e6, frame.events.size(), static_cast<unsigned long long>(droppedEvents()));
+
+    // One lane per thread, nested zones stacked below their parent
+    std::vector<uint16_t> threadDepths{};
+    for (const Event& event : frame.events)
+    {
+        if (event.thread >= threadDepths.size())
+        {
+            threadDepths.resize(event.thread + 1, 0);
+        }
+        threadDepths[event.thread] = std::max<uint16_t>(threadDepths[event.thread], event.depth + 1);
+    }
+
+    std::vector<float> laneTops(threadDepths.size(), 0.0f);
+    float height = 0.0f;
+    for (std::size_t thread = 0; thread < threadDepths.size(); thread++)
+    {
+        laneTops[thread] = height;
+        height += threadDepths[thread] == 0 ? 0.0f : threadDepths[thread] * ROW_HEIGHT + 4.0f;
+    }
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float width = std::max(ImGui::GetContentRegionAvail().x, LABEL_WIDTH + 1.0f);
+    const double scale = (width - LABEL_WIDTH) / static_cast<double>(frameDuration);
+
+    for (std::size_t thread = 0; thread < threadDepths.size(); thread++)
+    {
+        if (threadDepths[thread] != 0)
+        {
+            const std::string name = threadName(static_cast<uint16_t>(thread));
+            drawList->AddText(ImVec2(origin.x, origin.y + laneTops[thread]), IM_COL32(220, 220, 220, 255), name.c_str());
+        }
+    }
+
+    drawList->PushClipRect(ImVec2(origin.x + LABEL_WIDTH, origin.y), ImVec2(origin.x + width, origin.y + height), true);
+    for (const Event& event : frame.events)
+    {
+        // Zones from other threads can straddle the frame boundaries
+        const uint64_t begin = std::clamp(event.begin, frame.begin, frame.end);
+        const uint64_t end = std::clamp(event.end, frame.begin, frame.end);
+
+        const ImVec2 min(origin.x + LABEL_WIDTH + static_cast<float>((begin - frame.begin) * scale), origin.y + laneTops[event.thread] + event.depth * ROW_HEIGHT);
+        const ImVec2 max(std::max(min.x + 1.0f, origin.x + LABEL_WIDTH + static_cast<float>((end - frame.begin) * scale)), min.y + ROW_HEIGHT - 1.0f);
+        drawList->AddRectFilled(min, max, zoneColor(event.name));
+
+        if (max.x - min.x > 24.0f)
+        {
+            drawList->PushClipRect(min, max, true);
+            drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32(0, 0, 0, 255), event.name);
+            drawList->PopClipRect();
+        }
+
+        if (ImGui::IsMouseHoveringRect(min, max))
+        {
+            ImGui::SetTooltip("%s: %.3f ms", event.name, (event.end - event.begin) / 1.0e6);
+        }
+    }
+    drawList->PopClipRect();
+    ImGui::Dummy(ImVec2(width, height));
+
+    // Inclusive time per zone name, most expensive first
+    std::unordered_map<const char*, std::pair<uint64_t, uint32_t>> totals{};
+    for (const Event& event : frame.events)
+    {
+        auto& [duration, calls] = totals[event.name];
+        duration += event.end - event.begin;
+        calls++;
+    }
+
+    std::vector<std::pair<const char*, std::pair<uint64_t, uint32_t>>> sorted(totals.begin(), totals.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.first > b.second.first; });
+    sorted.resize(std::min(sorted.size(), TOP_ZONES));
+
+    if (ImGui::BeginTable("Zones", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+    {
+        ImGui::TableSetupColumn("Zone");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Total (ms)");
+        ImGui::TableHeadersRow();
+        for (const auto& [name, total] : sorted)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", total.second);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", total.first / 1.0e6);
+        }
+        ImGui::EndTable();
+    }
+
+    // GPU passes arrive Gfx::GPU_TIMER_LATENCY frames late, next to the CPU zones of the same name and frame when that frame is still kept
+    const std::span<const Gfx::GpuPassTiming> gpuTimings = Gfx::gpuPassTimings();
+    if (!gpuTimings.empty())
+    {
+        const uint64_t gpuFrame = Gfx::gpuTimingsFrame();
+        const auto cpuFrame = std::find_if(g_frames.begin(), g_frames.end(), [gpuFrame](const Frame& candidate) { return candidate.index == gpuFrame; });
+
+        ImGui::Text("GPU passes of frame %llu", static_cast<unsigned long long>(gpuFrame));
+        if (ImGui::BeginTable("GpuPasses", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+        {
+            ImGui::TableSetupColumn("Pass");
+            ImGui::TableSetupColumn("GPU (ms)");
+            ImGui::TableSetupColumn("CPU (ms)");
+            ImGui::TableHeadersRow();
+            for (const Gfx::GpuPassTiming& timing : gpuTimings)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(timing.name);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", timing.milliseconds);
+                ImGui::TableNextColumn();
+                if (cpuFrame == g_frames.end())
+                {
+                    ImGui::TextUnformatted("-");
+                    continue;
+                }
+
+                uint64_t cpuTime = 0;
+                for (const Event& event : cpuFrame->events)
+                {
+                    if (std::strcmp(event.name, timing.name) == 0)
+                    {
+                        cpuTime += event.end - event.begin;
+                    }
+                }
+                ImGui::Text("%.3f", cpuTime / 1.0e6);
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    ImGui::End();
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer()
+{
+    if (t_registration.buffer != nullptr)
+    {
+        return *t_registration.buffer;
+    }
+
+    // The small part with index and name is kept for good, so threadName() still answers for events in the history
+    std::lock_guard lock(g_mutex);
+    std::unique_ptr<ThreadBuffer>& buffer = g_threads.emplace_back(std::make_unique<ThreadBuffer>());
+    buffer->index = static_cast<uint16_t>(g_threads.size() - 1);
+    buffer->name = fmt::format("Thread {}", buffer->index);
+    t_registration.buffer = buffer.get();
+
+    return *t_registration.buffer;
+}
+
+Profiler::ThreadRegistration::~ThreadRegistration()
+{
+    if (buffer != nullptr)
+    {
+        buffer->exited.store(true, std::memory_order_release);
+    }
+}
+
+void Profiler::push(ThreadBuffer& buffer, const Event& event)
+{
+    const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= EVENTS_PER_THREAD)
+    {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Published to the draining thread by the release store of head below
+    if (buffer.events == nullptr)
+    {
+        buffer.events = std::make_unique<std::array<Event, EVENTS_PER_THREAD>>();
+    }
+
+    (*buffer.events)[head % EVENTS_PER_THREAD] = event;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Korelib.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#ifndef PROFILER_ENABLED
+    #define PROFILER_ENABLED 1
+#endif
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+    // name has to outlive the profiler history, use a literal or Profiler::intern
+    #define PROFILE_ZONE(name) const Profiler::Zone PROFILER_CONCAT(profilerZone, __LINE__) { name }
+#else
+    #define PROFILE_ZONE(name)
+#endif
+
+// Frame profiler for scoped CPU zones.
+// Every thread writes finished zones into its own fixed size ring buffer without locking,
+// endFrame() drains all of them on the main thread into a short history of frames for the timeline and trace export.
+// The ring buffer is allocated with the first zone of a thread and freed by endFrame() once the thread exited and it is drained.
+class Profiler final : public korelib::StaticOnlyClass
+{
+public:
+    static constexpr std::size_t EVENTS_PER_THREAD = 1 << 15;
+    static constexpr std::size_t FRAME_HISTORY = 300;
+
+    // Times are nanoseconds since the profiler started
+    struct Event
+    {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+        uint16_t thread;
+        uint16_t depth;
+    };
+
+    struct Frame
+    {
+        uint64_t index;
+        uint64_t begin;
+        uint64_t end;
+        std::vector<Event> events;
+    };
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name);
+        ~Zone();
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* m_name;
+        uint64_t m_begin;
+    };
+
+public:
+    static uint64_t now();
+
+    // Returns a pointer that stays valid for the lifetime of the program, equal names share one pointer
+    static const char* intern(std::string_view name);
+    static void setThreadName(std::string_view name);
+    static std::string threadName(uint16_t thread);
+
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+    // Keeps the history as it is so a frame can be inspected, zones are still drained and dropped
+    static bool isPaused();
+    static void setPaused(bool paused);
+
+    // Called by Gfx, so frame indices match Gfx::frameIndex()
+    static void beginFrame();
+    static void endFrame();
+
+    // Oldest first, only valid on the thread that calls endFrame()
+    static const std::deque<Frame>& frames();
+    static uint64_t droppedEvents();
+
+    // Writes the frame history as Chrome trace event JSON, loadable in chrome://tracing or Perfetto
+    static void writeChromeTrace(const std::filesystem::path& path);
+
+    // ImGui window with a per-thread timeline of one frame and the zones with the highest total time
+    static void drawTimeline();
+
+private:
+    struct ThreadBuffer
+    {
+        // Null until the thread records its first zone and again after it exited and was drained
+        std::unique_ptr<std::array<Event, EVENTS_PER_THREAD>> events;
+        // head is only written by the owning thread, tail only by the thread that drains
+        std::atomic<uint64_t> head { 0 };
+        std::atomic<uint64_t> tail { 0 };
+        std::atomic<uint64_t> dropped { 0 };
+        std::atomic<bool> exited { false };
+        uint16_t index { 0 };
+        std::string name;
+    };
+
+    // Marks the buffer of its thread as exited when the thread ends
+    struct ThreadRegistration
+    {
+        ThreadBuffer* buffer { nullptr };
+
+        ~ThreadRegistration();
+    };
+
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view value) const
+        {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    static ThreadBuffer& threadBuffer();
+    static void push(ThreadBuffer& buffer, const Event& event);
+
+private:
+    static inline std::mutex g_mutex {};
+    static inline std::vector<std::unique_ptr<ThreadBuffer>> g_threads {};
+    static inline std::unordered_set<std::string, StringHash, std::equal_to<>> g_names {};
+    static inline thread_local ThreadRegistration t_registration {};
+
+    static inline std::atomic<bool> g_enabled { true };
+    static inline bool g_paused { false };
+    static inline uint64_t g_frameIndex { 0 };
+    static inline uint64_t g_frameBegin { 0 };
+    static inline std::deque<Frame> g_frames {};
+};
@@ -0,0 +1,222 @@
+#include "Registry.hpp"
+
+Registry::Archetype::Archetype(std::vector<ComponentInfo> signature) : m_signature(std::move(signature)), m_columns(m_signature.size())
+{
+}
+
+const std::vector<Registry::ComponentInfo>& Registry::Archetype::signature() const
+{
+    return m_signature;
+}
+
+std::size_t Registry::Archetype::size() const
+{
+    return m_entities.size();
+}
+
+const std::vector<Registry::EntityId>& Registry::Archetype::entities() const
+{
+    return m_entities;
+}
+
+int32_t Registry::Archetype::column(TypeKey key) const
+{
+    auto it = std::lower_bound(m_signature.begin(), m_signature.end(), key, [](const ComponentInfo& info, TypeKey value) { return info.key < value; });
+    if (it == m_signature.end() || it->key != key)
+    {
+        return -1;
+    }
+
+    return static_cast<int32_t>(std::distance(m_signature.begin(), it));
+}
+
+bool Registry::Archetype::contains(TypeKey key) const
+{
+    return column(key) >= 0;
+}
+
+std::byte* Registry::Archetype::data(int32_t column, uint32_t row)
+{
+    return m_columns[column].data() + static_cast<std::size_t>(row) * m_signature[column].size;
+}
+
+uint32_t Registry::Archetype::addRow(EntityId entity)
+{
+    for (std::size_t column = 0; column < m_columns.size(); column++)
+    {
+        m_columns[column].resize(m_columns[column].size() + m_signature[column].size);
+    }
+
+    m_entities.emplace_back(entity);
+    return static_cast<uint32_t>(m_entities.size() - 1);
+}
+
+Registry::EntityId Registry::Archetype::removeRow(uint32_t row)
+{
+    const uint32_t lastRow = static_cast<uint32_t>(m_entities.size() - 1);
+    EntityId moved = INVALID_ENTITY;
+
+    for (std::size_t column = 0; column < m_columns.size(); column++)
+    {
+        const uint32_t size = m_signature[column].size;
+        if (row != lastRow)
+        {
+            std::memcpy(m_columns[column].data() + static_cast<std::size_t>(row) * size, m_columns[column].data() + static_cast<std::size_t>(lastRow) * size, size);
+        }
+
+        m_columns[column].resize(m_columns[column].size() - size);
+    }
+
+    if (row != lastRow)
+    {
+        m_entities[row] = m_entities[lastRow];
+        moved = m_entities[row];
+    }
+
+    m_entities.pop_back();
+    return moved;
+}
+
+Registry::Registry()
+{
+    // Archetype 0 holds entities without any components
+    findOrCreateArchetype({});
+}
+
+Registry::EntityId Registry::create()
+{
+    uint32_t index{};
+    if (!m_freeRecords.empty())
+    {
+        index = m_freeRecords.back();
+        m_freeRecords.pop_back();
+    }
+    else
+    {
+        index = static_cast<uint32_t>(m_records.size());
+        m_records.emplace_back(Record{ .archetype = 0, .row = 0, .generation = 0 });
+    }
+
+    Record& record = m_records[index];
+    const EntityId entity { index, record.generation };
+
+    record.archetype = 0;
+    record.row = m_archetypes[0]->addRow(entity);
+    m_size++;
+
+    return entity;
+}
+
+void Registry::destroy(EntityId entity)
+{
+    Record& record = m_records[verifiedIndex(entity)];
+
+    if (const EntityId moved = m_archetypes[record.archetype]->removeRow(record.row); moved != INVALID_ENTITY)
+    {
+        m_records[moved.index].row = record.row;
+    }
+
+    record.generation++;
+    m_freeRecords.emplace_back(entity.index);
+    m_size--;
+}
+
+bool Registry::isValid(EntityId entity) const
+{
+    return entity.index < m_records.size() && m_records[entity.index].generation == entity.generation;
+}
+
+std::size_t Registry::size() const
+{
+    return m_size;
+}
+
+std::size_t Registry::archetypeCount() const
+{
+    return m_archetypes.size();
+}
+
+uint32_t Registry::verifiedIndex(EntityId entity) const
+{
+    KORELIB_VERIFY_THROW(isValid(entity), korelib::RuntimeException, "Invalid registry entity");
+    return entity.index;
+}
+
+uint32_t Registry::archetypeWithComponent(uint32_t source, ComponentInfo component)
+{
+    if (auto it = m_archetypes[source]->m_addEdges.find(component.key); it != m_archetypes[source]->m_addEdges.end())
+    {
+        return it->second;
+    }
+
+    std::vector<ComponentInfo> signature = m_archetypes[source]->signature();
+    signature.insert(std::upper_bound(signature.begin(), signature.end(), component.key, [](TypeKey value, const ComponentInfo& info) { return value < info.key; }), component);
+
+    const uint32_t target = findOrCreateArchetype(std::move(signature));
+    m_archetypes[source]->m_addEdges.emplace(component.key, target);
+    m_archetypes[target]->m_removeEdges.emplace(component.key, source);
+
+    return target;
+}
+
+uint32_t Registry::archetypeWithoutComponent(uint32_t source, TypeKey key)
+{
+    if (auto it = m_archetypes[source]->m_removeEdges.find(key); it != m_archetypes[source]->m_removeEdges.end())
+    {
+        return it->second;
+    }
+
+    std::vector<ComponentInfo> signature = m_archetypes[source]->signature();
+    std::erase_if(signature, [key](const ComponentInfo& info) { return info.key == key; });
+
+    const uint32_t target = findOrCreateArchetype(std::move(signature));
+    m_archetypes[source]->m_removeEdges.emplace(key, target);
+    m_archetypes[target]->m_addEdges.emplace(key, source);
+
+    return target;
+}
+
+uint32_t Registry::findOrCreateArchetype(std::vector<ComponentInfo> signature)
+{
+    std::vector<TypeKey> keys{};
+    keys.reserve(signature.size());
+    for (const ComponentInfo& info : signature)
+    {
+        keys.emplace_back(info.key);
+    }
+
+    if (auto it = m_archetypeBySignature.find(keys); it != m_archetypeBySignature.end())
+    {
+        return it->second;
+    }
+
+    const uint32_t index = static_cast<uint32_t>(m_archetypes.size());
+    m_archetypes.emplace_back(std::make_unique<Archetype>(std::move(signature)));
+    m_archetypeBySignature.emplace(std::move(keys), index);
+
+    return index;
+}
+
+void Registry::move(EntityId entity, uint32_t target)
+{
+    Record& record = m_records[entity.index];
+    Archetype& source = *m_archetypes[record.archetype];
+    Archetype& destination = *m_archetypes[target];
+
+    const uint32_t row = destination.addRow(entity);
+    for (const ComponentInfo& info : source.signature())
+    {
+        if (const int32_t column = destination.column(info.key); column >= 0)
+        {
+            std::memcpy(destination.data(column, row), source.data(source.column(info.key), record.row), info.size);
+        }
+    }
+
+    if (const EntityId moved = source.removeRow(record.row); moved != INVALID_ENTITY)
+    {
+        m_records[moved.index].row = record.row;
+    }
+
+    record.archetype = target;
+    record.row = row;
+}
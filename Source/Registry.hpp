@@ -0,0 +1,200 @@
+#pragma once
+
+#include "ctti/type_id.hpp"
+#include "Korelib.hpp"
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Plain-data component stored by value inside a Registry archetype instead of as a heap-allocated Component
+template<typename T>
+concept DataComponent = std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T> && alignof(T) <= alignof(std::max_align_t);
+
+// Archetype storage for data components.
+// Entities with the same set of component types share an archetype that keeps one tightly packed column per type,
+// so queries walk plain arrays instead of chasing pointers through the Entity hierarchy.
+class Registry
+{
+public:
+    struct EntityId
+    {
+        uint32_t index;
+        uint32_t generation;
+
+        constexpr bool operator==(const EntityId& other) const = default;
+    };
+
+    static constexpr EntityId INVALID_ENTITY { std::numeric_limits<uint32_t>::max(), 0 };
+
+private:
+    using TypeKey = uint64_t;
+
+    struct ComponentInfo
+    {
+        TypeKey key;
+        uint32_t size;
+    };
+
+    class Archetype
+    {
+    public:
+        explicit Archetype(std::vector<ComponentInfo> signature);
+
+        const std::vector<ComponentInfo>& signature() const;
+        std::size_t size() const;
+        const std::vector<EntityId>& entities() const;
+
+        int32_t column(TypeKey key) const;
+        bool contains(TypeKey key) const;
+        std::byte* data(int32_t column, uint32_t row);
+
+        uint32_t addRow(EntityId entity);
+        // Swaps the last row into the removed one, returns the entity that moved or INVALID_ENTITY
+        EntityId removeRow(uint32_t row);
+
+    private:
+        friend class Registry;
+
+        // Archetype reached by adding or removing one component type, filled in by Registry as it walks the graph
+        std::unordered_map<TypeKey, uint32_t> m_addEdges;
+        std::unordered_map<TypeKey, uint32_t> m_removeEdges;
+
+        std::vector<ComponentInfo> m_signature;
+        std::vector<std::vector<std::byte>> m_columns;
+        std::vector<EntityId> m_entities;
+    };
+
+    struct Record
+    {
+        uint32_t archetype;
+        uint32_t row;
+        uint32_t generation;
+    };
+
+public:
+    Registry();
+
+    EntityId create();
+    void destroy(EntityId entity);
+    bool isValid(EntityId entity) const;
+    std::size_t size() const;
+    std::size_t archetypeCount() const;
+
+    // The returned reference stays valid until the next structural change (create/destroy/add/remove)
+    template<DataComponent T>
+    T& add(EntityId entity, const T& value = {})
+    {
+        constexpr TypeKey key = typeKey<T>();
+
+        const Record& record = m_records[verifiedIndex(entity)];
+        Archetype& archetype = *m_archetypes[record.archetype];
+        if (const int32_t column = archetype.column(key); column >= 0)
+        {
+            T* component = reinterpret_cast<T*>(archetype.data(column, record.row));
+            *component = value;
+            return *component;
+        }
+
+        const uint32_t target = archetypeWithComponent(record.archetype, { key, sizeof(T) });
+        move(entity, target);
+
+        const Record& movedRecord = m_records[entity.index];
+        Archetype& targetArchetype = *m_archetypes[movedRecord.archetype];
+        T* component = reinterpret_cast<T*>(targetArchetype.data(targetArchetype.column(key), movedRecord.row));
+        std::memcpy(static_cast<void*>(component), &value, sizeof(T));
+
+        return *component;
+    }
+
+    template<DataComponent T>
+    void remove(EntityId entity)
+    {
+        constexpr TypeKey key = typeKey<T>();
+
+        const Record& record = m_records[verifiedIndex(entity)];
+        if (!m_archetypes[record.archetype]->contains(key))
+        {
+            return;
+        }
+
+        move(entity, archetypeWithoutComponent(record.archetype, key));
+    }
+
+    template<DataComponent T>
+    T* tryGet(EntityId entity)
+    {
+        const Record& record = m_records[verifiedIndex(entity)];
+        Archetype& archetype = *m_archetypes[record.archetype];
+        const int32_t column = archetype.column(typeKey<T>());
+
+        return column >= 0 ? reinterpret_cast<T*>(archetype.data(column, record.row)) : nullptr;
+    }
+
+    template<DataComponent T>
+    bool has(EntityId entity) const
+    {
+        const Record& record = m_records[verifiedIndex(entity)];
+        return m_archetypes[record.archetype]->contains(typeKey<T>());
+    }
+
+    // Calls fn(EntityId, Ts&...) for every entity that has all of Ts, archetype by archetype.
+    // fn must not add, remove or destroy anything while iterating.
+    template<DataComponent... Ts, typename F>
+    void each(F&& fn) requires(sizeof...(Ts) > 0 && std::invocable<F, EntityId, Ts&...>)
+    {
+        constexpr std::array<TypeKey, sizeof...(Ts)> keys { typeKey<Ts>()... };
+
+        for (std::unique_ptr<Archetype>& archetype : m_archetypes)
+        {
+            if (archetype->size() == 0 || !std::all_of(keys.begin(), keys.end(), [&archetype](TypeKey key) { return archetype->contains(key); }))
+            {
+                continue;
+            }
+
+            eachInArchetype<Ts...>(*archetype, fn, std::index_sequence_for<Ts...>{});
+        }
+    }
+
+private:
+    template<typename T>
+    static constexpr TypeKey typeKey()
+    {
+        return ctti::unnamed_type_id<T>().hash();
+    }
+
+    template<typename... Ts, typename F, std::size_t... Indices>
+    void eachInArchetype(Archetype& archetype, F& fn, std::index_sequence<Indices...>)
+    {
+        std::array<std::byte*, sizeof...(Ts)> columns { archetype.data(archetype.column(typeKey<Ts>()), 0)... };
+        const std::vector<EntityId>& entities = archetype.entities();
+
+        for (std::size_t row = 0; row < entities.size(); row++)
+        {
+            fn(entities[row], reinterpret_cast<Ts*>(columns[Indices])[row]...);
+        }
+    }
+
+    uint32_t verifiedIndex(EntityId entity) const;
+    uint32_t archetypeWithComponent(uint32_t source, ComponentInfo component);
+    uint32_t archetypeWithoutComponent(uint32_t source, TypeKey key);
+    uint32_t findOrCreateArchetype(std::vector<ComponentInfo> signature);
+    void move(EntityId entity, uint32_t target);
+
+private:
+    std::vector<std::unique_ptr<Archetype>> m_archetypes;
+    std::map<std::vector<TypeKey>, uint32_t> m_archetypeBySignature;
+
+    std::vector<Record> m_records;
+    std::vector<uint32_t> m_freeRecords;
+    std::size_t m_size { 0 };
+};
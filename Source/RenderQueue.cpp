@@ -0,0 +1,150 @@
+#include "RenderQueue.hpp"
+#include "Components/Camera.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <limits>
+
+uint64_t RenderQueue::makeSortKey(uint16_t shaderIndex, uint16_t textureIndex, uint16_t vertexArrayIndex, float normalizedDepth)
+{
+    const uint64_t depth = static_cast<uint64_t>(glm::clamp(normalizedDepth, 0.0f, 1.0f) * std::numeric_limits<uint16_t>::max());
+
+    return (static_cast<uint64_t>(shaderIndex) << 48)
+        | (static_cast<uint64_t>(textureIndex) << 32)
+        | (static_cast<uint64_t>(vertexArrayIndex) << 16)
+        | depth;
+}
+
+uint16_t RenderQueue::denseIndex(std::unordered_map<uint32_t, uint16_t>& indices, uint32_t name)
+{
+    auto [indexIt, inserted] = indices.try_emplace(name, static_cast<uint16_t>(indices.size()));
+    KORELIB_VERIFY_THROW(!inserted || indices.size() <= std::numeric_limits<uint16_t>::max() + 1u, korelib::RuntimeException, "Too many distinct objects in one flush for a 16 bit sort key field");
+    return indexIt->second;
+}
+
+bool RenderQueue::isSameBatch(const DrawPacket& lhs, const DrawPacket& rhs)
+{
+    return lhs.shaderProgram == rhs.shaderProgram
+        && lhs.texture == rhs.texture
+        && lhs.mesh == rhs.mesh;
+}
+
+void RenderQueue::submit(const DrawPacket& packet)
+{
+    g_packets.emplace_back(packet);
+}
+
+void RenderQueue::flush()
+{
+    PROFILE_ZONE("RenderQueue::flush");
+
+    // Every packet used to bind its own shader, texture and geometry
+    static constexpr uint32_t NAIVE_STATE_CHANGES_PER_PACKET = 3;
+
+    g_stats = { .packets = static_cast<uint32_t>(g_packets.size()), .batches = 0, .stateChanges = 0, .stateChangesSaved = 0 };
+
+    const std::shared_ptr<Camera>& camera = Gfx::getActiveCamera();
+
+    // GL names that agree in their low bits would otherwise share key bits and interleave their batches
+    g_shaderIndices.clear();
+    g_textureIndices.clear();
+    g_vertexArrayIndices.clear();
+
+    g_sortedPackets.clear();
+    g_sortedPackets.reserve(g_packets.size());
+    for (uint32_t packetIndex = 0; packetIndex < g_packets.size(); packetIndex++)
+    {
+        const DrawPacket& packet = g_packets[packetIndex];
+
+        float normalizedDepth = 0.0f;
+        if (camera != nullptr)
+        {
+            const glm::vec4 viewPosition = camera->view() * packet.model[3];
+            normalizedDepth = -viewPosition.z / camera->far();
+        }
+
+        const uint16_t shaderIndex = denseIndex(g_shaderIndices, packet.shaderProgram);
+        const uint16_t textureIndex = denseIndex(g_textureIndices, packet.texture);
+        const uint16_t vertexArrayIndex = denseIndex(g_vertexArrayIndices, packet.mesh->getVertexArrayObject());
+        g_sortedPackets.emplace_back(makeSortKey(shaderIndex, textureIndex, vertexArrayIndex, normalizedDepth), packetIndex);
+    }
+
+    std::sort(g_sortedPackets.begin(), g_sortedPackets.end());
+
+    g_instances.clear();
+    g_instances.reserve(g_sortedPackets.size());
+    for (auto&& [sortKey, packetIndex] : g_sortedPackets)
+    {
+        const DrawPacket& packet = g_packets[packetIndex];
+        g_instances.emplace_back(Gfx::InstanceData{ .model = packet.model, .parameters = { static_cast<float>(packet.textureLayer), 0.0f, 0.0f, 0.0f } });
+    }
+
+    if (!g_instances.empty())
+    {
+        Gfx::updateInstanceBufferData(g_instances);
+    }
+
+    if (camera != nullptr)
+    {
+        Gfx::updateCameraData(camera->view(), camera->projection());
+    }
+
+    bool first = true;
+    Gfx::ShaderType currentShaderProgram{};
+    Gfx::TextureIdType currentTexture{};
+    Gfx::VertexArrayObjectType currentVertexArrayObject{};
+
+    std::size_t batchBegin = 0;
+    while (batchBegin < g_sortedPackets.size())
+    {
+        const DrawPacket& packet = g_packets[g_sortedPackets[batchBegin].second];
+
+        std::size_t batchEnd = batchBegin + 1;
+        while (batchEnd < g_sortedPackets.size() && isSameBatch(packet, g_packets[g_sortedPackets[batchEnd].second]))
+        {
+            batchEnd++;
+        }
+
+        if (first || packet.shaderProgram != currentShaderProgram)
+        {
+            currentShaderProgram = packet.shaderProgram;
+            Gfx::setShaderProgram(currentShaderProgram);
+            g_stats.stateChanges++;
+        }
+
+        if (first || packet.texture != currentTexture)
+        {
+            currentTexture = packet.texture;
+            if (packet.textureArray)
+            {
+                Gfx::setActiveTextureArray(currentTexture);
+            }
+            else
+            {
+                Gfx::setActiveTexture(currentTexture);
+            }
+            g_stats.stateChanges++;
+        }
+
+        if (first || packet.mesh->getVertexArrayObject() != currentVertexArrayObject)
+        {
+            currentVertexArrayObject = packet.mesh->getVertexArrayObject();
+            Gfx::bindVertexArray(currentVertexArrayObject);
+            g_stats.stateChanges++;
+        }
+
+        first = false;
+        Gfx::drawIndexedGeometryInstanced(static_cast<uint32_t>(batchBegin), static_cast<uint32_t>(batchEnd - batchBegin), packet.mesh->getIndexCount());
+        g_stats.batches++;
+
+        batchBegin = batchEnd;
+    }
+
+    g_stats.stateChangesSaved = g_stats.packets * NAIVE_STATE_CHANGES_PER_PACKET - g_stats.stateChanges;
+    clear();
+}
+
+void RenderQueue::clear()
+{
+    g_packets.clear();
+}
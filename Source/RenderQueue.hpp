@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Gfx.hpp"
+#include "Korelib.hpp"
+#include "Mesh.hpp"
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Collects draw packets during the scene update and submits them sorted at the end of the frame,
+// so consecutive packets sharing a shader, texture or geometry skip the redundant binds.
+// Runs of packets drawing the same mesh with the same material collapse into a single instanced draw.
+class RenderQueue final : public korelib::StaticOnlyClass
+{
+public:
+    struct DrawPacket
+    {
+        Gfx::ShaderType shaderProgram;
+        Gfx::TextureIdType texture;
+        const Mesh* mesh;
+        glm::mat4 model;
+        // texture is a 2D array and the packet samples textureLayer of it, which can differ inside one instanced draw
+        bool textureArray;
+        uint32_t textureLayer;
+    };
+
+    struct Stats
+    {
+        uint32_t packets;
+        uint32_t batches;
+        uint32_t stateChanges;
+        uint32_t stateChangesSaved;
+    };
+
+public:
+    // [63..48] shader | [47..32] texture | [31..16] vertex array | [15..0] view depth, front to back.
+    // Takes the dense per-flush indices of the objects rather than their GL names, which can exceed 16 bits
+    static uint64_t makeSortKey(uint16_t shaderIndex, uint16_t textureIndex, uint16_t vertexArrayIndex, float normalizedDepth);
+
+    static void submit(const DrawPacket& packet);
+    static void flush();
+    static void clear();
+
+    static const Stats& stats()
+    {
+        return g_stats;
+    }
+
+private:
+    static bool isSameBatch(const DrawPacket& lhs, const DrawPacket& rhs);
+    // Index of name in the order names were first seen this flush
+    static uint16_t denseIndex(std::unordered_map<uint32_t, uint16_t>& indices, uint32_t name);
+
+private:
+    static inline std::vector<DrawPacket> g_packets {};
+    static inline std::vector<std::pair<uint64_t, uint32_t>> g_sortedPackets {};
+    static inline std::vector<Gfx::InstanceData> g_instances {};
+    static inline std::unordered_map<uint32_t, uint16_t> g_shaderIndices {};
+    static inline std::unordered_map<uint32_t, uint16_t> g_textureIndices {};
+    static inline std::unordered_map<uint32_t, uint16_t> g_vertexArrayIndices {};
+    static inline Stats g_stats {};
+};
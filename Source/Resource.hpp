@@ -2,6 +2,8 @@
 
 #include "Korelib.hpp"
 
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
 #include <concepts>
 #include <string>
@@ -21,7 +23,7 @@ public:
     {
     }
 
-    constexpr virtual ~Resource() noexcept = default;
+    virtual ~Resource() noexcept = default;
 
     constexpr const std::filesystem::path& getPath() const noexcept
     {
@@ -33,7 +35,33 @@ public:
         return m_storageType;
     }
 
+    // Bytes currently held in system memory and in video memory, as accounted by ResourceManager
+    uint64_t getCpuBytes() const noexcept
+    {
+        return m_cpuBytes.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getGpuBytes() const noexcept
+    {
+        return m_gpuBytes.load(std::memory_order_relaxed);
+    }
+
+    // Still loading in the background, its memory is not accounted yet and ResourceManager does not evict it
+    virtual bool isPending() const noexcept
+    {
+        return false;
+    }
+
+protected:
+    void setMemoryUsage(uint64_t cpuBytes, uint64_t gpuBytes) noexcept
+    {
+        m_cpuBytes.store(cpuBytes, std::memory_order_relaxed);
+        m_gpuBytes.store(gpuBytes, std::memory_order_relaxed);
+    }
+
 private:
     std::filesystem::path m_path;
     StorageType m_storageType;
+    std::atomic<uint64_t> m_cpuBytes { 0 };
+    std::atomic<uint64_t> m_gpuBytes { 0 };
 };
@@ -0,0 +1,125 @@
+#include "ResourceManager.hpp"
+#include "Archive.hpp"
+#include "Profiler.hpp"
+#include "TextureLoader.hpp"
+
+#include <vector>
+
+std::size_t ResourceManager::KeyHash::operator()(const Key& key) const
+{
+    const std::size_t pathHash = std::hash<std::string>{}(key.path);
+    const std::size_t typeHash = (static_cast<std::size_t>(key.kind) << 8) | static_cast<std::size_t>(key.storageType);
+    return pathHash ^ (typeHash + 0x9e3779b97f4a7c15ull + (pathHash << 6) + (pathHash >> 2));
+}
+
+std::shared_ptr<Texture> ResourceManager::texture(const std::filesystem::path& path, Resource::StorageType storageType)
+{
+    // Spelling variants of the same file share one entry
+    Key key { .kind = Kind::TEXTURE, .storageType = storageType, .path = Archive::entryNameOf(path) };
+
+    std::shared_ptr<Texture> texture{};
+    {
+        std::lock_guard lock(g_mutex);
+        if (std::shared_ptr<Resource> cached = findLocked(key); cached != nullptr)
+        {
+            return std::static_pointer_cast<Texture>(cached);
+        }
+
+        texture = std::make_shared<Texture>(path, storageType);
+        insertLocked(std::move(key), texture);
+    }
+
+    // Concurrent requests already got the cached handle above, only the first one starts the load
+    TextureLoader::request(texture);
+    return texture;
+}
+
+void ResourceManager::collect()
+{
+    PROFILE_ZONE("ResourceManager::collect");
+
+    // Evicted resources are destroyed outside the lock, their destructors release GPU objects
+    std::vector<std::shared_ptr<Resource>> evicted{};
+    {
+        std::lock_guard lock(g_mutex);
+
+        Stats stats { .resources = g_lru.size(), .referenced = 0, .cpuBytes = 0, .gpuBytes = 0, .evictions = g_stats.evictions };
+        for (const Entry& entry : g_lru)
+        {
+            stats.referenced += entry.resource.use_count() > 1 ? 1 : 0;
+            stats.cpuBytes += entry.resource->getCpuBytes();
+            stats.gpuBytes += entry.resource->getGpuBytes();
+        }
+
+        uint64_t usedBytes = stats.cpuBytes + stats.gpuBytes;
+        for (auto it = g_lru.end(); it != g_lru.begin() && usedBytes > g_memoryBudget;)
+        {
+            --it;
+            // A pending resource counts 0 bytes, evicting it frees nothing and only throws away the decode in flight
+            if (it->resource.use_count() > 1 || it->resource->isPending())
+            {
+                continue;
+            }
+
+            const uint64_t cpuBytes = it->resource->getCpuBytes();
+            const uint64_t gpuBytes = it->resource->getGpuBytes();
+            usedBytes -= cpuBytes + gpuBytes;
+            stats.cpuBytes -= cpuBytes;
+            stats.gpuBytes -= gpuBytes;
+            stats.resources--;
+            stats.evictions++;
+
+            g_entries.erase(it->key);
+            evicted.emplace_back(std::move(it->resource));
+            it = g_lru.erase(it);
+        }
+
+        g_stats = stats;
+    }
+}
+
+void ResourceManager::destroy()
+{
+    LruList released{};
+    {
+        std::lock_guard lock(g_mutex);
+        g_entries.clear();
+        released.swap(g_lru);
+        g_stats = {};
+    }
+}
+
+uint64_t ResourceManager::memoryBudget()
+{
+    std::lock_guard lock(g_mutex);
+    return g_memoryBudget;
+}
+
+void ResourceManager::setMemoryBudget(uint64_t bytes)
+{
+    std::lock_guard lock(g_mutex);
+    g_memoryBudget = bytes;
+}
+
+const ResourceManager::Stats& ResourceManager::stats()
+{
+    return g_stats;
+}
+
+std::shared_ptr<Resource> ResourceManager::findLocked(const Key& key)
+{
+    auto it = g_entries.find(key);
+    if (it == g_entries.end())
+    {
+        return nullptr;
+    }
+
+    g_lru.splice(g_lru.begin(), g_lru, it->second);
+    return it->second->resource;
+}
+
+void ResourceManager::insertLocked(Key key, std::shared_ptr<Resource> resource)
+{
+    g_lru.emplace_front(Entry{ .key = key, .resource = std::move(resource) });
+    g_entries.emplace(std::move(key), g_lru.begin());
+}
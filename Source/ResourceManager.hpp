@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Korelib.hpp"
+#include "Resource.hpp"
+#include "Texture.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Owns every resource loaded through it, keyed on resource type, path and storage type.
+// Asking twice for the same asset, from any thread, returns the same shared handle, so it is decoded and uploaded once.
+// Resources nobody else holds a handle to stay cached until the memory budget is exceeded,
+// then collect() evicts them least recently acquired first. Resources still loading are kept until they finish.
+class ResourceManager final : public korelib::StaticOnlyClass
+{
+public:
+    static constexpr uint64_t UNLIMITED_BUDGET = std::numeric_limits<uint64_t>::max();
+
+    struct Stats
+    {
+        std::size_t resources;
+        std::size_t referenced;
+        uint64_t cpuBytes;
+        uint64_t gpuBytes;
+        uint64_t evictions;
+    };
+
+public:
+    // Starts loading through TextureLoader on the first request, until then the texture shows the placeholder
+    static std::shared_ptr<Texture> texture(const std::filesystem::path& path, Resource::StorageType storageType);
+
+    // Called by Gfx::beginFrame on the render thread, evicted resources release their GPU objects here
+    static void collect();
+    // Drops every cached resource, handles still held elsewhere stay valid. Call before Gfx::destroy.
+    static void destroy();
+
+    static uint64_t memoryBudget();
+    static void setMemoryBudget(uint64_t bytes);
+
+    // Refreshed by collect()
+    static const Stats& stats();
+
+private:
+    enum class Kind : uint8_t
+    {
+        TEXTURE
+    };
+
+    struct Key
+    {
+        Kind kind;
+        Resource::StorageType storageType;
+        std::string path;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::shared_ptr<Resource> resource;
+    };
+
+    using LruList = std::list<Entry>;
+
+    // Returns the cached resource and marks it as most recently used, null when it is not cached
+    static std::shared_ptr<Resource> findLocked(const Key& key);
+    static void insertLocked(Key key, std::shared_ptr<Resource> resource);
+
+private:
+    static inline std::mutex g_mutex {};
+    // Front is the most recently acquired resource
+    static inline LruList g_lru {};
+    static inline std::unordered_map<Key, LruList::iterator, KeyHash> g_entries {};
+    static inline uint64_t g_memoryBudget { UNLIMITED_BUDGET };
+    static inline Stats g_stats {};
+};
@@ -1,5 +1,8 @@
 #include "SceneGraph.hpp"
+#include "JobSystem.hpp"
 #include "Korelib.hpp"
+#include "Profiler.hpp"
+#include "Components/Camera.hpp"
 
 Entity::Entity(const std::string& name, const std::shared_ptr<Entity>& parent) : m_name(name), m_parent(parent)
 {
@@ -17,42 +20,149 @@ const std::string& Entity::getName() const
 void Entity::setName(const std::string& name)
 {
     m_name = name;
+    m_profileName.store(nullptr, std::memory_order_relaxed);
 }
 
-const std::shared_ptr<Entity>& Entity::getParent() const
+const char* Entity::getProfileName() const
 {
-    return m_parent;
+    // A disabled profiler records nothing, so building a scene never touches the global name set
+    if (!Profiler::isEnabled())
+    {
+        return nullptr;
+    }
+
+    const char* profileName = m_profileName.load(std::memory_order_relaxed);
+    if (profileName == nullptr)
+    {
+        profileName = Profiler::intern(m_name);
+        m_profileName.store(profileName, std::memory_order_relaxed);
+    }
+    return profileName;
 }
 
-void Entity::update()
+std::shared_ptr<Entity> Entity::getParent() const
+{
+    return m_parent.lock();
+}
+
+bool Entity::hasParent() const
+{
+    return !m_parent.expired();
+}
+
+void Entity::update(float deltaTime)
 {
     for (auto&& child : m_children)
     {
-        child->update();
+        PROFILE_ZONE(child->getProfileName());
+        child->update(deltaTime);
     }
 }
 
-GameObject::GameObject(const std::string& name, const std::shared_ptr<Entity>& parent) : Entity(name, parent)
+void Entity::collectComponents(std::vector<Component*>& parallel, std::vector<std::pair<std::size_t, std::size_t>>& batches, std::vector<Component*>& deferred)
+{
+    const std::size_t batchBegin = parallel.size();
+    for (auto&& child : m_children)
+    {
+        if (child->kind() != Kind::COMPONENT)
+        {
+            child->collectComponents(parallel, batches, deferred);
+            continue;
+        }
+
+        Component* component = static_cast<Component*>(child.get());
+        if (component->isThreadSafe())
+        {
+            parallel.emplace_back(component);
+        }
+        else
+        {
+            deferred.emplace_back(component);
+        }
+    }
+
+    if (kind() == Kind::GAME_OBJECT && parallel.size() > batchBegin)
+    {
+        batches.emplace_back(batchBegin, parallel.size());
+    }
+}
+
+GameObject::GameObject(const std::string& name, const std::shared_ptr<Entity>& parent, std::shared_ptr<TransformStorage> transforms, TransformStorage::Handle parentTransform, std::shared_ptr<Registry> registry, std::shared_ptr<CullingWorld> cullingWorld) : Entity(name, parent), m_transforms(std::move(transforms)), m_registry(std::move(registry)), m_cullingWorld(std::move(cullingWorld))
 {
     KORELIB_VERIFY_THROW(parent != nullptr, korelib::RuntimeException, "parent is null");
     KORELIB_VERIFY_THROW(parent->kind() == Entity::Kind::SCENE || parent->kind() == Entity::Kind::GAME_OBJECT, korelib::RuntimeException, "GameObject parent can be only Entity with type SCENE or GAME_OBJECT");
+    KORELIB_VERIFY_THROW(m_transforms != nullptr, korelib::RuntimeException, "transforms is null");
+    KORELIB_VERIFY_THROW(m_registry != nullptr, korelib::RuntimeException, "registry is null");
+    KORELIB_VERIFY_THROW(m_cullingWorld != nullptr, korelib::RuntimeException, "cullingWorld is null");
+
+    m_transformHandle = m_transforms->create({0.0f, 0.0f, 0.0f}, glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, 0.0f))), {1.0f, 1.0f, 1.0f}, parentTransform);
+
+    // Expose the transform to registry queries so systems can pair it with data components
+    m_registryEntity = m_registry->create();
+    m_registry->add<TransformStorage::Handle>(m_registryEntity, m_transformHandle);
 }
 
-Component::Component(const std::string& name, const std::shared_ptr<Entity>& parent) : Entity(name, parent)
+GameObject::~GameObject()
+{
+    m_registry->destroy(m_registryEntity);
+    m_transforms->destroy(m_transformHandle);
+}
+
+TransformRef GameObject::transform()
+{
+    return { *m_transforms, m_transformHandle };
+}
+
+TransformStorage::Handle GameObject::transformHandle() const
+{
+    return m_transformHandle;
+}
+
+Registry::EntityId GameObject::registryEntity() const
+{
+    return m_registryEntity;
+}
+
+const std::shared_ptr<CullingWorld>& GameObject::cullingWorld() const
+{
+    return m_cullingWorld;
+}
+
+Component::Component(const std::string& name, const std::shared_ptr<Entity>& parent) : Entity(name, parent), m_gameObject(static_cast<GameObject*>(parent.get()))
 {
     KORELIB_VERIFY_THROW(parent != nullptr, korelib::RuntimeException, "parent is null");
     KORELIB_VERIFY_THROW(parent->kind() == Entity::Kind::GAME_OBJECT, korelib::RuntimeException, "Component parent can be only Entity with type GAME_OBJECT");
 }
 
-void Component::update()
+void Component::update(float)
+{
+}
+
+bool Component::isThreadSafe() const
 {
+    return false;
 }
 
 GameObject& Component::gameObject()
 {
-    const std::shared_ptr<GameObject>& parent = std::static_pointer_cast<GameObject>(getParent());
-    KORELIB_VERIFY_THROW(parent != nullptr, korelib::RuntimeException, "parent is nullptr");
-    return *parent;
+    // Checked instead of locked, gameObject() is on every per component hot path
+    KORELIB_VERIFY_THROW(hasParent(), korelib::RuntimeException, "parent is nullptr");
+    return *m_gameObject;
+}
+
+RenderComponent::RenderComponent(const std::string& name, const std::shared_ptr<Entity>& parent) : Component(name, parent), m_cullingWorld(gameObject().cullingWorld())
+{
+    m_cullingWorld->add(*this);
+}
+
+RenderComponent::~RenderComponent()
+{
+    m_cullingWorld->remove(*this);
+}
+
+void RenderComponent::markBoundsDirty()
+{
+    m_boundsDirty = true;
 }
 
 std::shared_ptr<Scene> Scene::create(const std::string& name)
@@ -60,16 +170,85 @@ std::shared_ptr<Scene> Scene::create(const std::string& name)
     return std::make_shared<Scene>(name);
 }
 
-Scene::Scene(const std::string& name) : Entity(name, nullptr)
+Scene::Scene(const std::string& name) : Entity(name, nullptr), m_transforms(std::make_shared<TransformStorage>()), m_registry(std::make_shared<Registry>()), m_cullingWorld(std::make_shared<CullingWorld>())
+{
+}
+
+void Scene::update(float deltaTime)
+{
+    PROFILE_ZONE("Scene::update");
+
+    {
+        PROFILE_ZONE("Scene::systems");
+        for (System& system : m_systems)
+        {
+            system(*m_registry, deltaTime);
+        }
+    }
+
+    if (m_updateMode == UpdateMode::PARALLEL)
+    {
+        updateParallel(deltaTime);
+    }
+    else
+    {
+        Entity::update(deltaTime);
+    }
+
+    // After everything moved this frame, so culling and drawing never see last frame's matrices
+    m_transforms->updateWorldMatrices();
+    render();
+}
+
+void Scene::render()
+{
+    PROFILE_ZONE("Scene::render");
+
+    m_cullingWorld->refit(*m_transforms);
+
+    std::optional<Frustum> frustum{};
+    if (const std::shared_ptr<Camera>& camera = Gfx::getActiveCamera(); camera != nullptr)
+    {
+        camera->updateView();
+        frustum = Frustum::fromMatrix(camera->projection() * camera->view());
+    }
+
+    m_cullingWorld->render(frustum);
+}
+
+void Scene::updateParallel(float deltaTime)
 {
+    static constexpr std::size_t GAME_OBJECTS_PER_JOB = 64;
+
+    m_parallelComponents.clear();
+    m_parallelBatches.clear();
+    m_deferredComponents.clear();
+    collectComponents(m_parallelComponents, m_parallelBatches, m_deferredComponents);
+
+    JobSystem::parallelFor(m_parallelBatches.size(), GAME_OBJECTS_PER_JOB, [this, deltaTime](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t batchIndex = begin; batchIndex < end; batchIndex++)
+        {
+            const auto [first, last] = m_parallelBatches[batchIndex];
+            for (std::size_t componentIndex = first; componentIndex < last; componentIndex++)
+            {
+                PROFILE_ZONE(m_parallelComponents[componentIndex]->getProfileName());
+                m_parallelComponents[componentIndex]->update(deltaTime);
+            }
+        }
+    });
+
+    for (Component* component : m_deferredComponents)
+    {
+        PROFILE_ZONE(component->getProfileName());
+        component->update(deltaTime);
+    }
 }
 
 std::shared_ptr<GameObject> Scene::addGameObject(const std::string& name, const glm::vec3& position, std::shared_ptr<GameObject> parent)
 {
-    std::shared_ptr<GameObject> go = std::make_shared<GameObject>(name, parent == nullptr ? std::static_pointer_cast<Entity>(shared_from_this()) : parent);
-    go->m_transform.position = position;
-    go->m_transform.rotation = glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, 0.0f)));
-    go->m_transform.scale = {1.0f, 1.0f, 1.0f};
+    std::shared_ptr<GameObject> go = std::make_shared<GameObject>(name, parent == nullptr ? std::static_pointer_cast<Entity>(shared_from_this()) : parent, m_transforms, parent == nullptr ? TransformStorage::INVALID_HANDLE : parent->transformHandle(), m_registry, m_cullingWorld);
+    go->transform().setPosition(position);
     m_children.emplace_back(go);
     return std::static_pointer_cast<GameObject>(go);
 }
@@ -78,3 +257,33 @@ std::shared_ptr<GameObject> Scene::addGameObject(const std::string& name, const
 {
     return addGameObject(name, position, nullptr);
 }
+
+TransformStorage& Scene::transforms()
+{
+    return *m_transforms;
+}
+
+Registry& Scene::registry()
+{
+    return *m_registry;
+}
+
+void Scene::addSystem(System system)
+{
+    m_systems.emplace_back(std::move(system));
+}
+
+const CullingWorld::Stats& Scene::cullingStats() const
+{
+    return m_cullingWorld->stats();
+}
+
+Scene::UpdateMode Scene::getUpdateMode() const
+{
+    return m_updateMode;
+}
+
+void Scene::setUpdateMode(UpdateMode mode)
+{
+    m_updateMode = mode;
+}
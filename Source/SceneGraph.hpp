@@ -2,13 +2,24 @@
 
 #include "ctti/type_id.hpp"
 #include "Korelib.hpp"
+#include "Bounds.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include "CullingWorld.hpp"
 #include "Gfx.hpp"
+#include "Registry.hpp"
+#include "TransformStorage.hpp"
 #include "glm/glm.hpp"
 
+#include <atomic>
+#include <functional>
+#include <iterator>
 #include <list>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 class Entity : public std::enable_shared_from_this<Entity>
@@ -24,24 +35,126 @@ public:
     virtual ~Entity() = default;
 
     virtual constexpr Kind kind() const = 0;
-    virtual void update();
+    // Seconds since the last frame, handed down from Scene::update so components never have to read it from Gfx
+    virtual void update(float deltaTime);
 
     const std::string& getName() const;
     void setName(const std::string& name);
+    // Interned copy of the name for profiler zones. Interned on first use while the profiler is enabled, null while it is not
+    const char* getProfileName() const;
 
-    const std::shared_ptr<Entity>& getParent() const;
+    // Null once the parent is gone, entities only own their children
+    std::shared_ptr<Entity> getParent() const;
+    bool hasParent() const;
 
 protected:
     Entity(const std::string& name, const std::shared_ptr<Entity>& parent);
     Entity(const std::string& name);
 
+    // Appends components below this entity in update order.
+    // Thread-safe components go to parallel, with one [begin, end) range per GameObject in batches; the rest go to deferred
+    void collectComponents(std::vector<class Component*>& parallel, std::vector<std::pair<std::size_t, std::size_t>>& batches, std::vector<class Component*>& deferred);
+
 
 protected:
     std::list<std::shared_ptr<Entity>> m_children;
 
 private:
     std::string m_name;
-    std::shared_ptr<Entity> m_parent;
+    // Cleared by setName, atomic because parallel updates profile components on worker threads
+    mutable std::atomic<const char*> m_profileName { nullptr };
+    // Weak so a scene and everything below it is released with the last outside reference
+    std::weak_ptr<Entity> m_parent;
+};
+
+class Component;
+
+// Non-owning view over the components of a single type, see GameObject::getComponents
+template<typename T>
+class ComponentView
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+
+        Iterator() = default;
+        explicit Iterator(Component* const* current) : m_current(current)
+        {
+        }
+
+        T& operator*() const
+        {
+            return *static_cast<T*>(*m_current);
+        }
+
+        T* operator->() const
+        {
+            return static_cast<T*>(*m_current);
+        }
+
+        Iterator& operator++()
+        {
+            ++m_current;
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            ++m_current;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const = default;
+
+    private:
+        Component* const* m_current { nullptr };
+    };
+
+public:
+    ComponentView() = default;
+    explicit ComponentView(std::span<Component* const> components) : m_components(components)
+    {
+    }
+
+    Iterator begin() const
+    {
+        return Iterator{ m_components.data() };
+    }
+
+    Iterator end() const
+    {
+        return Iterator{ m_components.data() + m_components.size() };
+    }
+
+    std::size_t size() const
+    {
+        return m_components.size();
+    }
+
+    bool empty() const
+    {
+        return m_components.empty();
+    }
+
+    T& operator[](std::size_t index) const
+    {
+        return *static_cast<T*>(m_components[index]);
+    }
+
+    T& front() const
+    {
+        return (*this)[0];
+    }
+
+private:
+    std::span<Component* const> m_components;
 };
 
 class GameObject final : public Entity
@@ -52,74 +165,84 @@ public:
         return Kind::GAME_OBJECT;
     }
 
-    GameObject(const std::string& name, const std::shared_ptr<Entity>& parent);
+    GameObject(const std::string& name, const std::shared_ptr<Entity>& parent, std::shared_ptr<TransformStorage> transforms, TransformStorage::Handle parentTransform, std::shared_ptr<Registry> registry, std::shared_ptr<CullingWorld> cullingWorld);
+    ~GameObject() override;
+
+    TransformRef transform();
+    TransformStorage::Handle transformHandle() const;
+    Registry::EntityId registryEntity() const;
+    const std::shared_ptr<CullingWorld>& cullingWorld() const;
 
     template<typename T, typename... TArgs>
     std::shared_ptr<T> addComponent(TArgs&&... args) requires(std::derived_from<T, class Component>)
     {
-        ctti::unnamed_type_id_t key = ctti::unnamed_type_id<T>();
+        constexpr ctti::unnamed_type_id_t key = ctti::unnamed_type_id<T>();
         std::shared_ptr<T> component = std::make_shared<T>(shared_from_this(), std::forward<TArgs>(args)...);
 
         m_children.emplace_back(component);
-        const std::size_t componentIndex = m_children.size() - 1;
+        m_componentsByType[key].emplace_back(component.get());
 
-        if(m_componentTypeToIndicesMap.contains(key))
-        {
-            std::vector<std::size_t>& componentsList = m_componentTypeToIndicesMap.at(key);
-            componentsList.emplace_back(componentIndex);
+        return component;
+    }
+
+    // Plain-data components live in the scene Registry, the reference is valid until the next structural change there
+    template<typename T, typename... TArgs>
+    T& addComponent(TArgs&&... args) requires(DataComponent<T> && !std::derived_from<T, class Component>)
+    {
+        return m_registry->add<T>(m_registryEntity, T{ std::forward<TArgs>(args)... });
+    }
 
-            return component;
+    template<typename T>
+    std::optional<std::reference_wrapper<T>> getComponent() const requires(DataComponent<T> && !std::derived_from<T, class Component>)
+    {
+        if (T* component = m_registry->tryGet<T>(m_registryEntity); component != nullptr)
+        {
+            return *component;
         }
 
-        std::vector<std::size_t> componentList{ componentIndex };
-        m_componentTypeToIndicesMap.insert(std::make_pair(key, std::move(componentList)));
-        return component;
+        return std::nullopt;
     }
 
     template<typename T>
-    std::vector<std::reference_wrapper<T>> getComponents() requires(std::derived_from<T, class Component>)
+    void removeComponent() requires(DataComponent<T> && !std::derived_from<T, class Component>)
     {
-        std::vector<std::reference_wrapper<T>> result{};
+        m_registry->remove<T>(m_registryEntity);
+    }
 
+    template<typename T>
+    ComponentView<T> getComponents() const requires(std::derived_from<T, class Component>)
+    {
         constexpr ctti::unnamed_type_id_t typeId = ctti::unnamed_type_id<T>();
-        if (m_componentTypeToIndicesMap.contains(typeId))
+        if (auto it = m_componentsByType.find(typeId); it != m_componentsByType.end())
         {
-            const std::vector<size_t>& indices = m_componentTypeToIndicesMap.at(typeId);
-            if (!indices.empty())
-            {
-                for (size_t index : indices)
-                {
-                    auto it = m_children.begin();
-                    std::advance(it, index);
-
-                    std::shared_ptr<T> component = std::static_pointer_cast<T>(*it);
-                    KORELIB_VERIFY_THROW(component != nullptr, korelib::RuntimeException, "component == nullptr");
-                    KORELIB_VERIFY_THROW(component->kind() == Entity::Kind::COMPONENT, korelib::RuntimeException, "Unexpected Entity type");
-                    result.emplace_back(*component);
-                }
-            }
+            return ComponentView<T>{ it->second };
         }
 
-        return result;
+        return ComponentView<T>{};
     }
 
     template<typename T>
-    std::optional<std::reference_wrapper<T>> getComponent() requires(std::derived_from<T, class Component>)
+    std::optional<std::reference_wrapper<T>> getComponent() const requires(std::derived_from<T, class Component>)
     {
-        std::vector<std::reference_wrapper<T>> components = getComponents<T>();
+        ComponentView<T> components = getComponents<T>();
         if (!components.empty())
         {
-            return components[0];
+            return components.front();
         }
 
         return std::nullopt;
     }
 
-public:
-    Gfx::Transform m_transform;
-
 protected:
-    std::unordered_map<ctti::unnamed_type_id_t, std::vector<size_t>> m_componentTypeToIndicesMap;
+    // Components of each exact type in insertion order, owned by m_children
+    std::unordered_map<ctti::unnamed_type_id_t, std::vector<Component*>> m_componentsByType;
+
+private:
+    std::shared_ptr<TransformStorage> m_transforms;
+    TransformStorage::Handle m_transformHandle;
+    std::shared_ptr<Registry> m_registry;
+    Registry::EntityId m_registryEntity;
+    std::shared_ptr<CullingWorld> m_cullingWorld;
 };
 
 class Component : public Entity
@@ -130,11 +253,45 @@ public:
         return Kind::COMPONENT;
     }
 
-    virtual void update() override;
+    virtual void update(float deltaTime) override;
     GameObject& gameObject();
 
+    // Thread-safe components only touch their own GameObject and the deltaTime passed to update(), they never call into Gfx or Input,
+    // so Scene may update them from a worker thread. Everything else is deferred to the thread that runs Scene::update
+    virtual bool isThreadSafe() const;
+
 protected:
     Component(const std::string& name, const std::shared_ptr<Entity>& parent);
+
+private:
+    // The GameObject owns its components, so it is alive whenever the weak parent is
+    GameObject* m_gameObject;
+};
+
+// Component that draws something. Scene culls it by its world bounds against the active camera
+// and calls render() only while it is visible, after every component was updated
+class RenderComponent : public Component
+{
+public:
+    ~RenderComponent() override;
+
+    // Bounds in the space of the owning GameObject, call markBoundsDirty() whenever they change
+    virtual AABB localBounds() const = 0;
+    virtual void render() = 0;
+
+protected:
+    RenderComponent(const std::string& name, const std::shared_ptr<Entity>& parent);
+
+    // Makes the next refit read localBounds() again even if the transform did not move
+    void markBoundsDirty();
+
+private:
+    friend class CullingWorld;
+
+    std::shared_ptr<CullingWorld> m_cullingWorld;
+    uint32_t m_cullingIndex { 0 };
+    BoundingVolumeHierarchy::ProxyId m_proxy { BoundingVolumeHierarchy::INVALID_PROXY };
+    bool m_boundsDirty { false };
 };
 
 class Scene final : public Entity
@@ -145,9 +302,44 @@ public:
         return Kind::SCENE;
     }
 
+    // Runs once per frame over the registry before the Entity hierarchy is updated
+    using System = std::function<void(Registry& registry, float deltaTime)>;
+
+    enum class UpdateMode : uint8_t
+    {
+        SERIAL,
+        PARALLEL
+    };
+
     static std::shared_ptr<Scene> create(const std::string& name);
 
     Scene(const std::string& name);
+    void update(float deltaTime) override;
     std::shared_ptr<GameObject> addGameObject(const std::string& name, const glm::vec3& position, std::shared_ptr<GameObject> parent);
     std::shared_ptr<GameObject> addGameObject(const std::string& name, const glm::vec3& position);
+
+    TransformStorage& transforms();
+    Registry& registry();
+    void addSystem(System system);
+
+    // Visible and culled render components of the last update
+    const CullingWorld::Stats& cullingStats() const;
+
+    UpdateMode getUpdateMode() const;
+    void setUpdateMode(UpdateMode mode);
+
+private:
+    void updateParallel(float deltaTime);
+    void render();
+
+private:
+    std::shared_ptr<TransformStorage> m_transforms;
+    std::shared_ptr<Registry> m_registry;
+    std::shared_ptr<CullingWorld> m_cullingWorld;
+    std::vector<System> m_systems;
+    UpdateMode m_updateMode { UpdateMode::SERIAL };
+
+    std::vector<Component*> m_parallelComponents;
+    std::vector<std::pair<std::size_t, std::size_t>> m_parallelBatches;
+    std::vector<Component*> m_deferredComponents;
 };
@@ -0,0 +1,242 @@
+#include "ShaderCache.hpp"
+#include "Profiler.hpp"
+
+#include "fmt/format.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+    constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+    constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    // FNV-1a continued over several strings, each one terminated by a byte no GLSL source contains
+    uint64_t hashAppend(uint64_t hash, std::string_view value)
+    {
+        for (char character : value)
+        {
+            hash ^= static_cast<uint8_t>(character);
+            hash *= FNV_PRIME;
+        }
+        hash ^= 0xFF;
+        hash *= FNV_PRIME;
+        return hash;
+    }
+}
+
+void ShaderCache::initialize(const std::filesystem::path& directory)
+{
+    PROFILE_ZONE("ShaderCache::initialize");
+    g_directory = directory;
+    g_driver = hashAppend(FNV_OFFSET_BASIS, Gfx::driverIdentity());
+    if (g_directory.empty() || Gfx::isHeadless())
+    {
+        return;
+    }
+
+    std::error_code error{};
+    std::filesystem::create_directories(g_directory, error);
+    for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(g_directory, error))
+    {
+        if (!file.is_regular_file(error) || file.path().extension() != CACHE_EXTENSION)
+        {
+            continue;
+        }
+
+        // The file may be gone or unreadable since the directory was scanned, it is skipped like any other bad entry
+        const std::uintmax_t fileSize = file.file_size(error);
+        if (error)
+        {
+            continue;
+        }
+
+        std::ifstream stream(file.path(), std::ios::binary);
+        CacheHeader header{};
+        const bool valid = stream.read(reinterpret_cast<char*>(&header), sizeof(header))
+            && header.magic == CACHE_MAGIC
+            && header.version == CACHE_VERSION
+            && header.driver == g_driver
+            && header.size == fileSize - sizeof(header);
+
+        CachedBinary binary{ .format = header.format, .data = {} };
+        if (valid)
+        {
+            binary.data.resize(static_cast<size_t>(header.size));
+            stream.read(reinterpret_cast<char*>(binary.data.data()), static_cast<std::streamsize>(binary.data.size()));
+        }
+
+        // Binaries of an older driver or cache version can never load again
+        if (!valid || !stream)
+        {
+            stream.close();
+            std::filesystem::remove(file.path(), error);
+            continue;
+        }
+
+        g_binaries.insert_or_assign(header.key, std::move(binary));
+    }
+}
+
+void ShaderCache::destroy()
+{
+    for (auto& [key, entry] : g_entries)
+    {
+        Gfx::destroyShaderProgram(entry.program);
+    }
+
+    g_entries.clear();
+    g_binaries.clear();
+    g_pending.clear();
+    g_directory.clear();
+    g_stats = {};
+}
+
+ShaderCache::ProgramKey ShaderCache::makeKey(std::string_view vertexSource, std::string_view fragmentSource, std::span<const std::string_view> defines)
+{
+    uint64_t hash = hashAppend(hashAppend(FNV_OFFSET_BASIS, vertexSource), fragmentSource);
+    for (std::string_view define : defines)
+    {
+        hash = hashAppend(hash, define);
+    }
+    return hash;
+}
+
+ShaderCache::ProgramKey ShaderCache::request(std::string_view vertexSource, std::string_view fragmentSource, std::span<const std::string_view> defines)
+{
+    const ProgramKey key = makeKey(vertexSource, fragmentSource, defines);
+    if (g_entries.contains(key))
+    {
+        return key;
+    }
+
+    PROFILE_ZONE("ShaderCache::request");
+    if (auto binaryIt = g_binaries.find(key); binaryIt != g_binaries.end())
+    {
+        const Gfx::ShaderType program = Gfx::shaderProgramFromBinary(binaryIt->second.format, binaryIt->second.data);
+        g_binaries.erase(binaryIt);
+        if (program != 0)
+        {
+            g_entries.emplace(key, Entry{ .program = program, .state = State::READY });
+            g_stats.binaryLoads++;
+            g_stats.programs++;
+            return key;
+        }
+
+        // Rebuilt from source below, which also replaces the file
+        g_stats.binaryRejects++;
+    }
+
+    const Gfx::ShaderType program = Gfx::beginShaderProgram(Gfx::insertShaderDefines(vertexSource, defines), Gfx::insertShaderDefines(fragmentSource, defines));
+    g_entries.emplace(key, Entry{ .program = program, .state = State::PENDING });
+    g_pending.emplace_back(key);
+    g_stats.compiled++;
+    g_stats.programs++;
+    g_stats.pending++;
+
+    return key;
+}
+
+Gfx::ShaderType ShaderCache::acquire(std::string_view vertexSource, std::string_view fragmentSource, std::span<const std::string_view> defines)
+{
+    const ProgramKey key = request(vertexSource, fragmentSource, defines);
+    Entry& entry = g_entries.at(key);
+    if (entry.state == State::PENDING)
+    {
+        std::erase(g_pending, key);
+        complete(key, entry);
+    }
+
+    return program(key);
+}
+
+Gfx::ShaderType ShaderCache::program(ProgramKey key)
+{
+    auto entryIt = g_entries.find(key);
+    return entryIt != g_entries.end() && entryIt->second.state == State::READY ? entryIt->second.program : Gfx::defaultShaderProgram();
+}
+
+bool ShaderCache::isReady(ProgramKey key)
+{
+    auto entryIt = g_entries.find(key);
+    return entryIt != g_entries.end() && entryIt->second.state == State::READY;
+}
+
+void ShaderCache::update()
+{
+    if (g_pending.empty())
+    {
+        return;
+    }
+
+    PROFILE_ZONE("ShaderCache::update");
+    for (size_t pendingIndex = 0; pendingIndex < g_pending.size();)
+    {
+        const ProgramKey key = g_pending[pendingIndex];
+        Entry& entry = g_entries.at(key);
+        if (!Gfx::isShaderProgramCompleted(entry.program))
+        {
+            pendingIndex++;
+            continue;
+        }
+
+        // Out of the list before completing, a failed build must not be finished twice
+        g_pending[pendingIndex] = g_pending.back();
+        g_pending.pop_back();
+        complete(key, entry);
+    }
+}
+
+void ShaderCache::complete(ProgramKey key, Entry& entry)
+{
+    PROFILE_ZONE("ShaderCache::complete");
+    g_stats.pending--;
+
+    // A program that fails to build stays FAILED and keeps drawing with the default program, one bad variant must not end the frame
+    try
+    {
+        Gfx::finishShaderProgram(entry.program);
+    }
+    catch (const korelib::RuntimeException& exception)
+    {
+        std::fprintf(stderr, "Shader program %016llx failed to build: %s\n", static_cast<unsigned long long>(key), exception.what());
+        entry.state = State::FAILED;
+        return;
+    }
+    entry.state = State::READY;
+
+    writeBinary(key, entry.program);
+}
+
+void ShaderCache::writeBinary(ProgramKey key, Gfx::ShaderType program)
+{
+    if (g_directory.empty() || Gfx::isHeadless())
+    {
+        return;
+    }
+
+    const Gfx::ShaderProgramBinary binary = Gfx::getShaderProgramBinary(program);
+    if (binary.data.empty())
+    {
+        return;
+    }
+
+    const CacheHeader header{
+        .magic = CACHE_MAGIC,
+        .version = CACHE_VERSION,
+        .format = binary.format,
+        .key = key,
+        .driver = g_driver,
+        .size = binary.data.size()
+    };
+
+    // A partially written file fails the size check on the next start and is rebuilt
+    std::ofstream stream(binaryPath(key), std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(binary.data.data()), static_cast<std::streamsize>(binary.data.size()));
+}
+
+std::filesystem::path ShaderCache::binaryPath(ProgramKey key)
+{
+    return g_directory / fmt::format("{:016x}{}", key, CACHE_EXTENSION);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Gfx.hpp"
+#include "Korelib.hpp"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Owns every shader program but the default one.
+// Programs are keyed by a hash of their sources and defines. Requesting a program that is not linked yet starts the
+// link without waiting for it, and program() hands out Gfx::defaultShaderProgram() until update() sees it finished.
+// Linked programs are written to the cache directory as driver binaries and loaded from there on the next start.
+// Render thread only.
+class ShaderCache final : public korelib::StaticOnlyClass
+{
+public:
+    using ProgramKey = uint64_t;
+
+    struct Stats
+    {
+        uint32_t programs;
+        uint32_t pending;
+        uint32_t compiled;
+        uint32_t binaryLoads;
+        // Binaries the driver refused even though the driver identity matched
+        uint32_t binaryRejects;
+    };
+
+    static constexpr std::array<char, 8> CACHE_MAGIC { 'L', 'O', 'G', 'L', 'P', 'R', 'O', 'G' };
+    static constexpr uint32_t CACHE_VERSION = 1;
+    static constexpr std::string_view CACHE_EXTENSION = ".glprog";
+
+public:
+    // Must be called after Gfx::initialize. Reads the binaries of the current driver and deletes stale ones.
+    // Without initialize, or with an empty directory, programs are still cached for the session but never written.
+    static void initialize(const std::filesystem::path& directory);
+    static void destroy();
+
+    // Defines go through Gfx::insertShaderDefines, e.g. "FOG" or "LIGHTS 4"
+    static ProgramKey makeKey(std::string_view vertexSource, std::string_view fragmentSource, std::span<const std::string_view> defines);
+
+    // Starts building the program unless it is cached already, never waits for the driver
+    static ProgramKey request(std::string_view vertexSource, std::string_view fragmentSource, std::span<const std::string_view> defines = {});
+    // Like request, but waits until the program is linked. Falls back to the default program when it failed to build
+    static Gfx::ShaderType acquire(std::string_view vertexSource, std::string_view fragmentSource, std::span<const std::string_view> defines = {});
+
+    // The linked program, or the default program while it is still being built or after it failed to build
+    static Gfx::ShaderType program(ProgramKey key);
+    static bool isReady(ProgramKey key);
+
+    // Called by Gfx::beginFrame, finishes the programs the driver is done with
+    static void update();
+
+    static const Stats& stats()
+    {
+        return g_stats;
+    }
+
+private:
+    enum class State : uint8_t
+    {
+        PENDING,
+        READY,
+        FAILED
+    };
+
+    struct Entry
+    {
+        Gfx::ShaderType program;
+        State state;
+    };
+
+    struct CachedBinary
+    {
+        uint32_t format;
+        std::vector<std::byte> data;
+    };
+
+    struct CacheHeader
+    {
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint32_t format;
+        ProgramKey key;
+        // Hash of Gfx::driverIdentity(), binaries only load on the driver that wrote them
+        uint64_t driver;
+        uint64_t size;
+    };
+
+    static_assert(sizeof(CacheHeader) == 40);
+
+    static void complete(ProgramKey key, Entry& entry);
+    static void writeBinary(ProgramKey key, Gfx::ShaderType program);
+    static std::filesystem::path binaryPath(ProgramKey key);
+
+private:
+    static inline std::filesystem::path g_directory {};
+    static inline uint64_t g_driver { 0 };
+    static inline std::unordered_map<ProgramKey, Entry> g_entries {};
+    static inline std::unordered_map<ProgramKey, CachedBinary> g_binaries {};
+    static inline std::vector<ProgramKey> g_pending {};
+    static inline Stats g_stats {};
+};
@@ -0,0 +1,46 @@
+#include "ShaderPermutations.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+
+Gfx::ShaderType ShaderPermutations::program(FeatureMask features)
+{
+    KORELIB_VERIFY_THROW((features & ~ALL_FEATURES) == 0, korelib::RuntimeException, fmt::format("Unknown shader feature bits {:#x}", features));
+    KORELIB_VERIFY_THROW((features & VOXEL) == 0 || (features & TEXTURE_ARRAY) != 0, korelib::RuntimeException, "VOXEL variants sample a texture array and need TEXTURE_ARRAY");
+    if (features == DEFAULT_FEATURES)
+    {
+        return Gfx::defaultShaderProgram();
+    }
+
+    std::optional<ShaderCache::ProgramKey>& variant = g_variants[features];
+    if (!variant.has_value())
+    {
+        variant = ShaderCache::request(Gfx::DEFAULT_VERTEX_SHADER, Gfx::DEFAULT_FRAGMENT_SHADER, definesOf(features).view());
+    }
+
+    return ShaderCache::program(*variant);
+}
+
+bool ShaderPermutations::isReady(FeatureMask features)
+{
+    if (features == DEFAULT_FEATURES)
+    {
+        return true;
+    }
+
+    const std::optional<ShaderCache::ProgramKey>& variant = g_variants[features & ALL_FEATURES];
+    return variant.has_value() && ShaderCache::isReady(*variant);
+}
+
+uint32_t ShaderPermutations::usedVariantCount()
+{
+    return 1 + static_cast<uint32_t>(std::count_if(g_variants.begin(), g_variants.end(), [](const std::optional<ShaderCache::ProgramKey>& variant) {
+        return variant.has_value();
+    }));
+}
+
+void ShaderPermutations::reset()
+{
+    g_variants = {};
+}
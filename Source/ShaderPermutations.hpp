@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Gfx.hpp"
+#include "Korelib.hpp"
+#include "ShaderCache.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+// Variants of Gfx::DEFAULT_VERTEX_SHADER/DEFAULT_FRAGMENT_SHADER, one per combination of feature bits.
+// A variant is only built the first time something asks for it, through ShaderCache, and only compiles the code of
+// its own features. Uniforms sit at explicit locations, so which of them a variant has is known at compile time.
+class ShaderPermutations final : public korelib::StaticOnlyClass
+{
+public:
+    using FeatureMask = uint32_t;
+
+    enum Feature : FeatureMask
+    {
+        NONE = 0,
+        // Model matrix and parameters per instance from the instance buffer instead of uniforms
+        INSTANCING = 1u << 0,
+        // Samples a sampler2DArray, the layer comes per instance or from the layer uniform
+        TEXTURE_ARRAY = 1u << 1,
+        // Directional plus ambient light from Gfx::Environment, with face normals from screen space derivatives
+        LIGHTING = 1u << 2,
+        // Linear fog over the view distance, from Gfx::Environment
+        FOG = 1u << 3,
+        // VoxelMesher::Vertex input, faces tile a texture array region per block. Needs TEXTURE_ARRAY.
+        VOXEL = 1u << 4
+    };
+
+    static constexpr uint32_t FEATURE_COUNT = 5;
+    static constexpr FeatureMask ALL_FEATURES = (1u << FEATURE_COUNT) - 1;
+    static constexpr uint32_t VARIANT_COUNT = 1u << FEATURE_COUNT;
+    // Define of feature bit i
+    static constexpr std::array<std::string_view, FEATURE_COUNT> FEATURE_DEFINES { Gfx::INSTANCING_DEFINE, "TEXTURE_ARRAY", "LIGHTING", "FOG", "VOXEL" };
+    // RenderQueue submits every batch as an instanced draw, this is the variant Gfx::defaultShaderProgram() is built as
+    static constexpr FeatureMask DEFAULT_FEATURES = INSTANCING;
+
+    enum class Uniform : Gfx::UniformLocationType
+    {
+        MODEL = Gfx::MODEL_UNIFORM_LOCATION,
+        TEXTURE_LAYER = Gfx::TEXTURE_LAYER_UNIFORM_LOCATION
+    };
+
+    static constexpr bool hasUniform(Uniform uniform, FeatureMask features)
+    {
+        switch (uniform)
+        {
+            case Uniform::MODEL:
+                return (features & INSTANCING) == 0;
+            case Uniform::TEXTURE_LAYER:
+                return (features & (INSTANCING | TEXTURE_ARRAY)) == TEXTURE_ARRAY;
+        }
+        return false;
+    }
+
+    // Defines of a feature mask, in bit order
+    struct Defines
+    {
+        std::array<std::string_view, FEATURE_COUNT> names;
+        uint32_t count;
+
+        std::span<const std::string_view> view() const
+        {
+            return { names.data(), count };
+        }
+    };
+
+    static constexpr Defines definesOf(FeatureMask features)
+    {
+        Defines defines{ .names = {}, .count = 0 };
+        for (uint32_t bit = 0; bit < FEATURE_COUNT; bit++)
+        {
+            if ((features & (1u << bit)) != 0)
+            {
+                defines.names[defines.count++] = FEATURE_DEFINES[bit];
+            }
+        }
+        return defines;
+    }
+
+    // A variant fixed at compile time, asking it for a uniform it was not built with doesn't compile
+    template<FeatureMask Features>
+    struct Variant
+    {
+        static_assert((Features & ~ALL_FEATURES) == 0, "Unknown shader feature bits");
+
+        static constexpr FeatureMask FEATURES = Features;
+        static constexpr Defines DEFINES = definesOf(Features);
+
+        template<Uniform U>
+        static constexpr Gfx::UniformLocationType location()
+        {
+            static_assert(hasUniform(U, Features), "This variant is not built with that uniform");
+            return static_cast<Gfx::UniformLocationType>(U);
+        }
+
+        static Gfx::ShaderType program()
+        {
+            return ShaderPermutations::program(Features);
+        }
+    };
+
+public:
+    // Requests the variant on first use and returns the default program until it is linked
+    static Gfx::ShaderType program(FeatureMask features);
+    static bool isReady(FeatureMask features);
+    // Variants requested so far, the default program counts as one
+    static uint32_t usedVariantCount();
+    // Forgets the requested variants, their programs belong to ShaderCache
+    static void reset();
+
+private:
+    static inline std::array<std::optional<ShaderCache::ProgramKey>, VARIANT_COUNT> g_variants {};
+};
@@ -1,14 +1,130 @@
 #include "Texture.hpp"
+#include "Archive.hpp"
 #include "Gfx.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+Texture::~Texture() noexcept
+{
+    if (m_ownsTexture)
+    {
+        Gfx::destroyTextureObject(m_textureId.load(std::memory_order_acquire));
+    }
+}
+
+Texture::State Texture::getState() const noexcept
+{
+    return m_state.load(std::memory_order_acquire);
+}
+
+bool Texture::isPending() const noexcept
+{
+    return getState() == State::LOADING;
+}
+
 void Texture::load()
 {
-    uint8_t* data = stbi_load(getPath().string().c_str(), &m_width, &m_height, &m_channels, 0);
-    KORELIB_VERIFY_THROW(data != nullptr, korelib::RuntimeException, fmt::format("Failed to load texture '{}'", getPath().string()));
+    m_state.store(State::LOADING, std::memory_order_release);
+    try
+    {
+        upload(decode(getPath(), getStorageType()));
+    }
+    catch (...)
+    {
+        m_state.store(State::FAILED, std::memory_order_release);
+        throw;
+    }
+}
+
+Texture::Pixels Texture::decode(const std::filesystem::path& path, StorageType storageType)
+{
+    Pixels pixels{};
+    std::span<const std::byte> bytes{};
+    switch (storageType)
+    {
+        case StorageType::LOCAL:
+        {
+            std::ifstream stream(path, std::ios::binary);
+            KORELIB_VERIFY_THROW(stream.is_open(), korelib::RuntimeException, fmt::format("Failed to open texture '{}'", path.string()));
 
-    m_textureId = Gfx::textureFromData(data, m_width, m_height);
+            pixels.storage.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+            bytes = std::as_bytes(std::span(pixels.storage));
+            break;
+        }
+        case StorageType::ARCHIVE:
+        {
+            Archive::MountedEntry entry = Archive::findMounted(path);
+            KORELIB_VERIFY_THROW(entry.archive != nullptr, korelib::RuntimeException, fmt::format("Texture '{}' is not in any mounted archive", path.string()));
+
+            pixels.archive = std::move(entry.archive);
+            bytes = entry.data;
+            break;
+        }
+    }
+
+    if (TextureCompression::isCache(bytes))
+    {
+        TextureCompression::TextureView view = TextureCompression::parse(bytes);
+        pixels.format = view.format;
+        pixels.channels = view.channels;
+        pixels.levels = std::move(view.levels);
+        return pixels;
+    }
+
+    TextureCompression::Image image{};
+    uint8_t* data = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(bytes.data()), static_cast<int>(bytes.size()), &image.width, &image.height, &image.channels, 0);
+    KORELIB_VERIFY_THROW(data != nullptr, korelib::RuntimeException, fmt::format("Failed to load texture '{}': {}", path.string(), stbi_failure_reason()));
+
+    image.pixels.assign(data, data + static_cast<std::size_t>(image.width) * image.height * image.channels);
     stbi_image_free(data);
+
+    const std::vector<TextureCompression::Image> mipChain = TextureCompression::generateMipChain(image, TextureCompression::MipFilter::BOX);
+
+    std::size_t storageSize = 0;
+    for (const TextureCompression::Image& level : mipChain)
+    {
+        storageSize += level.pixels.size();
+    }
+
+    pixels.format = TextureCompression::uncompressedFormat(image.channels);
+    pixels.channels = image.channels;
+    pixels.archive.reset();
+    pixels.storage.resize(storageSize);
+
+    std::size_t offset = 0;
+    for (const TextureCompression::Image& level : mipChain)
+    {
+        std::memcpy(pixels.storage.data() + offset, level.pixels.data(), level.pixels.size());
+        pixels.levels.emplace_back(TextureCompression::Level{ .width = level.width, .height = level.height, .data = { pixels.storage.data() + offset, level.pixels.size() } });
+        offset += level.pixels.size();
+    }
+
+    return pixels;
+}
+
+void Texture::upload(const Pixels& pixels)
+{
+    // Swapped before the old texture is destroyed, so a reader never sees a deleted id
+    const Gfx::TextureIdType previous = m_textureId.exchange(Gfx::textureFromData(pixels.format, pixels.levels), std::memory_order_acq_rel);
+    if (m_ownsTexture)
+    {
+        Gfx::destroyTextureObject(previous);
+    }
+    m_ownsTexture = true;
+    m_width = pixels.levels.front().width;
+    m_height = pixels.levels.front().height;
+    m_channels = pixels.channels;
+
+    uint64_t gpuBytes = 0;
+    for (const TextureCompression::Level& level : pixels.levels)
+    {
+        gpuBytes += level.data.size();
+    }
+    setMemoryUsage(0, gpuBytes);
+    m_state.store(State::LOADED, std::memory_order_release);
 }
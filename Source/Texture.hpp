@@ -2,18 +2,52 @@
 
 #include "Gfx.hpp"
 #include "Resource.hpp"
+#include "TextureCompression.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class Archive;
+class TextureLoader;
 
 class Texture : public Resource
 {
+public:
+    enum class State : uint8_t
+    {
+        UNLOADED,
+        LOADING,
+        LOADED,
+        FAILED
+    };
+
+    // Mip chain ready for upload. Levels point into storage, or straight into a texture cache inside a mapped archive.
+    struct Pixels
+    {
+        TextureCompression::Format format { TextureCompression::Format::RGB8 };
+        int32_t channels {0};
+        std::vector<TextureCompression::Level> levels;
+        std::vector<uint8_t> storage;
+        // Keeps the mapping alive while levels point into it
+        std::shared_ptr<const Archive> archive;
+    };
+
 public:
     template<korelib::concepts::PathLike PathType>
     constexpr Texture(PathType&& path, StorageType storageType) noexcept : Resource{std::forward<PathType>(path), storageType}
     {
     }
 
-    constexpr Gfx::TextureIdType getTextureId() const noexcept
+    ~Texture() noexcept override;
+
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
+    // Safe to call from any thread, the loading placeholder while TextureLoader works on the texture
+    Gfx::TextureIdType getTextureId() const noexcept
     {
-        return m_textureId;
+        return m_textureId.load(std::memory_order_acquire);
     }
 
     constexpr int32_t getWidth() const noexcept
@@ -31,11 +65,30 @@ public:
         return m_channels;
     }
 
+    State getState() const noexcept;
+    bool isPending() const noexcept override;
+
+    // Decodes and uploads on the calling thread
     void load();
 
+    // Safe to call from any thread, the texture is left untouched.
+    // Texture caches are used as they are, any other image is decoded by stb_image and gets a box filtered mip chain.
+    // ARCHIVE resources are read straight from the mapped bytes of the mounted archives.
+    static Pixels decode(const std::filesystem::path& path, StorageType storageType);
+
+private:
+    friend class TextureLoader;
+
+    // Render thread only
+    void upload(const Pixels& pixels);
+
 private:
-    Gfx::TextureIdType m_textureId {0};
+    // Atomic because TextureLoader::request may point it at the placeholder from any thread while the render thread binds it
+    std::atomic<Gfx::TextureIdType> m_textureId {0};
     int32_t m_width {0};
     int32_t m_height {0};
     int32_t m_channels {0};
+    // False while m_textureId points at a texture owned by someone else, like the loading placeholder
+    bool m_ownsTexture {false};
+    std::atomic<State> m_state { State::UNLOADED };
 };
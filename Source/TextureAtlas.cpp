@@ -0,0 +1,281 @@
+#include "TextureAtlas.hpp"
+#include "Archive.hpp"
+#include "Texture.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+    constexpr int32_t MAX_PAGE_SIZE = 16384;
+
+    struct Placement
+    {
+        uint32_t layer;
+        int32_t x;
+        int32_t y;
+    };
+
+    // Padded size rounded up to alignment, which keeps every shelf offset aligned as well
+    int32_t cellSize(int32_t size, int32_t padding, int32_t alignment)
+    {
+        return (size + padding * 2 + alignment - 1) / alignment * alignment;
+    }
+
+    // Shelf packing of the aligned padded sizes, tallest first. Returns false when a texture does not fit a page at all,
+    // or, with a page limit, when more pages would be needed.
+    bool shelfPack(std::span<const TextureCompression::Image> images, int32_t padding, int32_t alignment, int32_t pageSize, uint32_t maxPages, std::vector<Placement>& placements, uint32_t& pageCount)
+    {
+        std::vector<std::size_t> order(images.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&images](std::size_t lhs, std::size_t rhs) { return images[lhs].height > images[rhs].height; });
+
+        placements.assign(images.size(), {});
+        pageCount = images.empty() ? 0 : 1;
+
+        int32_t shelfX = 0;
+        int32_t shelfY = 0;
+        int32_t shelfHeight = 0;
+        for (std::size_t index : order)
+        {
+            const int32_t width = cellSize(images[index].width, padding, alignment);
+            const int32_t height = cellSize(images[index].height, padding, alignment);
+            if (width > pageSize || height > pageSize)
+            {
+                return false;
+            }
+
+            if (shelfX + width > pageSize)
+            {
+                shelfX = 0;
+                shelfY += shelfHeight;
+                shelfHeight = 0;
+            }
+
+            if (shelfY + height > pageSize)
+            {
+                if (++pageCount > maxPages)
+                {
+                    return false;
+                }
+                shelfX = 0;
+                shelfY = 0;
+                shelfHeight = 0;
+            }
+
+            placements[index] = { pageCount - 1, shelfX, shelfY };
+            shelfX += width;
+            shelfHeight = std::max(shelfHeight, height);
+        }
+
+        return true;
+    }
+
+    // Copies image into page at (x, y) + padding and extrudes its edge pixels into the rest of its cell
+    void blit(const TextureCompression::Image& image, TextureCompression::Image& page, int32_t x, int32_t y, int32_t padding, int32_t alignment)
+    {
+        const int32_t cellWidth = cellSize(image.width, padding, alignment);
+        const int32_t cellHeight = cellSize(image.height, padding, alignment);
+        for (int32_t row = -padding; row < cellHeight - padding; row++)
+        {
+            const int32_t sourceRow = std::clamp(row, 0, image.height - 1);
+            for (int32_t column = -padding; column < cellWidth - padding; column++)
+            {
+                const int32_t sourceColumn = std::clamp(column, 0, image.width - 1);
+                const uint8_t* source = image.pixels.data() + (static_cast<std::size_t>(sourceRow) * image.width + sourceColumn) * 4;
+                uint8_t* destination = page.pixels.data() + (static_cast<std::size_t>(y + padding + row) * page.width + x + padding + column) * 4;
+                std::memcpy(destination, source, 4);
+            }
+        }
+    }
+
+
+    TextureCompression::Image decodeRgba(const TextureAtlas::Source& source)
+    {
+        const Texture::Pixels pixels = Texture::decode(source.path, source.storageType);
+        const TextureCompression::Level& level = pixels.levels.front();
+
+        switch (pixels.format)
+        {
+            case TextureCompression::Format::BC1:
+                return TextureCompression::decodeBC1(level.data, level.width, level.height);
+            case TextureCompression::Format::BC3:
+                return TextureCompression::decodeBC3(level.data, level.width, level.height);
+            case TextureCompression::Format::BC7:
+                return TextureCompression::decodeBC7(level.data, level.width, level.height);
+            default:
+                return TextureCompression::toRgba({ level.width, level.height, pixels.channels, std::vector<uint8_t>(level.data.begin(), level.data.end()) });
+        }
+    }
+}
+
+TextureAtlas::Pages TextureAtlas::pack(std::span<const TextureCompression::Image> images, const Settings& settings)
+{
+    KORELIB_VERIFY_THROW(settings.padding >= 0, korelib::RuntimeException, "Atlas padding must not be negative");
+
+    // Level n shrinks the border to padding / 2^n texels, levels past the last one that keeps a full texel would blend
+    // neighbouring regions. Cells aligned to a texel of that last level keep every texel of the kept levels inside one region
+    const std::size_t levelCount = std::max<std::size_t>(std::bit_width(static_cast<uint32_t>(settings.padding)), 1);
+    const int32_t alignment = 1 << (levelCount - 1);
+
+    int32_t largest = 1;
+    uint64_t totalArea = 0;
+    for (const TextureCompression::Image& image : images)
+    {
+        KORELIB_VERIFY_THROW(image.channels == 4, korelib::RuntimeException, "Atlas images must be RGBA");
+        const int32_t cellWidth = cellSize(image.width, settings.padding, alignment);
+        const int32_t cellHeight = cellSize(image.height, settings.padding, alignment);
+        largest = std::max({ largest, cellWidth, cellHeight });
+        totalArea += static_cast<uint64_t>(cellWidth) * cellHeight;
+    }
+
+    const uint32_t maxPages = settings.layout == Layout::ATLAS ? 1 : std::numeric_limits<uint32_t>::max();
+    int32_t pageSize = settings.pageSize;
+    if (pageSize == 0)
+    {
+        pageSize = static_cast<int32_t>(std::bit_ceil(static_cast<uint32_t>(largest)));
+        if (settings.layout == Layout::ATLAS)
+        {
+            while (static_cast<uint64_t>(pageSize) * pageSize < totalArea)
+            {
+                pageSize *= 2;
+            }
+        }
+    }
+
+    std::vector<Placement> placements{};
+    uint32_t pageCount = 0;
+    while (!shelfPack(images, settings.padding, alignment, pageSize, maxPages, placements, pageCount))
+    {
+        // An explicit page size is a hard limit, only the automatic atlas size grows
+        KORELIB_VERIFY_THROW(settings.pageSize == 0 && settings.layout == Layout::ATLAS && pageSize < MAX_PAGE_SIZE, korelib::RuntimeException,
+            fmt::format("Textures do not fit into {}x{} pages", pageSize, pageSize));
+        pageSize *= 2;
+    }
+
+    Pages pages{};
+    pages.levelCount = levelCount;
+    pages.layers.assign(pageCount, TextureCompression::Image{ pageSize, pageSize, 4, std::vector<uint8_t>(static_cast<std::size_t>(pageSize) * pageSize * 4) });
+    pages.regions.reserve(images.size());
+
+    const float pageScale = 1.0f / static_cast<float>(pageSize);
+    for (std::size_t index = 0; index < images.size(); index++)
+    {
+        const Placement& placement = placements[index];
+        blit(images[index], pages.layers[placement.layer], placement.x, placement.y, settings.padding, alignment);
+
+        pages.regions.emplace_back(Region{
+            .layer = placement.layer,
+            .offset = glm::vec2(placement.x + settings.padding, placement.y + settings.padding) * pageScale,
+            .scale = glm::vec2(images[index].width, images[index].height) * pageScale
+        });
+    }
+
+    return pages;
+}
+
+std::shared_ptr<TextureAtlas> TextureAtlas::build(std::span<const Source> sources)
+{
+    return build(sources, Settings{});
+}
+
+std::shared_ptr<TextureAtlas> TextureAtlas::build(std::span<const Source> sources, const Settings& settings)
+{
+    KORELIB_VERIFY_THROW(!sources.empty(), korelib::RuntimeException, "Atlas has no textures");
+
+    std::vector<TextureCompression::Image> images{};
+    images.reserve(sources.size());
+    for (const Source& source : sources)
+    {
+        images.emplace_back(decodeRgba(source));
+    }
+
+    const Pages pages = pack(images, settings);
+    const int32_t pageSize = pages.layers.front().width;
+
+    // Mip chains per page, then each level laid out layer after layer the way glTexImage3D expects.
+    // The chain stops at pages.levelCount and Gfx clamps GL_TEXTURE_MAX_LEVEL to what was uploaded
+    std::vector<std::vector<TextureCompression::Image>> chains{};
+    for (const TextureCompression::Image& layer : pages.layers)
+    {
+        std::vector<TextureCompression::Image>& chain = chains.emplace_back(TextureCompression::generateMipChain(layer, settings.mipFilter));
+        chain.resize(std::min(chain.size(), pages.levelCount));
+    }
+
+    std::vector<std::vector<uint8_t>> levelData(chains.front().size());
+    std::vector<TextureCompression::Level> levels{};
+    for (std::size_t levelIndex = 0; levelIndex < levelData.size(); levelIndex++)
+    {
+        for (const std::vector<TextureCompression::Image>& chain : chains)
+        {
+            levelData[levelIndex].insert(levelData[levelIndex].end(), chain[levelIndex].pixels.begin(), chain[levelIndex].pixels.end());
+        }
+
+        const TextureCompression::Image& level = chains.front()[levelIndex];
+        levels.emplace_back(TextureCompression::Level{ .width = level.width, .height = level.height, .data = levelData[levelIndex] });
+    }
+
+    const uint32_t layerCount = static_cast<uint32_t>(pages.layers.size());
+    const Gfx::TextureIdType textureId = settings.layout == Layout::ATLAS
+        ? Gfx::textureFromData(TextureCompression::Format::RGBA8, levels)
+        : Gfx::textureArrayFromData(TextureCompression::Format::RGBA8, layerCount, levels);
+
+    std::unordered_map<std::string, Region> regions{};
+    for (std::size_t index = 0; index < sources.size(); index++)
+    {
+        regions.emplace(Archive::entryNameOf(sources[index].path), pages.regions[index]);
+    }
+
+    return std::shared_ptr<TextureAtlas>(new TextureAtlas(settings.layout, textureId, pageSize, layerCount, std::move(regions)));
+}
+
+TextureAtlas::TextureAtlas(Layout layout, Gfx::TextureIdType textureId, int32_t pageSize, uint32_t layerCount, std::unordered_map<std::string, Region> regions)
+    : m_layout(layout), m_textureId(textureId), m_pageSize(pageSize), m_layerCount(layerCount), m_regions(std::move(regions))
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    Gfx::destroyTextureObject(m_textureId);
+}
+
+std::optional<TextureAtlas::Region> TextureAtlas::find(const std::filesystem::path& path) const
+{
+    if (auto it = m_regions.find(Archive::entryNameOf(path)); it != m_regions.end())
+    {
+        return it->second;
+    }
+
+    return std::nullopt;
+}
+
+void TextureAtlas::remapUVs(std::span<Gfx::Vertex> vertices, const Region& region)
+{
+    for (Gfx::Vertex& vertex : vertices)
+    {
+        vertex.uv = region.remap(vertex.uv);
+    }
+}
+
+TextureAtlas::Layout TextureAtlas::getLayout() const
+{
+    return m_layout;
+}
+
+Gfx::TextureIdType TextureAtlas::getTextureId() const
+{
+    return m_textureId;
+}
+
+int32_t TextureAtlas::getPageSize() const
+{
+    return m_pageSize;
+}
+
+uint32_t TextureAtlas::getLayerCount() const
+{
+    return m_layerCount;
+}
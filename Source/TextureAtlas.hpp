@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Gfx.hpp"
+#include "Resource.hpp"
+#include "TextureCompression.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Packs many block textures into shared pages so draws using different textures keep one texture binding.
+// Textures are shelf packed with an extruded border against bleeding and looked up by their resource path.
+//   ATLAS: a single page uploaded as a 2D texture, meshes sample it through remapped UVs
+//   ARRAY: as many pages as needed, uploaded as layers of a 2D array texture
+class TextureAtlas
+{
+public:
+    enum class Layout : uint8_t
+    {
+        ATLAS,
+        ARRAY
+    };
+
+    struct Settings
+    {
+        Layout layout { Layout::ARRAY };
+        // Side of every page, 0 picks the smallest power of two that fits the largest texture (ARRAY) or all of them (ATLAS)
+        int32_t pageSize { 0 };
+        // Border around each texture filled with its edge pixels, keeps filtering from bleeding.
+        // Also limits the mip chain to log2(padding) + 1 levels, the deepest level that still has a border texel.
+        // Regions are aligned to the texel size of that level so no mip texel covers two of them
+        int32_t padding { 4 };
+        TextureCompression::MipFilter mipFilter { TextureCompression::MipFilter::BOX };
+    };
+
+    struct Source
+    {
+        std::filesystem::path path;
+        Resource::StorageType storageType;
+    };
+
+    // Where a texture ended up, maps its original [0, 1] UVs into the page
+    struct Region
+    {
+        uint32_t layer;
+        glm::vec2 offset;
+        glm::vec2 scale;
+
+        glm::vec2 remap(glm::vec2 uv) const
+        {
+            return offset + uv * scale;
+        }
+    };
+
+    // CPU result of packing, one RGBA image per page
+    struct Pages
+    {
+        std::vector<TextureCompression::Image> layers;
+        std::vector<Region> regions;
+        // Mip levels the pages can have before a texel covers more than one region, see Settings::padding
+        std::size_t levelCount;
+    };
+
+public:
+    // Decodes and packs on the calling thread and uploads the pages, so it has to run on the render thread
+    static std::shared_ptr<TextureAtlas> build(std::span<const Source> sources);
+    static std::shared_ptr<TextureAtlas> build(std::span<const Source> sources, const Settings& settings);
+    // Packs images in order, regions[i] belongs to images[i]
+    static Pages pack(std::span<const TextureCompression::Image> images, const Settings& settings);
+
+    ~TextureAtlas();
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    std::optional<Region> find(const std::filesystem::path& path) const;
+    // Rewrites the UVs of vertices that were authored against the original texture
+    static void remapUVs(std::span<Gfx::Vertex> vertices, const Region& region);
+
+    Layout getLayout() const;
+    Gfx::TextureIdType getTextureId() const;
+    int32_t getPageSize() const;
+    uint32_t getLayerCount() const;
+
+private:
+    TextureAtlas(Layout layout, Gfx::TextureIdType textureId, int32_t pageSize, uint32_t layerCount, std::unordered_map<std::string, Region> regions);
+
+private:
+    Layout m_layout;
+    Gfx::TextureIdType m_textureId;
+    int32_t m_pageSize;
+    uint32_t m_layerCount;
+    std::unordered_map<std::string, Region> m_regions;
+};
@@ -0,0 +1,1038 @@
+#include "TextureCompression.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TEXTURE_COMPRESSION_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+namespace
+{
+    // One pixel with up to four channels, the filters run all channels at once
+    struct Float4
+    {
+#ifdef TEXTURE_COMPRESSION_SSE2
+        __m128 value;
+
+        static Float4 zero() { return { _mm_setzero_ps() }; }
+        static Float4 splat(float scalar) { return { _mm_set1_ps(scalar) }; }
+        Float4 operator+(Float4 other) const { return { _mm_add_ps(value, other.value) }; }
+        Float4 operator*(Float4 other) const { return { _mm_mul_ps(value, other.value) }; }
+
+        static Float4 load(const float* source) { return { _mm_loadu_ps(source) }; }
+        void store(float* destination) const { _mm_storeu_ps(destination, value); }
+#else
+        std::array<float, 4> value;
+
+        static Float4 zero() { return { { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+        static Float4 splat(float scalar) { return { { scalar, scalar, scalar, scalar } }; }
+        Float4 operator+(Float4 other) const { return { { value[0] + other.value[0], value[1] + other.value[1], value[2] + other.value[2], value[3] + other.value[3] } }; }
+        Float4 operator*(Float4 other) const { return { { value[0] * other.value[0], value[1] * other.value[1], value[2] * other.value[2], value[3] * other.value[3] } }; }
+
+        static Float4 load(const float* source) { return { { source[0], source[1], source[2], source[3] } }; }
+        void store(float* destination) const { std::memcpy(destination, value.data(), sizeof(value)); }
+#endif
+    };
+
+    Float4 loadPixel(const uint8_t* pixel, int32_t channels)
+    {
+        std::array<float, 4> values{};
+        for (int32_t channel = 0; channel < channels; channel++)
+        {
+            values[channel] = pixel[channel];
+        }
+        return Float4::load(values.data());
+    }
+
+    void storePixel(Float4 pixel, uint8_t* destination, int32_t channels)
+    {
+        std::array<float, 4> values{};
+        pixel.store(values.data());
+        for (int32_t channel = 0; channel < channels; channel++)
+        {
+            destination[channel] = static_cast<uint8_t>(std::clamp(values[channel] + 0.5f, 0.0f, 255.0f));
+        }
+    }
+
+    TextureCompression::Image boxDownsample(const TextureCompression::Image& source)
+    {
+        const int32_t width = std::max(1, source.width / 2);
+        const int32_t height = std::max(1, source.height / 2);
+        const int32_t channels = source.channels;
+
+        TextureCompression::Image destination { width, height, channels, std::vector<uint8_t>(static_cast<std::size_t>(width) * height * channels) };
+        const Float4 quarter = Float4::splat(0.25f);
+
+        for (int32_t y = 0; y < height; y++)
+        {
+            const int32_t y0 = std::min(y * 2, source.height - 1);
+            const int32_t y1 = std::min(y * 2 + 1, source.height - 1);
+            const uint8_t* row0 = source.pixels.data() + static_cast<std::size_t>(y0) * source.width * channels;
+            const uint8_t* row1 = source.pixels.data() + static_cast<std::size_t>(y1) * source.width * channels;
+
+            for (int32_t x = 0; x < width; x++)
+            {
+                const int32_t x0 = std::min(x * 2, source.width - 1) * channels;
+                const int32_t x1 = std::min(x * 2 + 1, source.width - 1) * channels;
+
+                const Float4 sum = loadPixel(row0 + x0, channels) + loadPixel(row0 + x1, channels) + loadPixel(row1 + x0, channels) + loadPixel(row1 + x1, channels);
+                storePixel(sum * quarter, destination.pixels.data() + (static_cast<std::size_t>(y) * width + x) * channels, channels);
+            }
+        }
+
+        return destination;
+    }
+
+    // Taps of a 2:1 Kaiser windowed sinc, symmetric around the center of the destination pixel
+    constexpr int32_t KAISER_TAPS = 12;
+    constexpr float KAISER_WIDTH = 3.0f;
+    constexpr float KAISER_ALPHA = 4.0f;
+
+    float besselI0(float x)
+    {
+        float sum = 1.0f;
+        float term = 1.0f;
+        for (int32_t k = 1; k < 16; k++)
+        {
+            term *= (x / (2.0f * k)) * (x / (2.0f * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    const std::array<float, KAISER_TAPS>& kaiserWeights()
+    {
+        static const std::array<float, KAISER_TAPS> weights = [] {
+            std::array<float, KAISER_TAPS> result{};
+            float total = 0.0f;
+            for (int32_t tap = 0; tap < KAISER_TAPS; tap++)
+            {
+                // Distance from the destination pixel center, in destination pixels
+                const float t = (tap - KAISER_TAPS / 2 + 0.5f) * 0.5f;
+                const float sinc = t == 0.0f ? 1.0f : std::sin(3.14159265f * t) / (3.14159265f * t);
+                const float ratio = t / KAISER_WIDTH;
+                const float window = besselI0(KAISER_ALPHA * std::sqrt(std::max(0.0f, 1.0f - ratio * ratio))) / besselI0(KAISER_ALPHA);
+                result[tap] = sinc * window;
+                total += result[tap];
+            }
+            for (float& weight : result)
+            {
+                weight /= total;
+            }
+            return result;
+        }();
+        return weights;
+    }
+
+    // Filters one line of count pixels spaced stride floats apart, writing count / 2 pixels
+    void kaiserLine(const float* source, std::size_t sourceStride, int32_t sourceCount, float* destination, std::size_t destinationStride, int32_t destinationCount)
+    {
+        const std::array<float, KAISER_TAPS>& weights = kaiserWeights();
+        if (sourceCount == destinationCount)
+        {
+            for (int32_t index = 0; index < destinationCount; index++)
+            {
+                Float4::load(source + index * sourceStride).store(destination + index * destinationStride);
+            }
+            return;
+        }
+
+        for (int32_t index = 0; index < destinationCount; index++)
+        {
+            Float4 sum = Float4::zero();
+            const int32_t first = index * 2 - KAISER_TAPS / 2 + 1;
+            for (int32_t tap = 0; tap < KAISER_TAPS; tap++)
+            {
+                const int32_t sample = std::clamp(first + tap, 0, sourceCount - 1);
+                sum = sum + Float4::load(source + sample * sourceStride) * Float4::splat(weights[tap]);
+            }
+            sum.store(destination + index * destinationStride);
+        }
+    }
+
+    TextureCompression::Image kaiserDownsample(const TextureCompression::Image& source)
+    {
+        const int32_t width = std::max(1, source.width / 2);
+        const int32_t height = std::max(1, source.height / 2);
+        const int32_t channels = source.channels;
+
+        std::vector<float> expanded(static_cast<std::size_t>(source.width) * source.height * 4);
+        for (std::size_t pixel = 0; pixel < static_cast<std::size_t>(source.width) * source.height; pixel++)
+        {
+            loadPixel(source.pixels.data() + pixel * channels, channels).store(expanded.data() + pixel * 4);
+        }
+
+        std::vector<float> horizontal(static_cast<std::size_t>(width) * source.height * 4);
+        for (int32_t y = 0; y < source.height; y++)
+        {
+            kaiserLine(expanded.data() + static_cast<std::size_t>(y) * source.width * 4, 4, source.width, horizontal.data() + static_cast<std::size_t>(y) * width * 4, 4, width);
+        }
+
+        std::vector<float> vertical(static_cast<std::size_t>(width) * height * 4);
+        for (int32_t x = 0; x < width; x++)
+        {
+            kaiserLine(horizontal.data() + x * 4, static_cast<std::size_t>(width) * 4, source.height, vertical.data() + x * 4, static_cast<std::size_t>(width) * 4, height);
+        }
+
+        TextureCompression::Image destination { width, height, channels, std::vector<uint8_t>(static_cast<std::size_t>(width) * height * channels) };
+        for (std::size_t pixel = 0; pixel < static_cast<std::size_t>(width) * height; pixel++)
+        {
+            storePixel(Float4::load(vertical.data() + pixel * 4), destination.pixels.data() + pixel * channels, channels);
+        }
+
+        return destination;
+    }
+
+    using Block = std::array<std::array<uint8_t, 4>, 16>;
+
+    // Edge blocks repeat the last row and column
+    Block fetchBlock(const TextureCompression::Image& rgba, int32_t blockX, int32_t blockY)
+    {
+        Block block{};
+        for (int32_t y = 0; y < 4; y++)
+        {
+            const int32_t sourceY = std::min(blockY * 4 + y, rgba.height - 1);
+            for (int32_t x = 0; x < 4; x++)
+            {
+                const int32_t sourceX = std::min(blockX * 4 + x, rgba.width - 1);
+                std::memcpy(block[y * 4 + x].data(), rgba.pixels.data() + (static_cast<std::size_t>(sourceY) * rgba.width + sourceX) * 4, 4);
+            }
+        }
+        return block;
+    }
+
+    void storeBlock(TextureCompression::Image& rgba, int32_t blockX, int32_t blockY, const Block& block)
+    {
+        for (int32_t y = 0; y < 4 && blockY * 4 + y < rgba.height; y++)
+        {
+            for (int32_t x = 0; x < 4 && blockX * 4 + x < rgba.width; x++)
+            {
+                std::memcpy(rgba.pixels.data() + (static_cast<std::size_t>(blockY * 4 + y) * rgba.width + blockX * 4 + x) * 4, block[y * 4 + x].data(), 4);
+            }
+        }
+    }
+
+    int32_t blockCount(int32_t size)
+    {
+        return (size + 3) / 4;
+    }
+
+    // Endpoints at the extremes of the principal axis of the block colors, using the first channelCount channels
+    template<int32_t ChannelCount>
+    void principalEndpoints(const Block& block, std::array<float, ChannelCount>& minimum, std::array<float, ChannelCount>& maximum)
+    {
+        std::array<float, ChannelCount> mean{};
+        for (const std::array<uint8_t, 4>& pixel : block)
+        {
+            for (int32_t channel = 0; channel < ChannelCount; channel++)
+            {
+                mean[channel] += pixel[channel] / 16.0f;
+            }
+        }
+
+        std::array<std::array<float, ChannelCount>, ChannelCount> covariance{};
+        for (const std::array<uint8_t, 4>& pixel : block)
+        {
+            for (int32_t row = 0; row < ChannelCount; row++)
+            {
+                for (int32_t column = 0; column < ChannelCount; column++)
+                {
+                    covariance[row][column] += (pixel[row] - mean[row]) * (pixel[column] - mean[column]);
+                }
+            }
+        }
+
+        // Power iteration seeded with the covariance column of the channel that varies most. A fixed seed such as
+        // (1, 1, 1) is orthogonal to variation like red against green and would collapse the block to its mean.
+        int32_t seed = 0;
+        for (int32_t channel = 1; channel < ChannelCount; channel++)
+        {
+            seed = covariance[channel][channel] > covariance[seed][seed] ? channel : seed;
+        }
+
+        std::array<float, ChannelCount> axis{};
+        for (int32_t channel = 0; channel < ChannelCount; channel++)
+        {
+            axis[channel] = covariance[channel][seed];
+        }
+
+        bool degenerate = covariance[seed][seed] < 1e-6f;
+        for (int32_t iteration = 0; iteration < 8 && !degenerate; iteration++)
+        {
+            std::array<float, ChannelCount> next{};
+            float length = 0.0f;
+            for (int32_t row = 0; row < ChannelCount; row++)
+            {
+                for (int32_t column = 0; column < ChannelCount; column++)
+                {
+                    next[row] += covariance[row][column] * axis[column];
+                }
+                length = std::max(length, std::abs(next[row]));
+            }
+            if (length < 1e-6f)
+            {
+                degenerate = true;
+                break;
+            }
+            for (int32_t channel = 0; channel < ChannelCount; channel++)
+            {
+                axis[channel] = next[channel] / length;
+            }
+        }
+
+        // Otherwise the diagonal of the bounding box of the block colors, zero only for a solid block
+        if (degenerate)
+        {
+            for (int32_t channel = 0; channel < ChannelCount; channel++)
+            {
+                uint8_t lowestValue = 255;
+                uint8_t highestValue = 0;
+                for (const std::array<uint8_t, 4>& pixel : block)
+                {
+                    lowestValue = std::min(lowestValue, pixel[channel]);
+                    highestValue = std::max(highestValue, pixel[channel]);
+                }
+                axis[channel] = static_cast<float>(highestValue - lowestValue);
+            }
+        }
+
+        float lowest = std::numeric_limits<float>::max();
+        float highest = std::numeric_limits<float>::lowest();
+        for (const std::array<uint8_t, 4>& pixel : block)
+        {
+            float projection = 0.0f;
+            for (int32_t channel = 0; channel < ChannelCount; channel++)
+            {
+                projection += (pixel[channel] - mean[channel]) * axis[channel];
+            }
+            lowest = std::min(lowest, projection);
+            highest = std::max(highest, projection);
+        }
+
+        float axisLengthSquared = 0.0f;
+        for (int32_t channel = 0; channel < ChannelCount; channel++)
+        {
+            axisLengthSquared += axis[channel] * axis[channel];
+        }
+        axisLengthSquared = std::max(axisLengthSquared, 1e-6f);
+
+        for (int32_t channel = 0; channel < ChannelCount; channel++)
+        {
+            minimum[channel] = std::clamp(mean[channel] + axis[channel] * lowest / axisLengthSquared, 0.0f, 255.0f);
+            maximum[channel] = std::clamp(mean[channel] + axis[channel] * highest / axisLengthSquared, 0.0f, 255.0f);
+        }
+    }
+
+    // Distinct colors of the block over the first channelCount channels, counting stops at three
+    int32_t countColors(const Block& block, int32_t channelCount)
+    {
+        std::array<const std::array<uint8_t, 4>*, 3> colors{};
+        int32_t count = 0;
+        for (const std::array<uint8_t, 4>& pixel : block)
+        {
+            const bool known = std::any_of(colors.begin(), colors.begin() + count, [&pixel, channelCount](const std::array<uint8_t, 4>* color)
+            {
+                return std::equal(pixel.begin(), pixel.begin() + channelCount, color->begin());
+            });
+            if (!known)
+            {
+                colors[count++] = &pixel;
+                if (count == static_cast<int32_t>(colors.size()))
+                {
+                    break;
+                }
+            }
+        }
+        return count;
+    }
+
+    int32_t squaredDistance(const std::array<uint8_t, 4>& lhs, const std::array<int32_t, 4>& rhs, int32_t channelCount)
+    {
+        int32_t distance = 0;
+        for (int32_t channel = 0; channel < channelCount; channel++)
+        {
+            const int32_t difference = lhs[channel] - rhs[channel];
+            distance += difference * difference;
+        }
+        return distance;
+    }
+
+    uint16_t packRgb565(const std::array<float, 3>& color)
+    {
+        const uint32_t red = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+        const uint32_t green = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+        const uint32_t blue = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>((red << 11) | (green << 5) | blue);
+    }
+
+    std::array<int32_t, 4> unpackRgb565(uint16_t color)
+    {
+        const int32_t red = (color >> 11) & 0x1f;
+        const int32_t green = (color >> 5) & 0x3f;
+        const int32_t blue = color & 0x1f;
+        return { (red << 3) | (red >> 2), (green << 2) | (green >> 4), (blue << 3) | (blue >> 2), 255 };
+    }
+
+    std::array<std::array<int32_t, 4>, 4> colorPalette(uint16_t color0, uint16_t color1, bool fourColor)
+    {
+        std::array<std::array<int32_t, 4>, 4> palette { unpackRgb565(color0), unpackRgb565(color1) };
+        for (int32_t channel = 0; channel < 3; channel++)
+        {
+            if (fourColor)
+            {
+                palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+                palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+            }
+            else
+            {
+                palette[2][channel] = (palette[0][channel] + palette[1][channel]) / 2;
+                palette[3][channel] = 0;
+            }
+        }
+        palette[2][3] = 255;
+        palette[3][3] = fourColor ? 255 : 0;
+        return palette;
+    }
+
+    // Always four color mode, BC3 decodes its color block that way regardless of the endpoint order
+    void encodeColorBlock(const Block& block, uint8_t* output)
+    {
+        std::array<float, 3> minimum{};
+        std::array<float, 3> maximum{};
+        principalEndpoints<3>(block, minimum, maximum);
+
+        // Pull the endpoints in slightly, the extremes are usually outliers.
+        // Not with two colors or fewer, the endpoints are exactly those colors then and the block stays lossless
+        if (countColors(block, 3) > 2)
+        {
+            for (int32_t channel = 0; channel < 3; channel++)
+            {
+                const float inset = (maximum[channel] - minimum[channel]) / 16.0f;
+                minimum[channel] += inset;
+                maximum[channel] -= inset;
+            }
+        }
+
+        uint16_t color0 = packRgb565(maximum);
+        uint16_t color1 = packRgb565(minimum);
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+        }
+
+        uint32_t indices = 0;
+        if (color0 != color1)
+        {
+            const std::array<std::array<int32_t, 4>, 4> palette = colorPalette(color0, color1, true);
+            for (int32_t pixel = 0; pixel < 16; pixel++)
+            {
+                uint32_t bestIndex = 0;
+                int32_t bestDistance = std::numeric_limits<int32_t>::max();
+                for (uint32_t index = 0; index < 4; index++)
+                {
+                    if (const int32_t distance = squaredDistance(block[pixel], palette[index], 3); distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        bestIndex = index;
+                    }
+                }
+                indices |= bestIndex << (pixel * 2);
+            }
+        }
+
+        std::memcpy(output, &color0, sizeof(color0));
+        std::memcpy(output + 2, &color1, sizeof(color1));
+        std::memcpy(output + 4, &indices, sizeof(indices));
+    }
+
+    void decodeColorBlock(const uint8_t* input, Block& block, bool forceFourColor)
+    {
+        uint16_t color0{};
+        uint16_t color1{};
+        uint32_t indices{};
+        std::memcpy(&color0, input, sizeof(color0));
+        std::memcpy(&color1, input + 2, sizeof(color1));
+        std::memcpy(&indices, input + 4, sizeof(indices));
+
+        const std::array<std::array<int32_t, 4>, 4> palette = colorPalette(color0, color1, forceFourColor || color0 > color1);
+        for (int32_t pixel = 0; pixel < 16; pixel++)
+        {
+            const std::array<int32_t, 4>& color = palette[(indices >> (pixel * 2)) & 0x3];
+            block[pixel] = { static_cast<uint8_t>(color[0]), static_cast<uint8_t>(color[1]), static_cast<uint8_t>(color[2]), static_cast<uint8_t>(color[3]) };
+        }
+    }
+
+    std::array<int32_t, 8> alphaPalette(int32_t alpha0, int32_t alpha1)
+    {
+        std::array<int32_t, 8> palette { alpha0, alpha1 };
+        if (alpha0 > alpha1)
+        {
+            for (int32_t index = 2; index < 8; index++)
+            {
+                palette[index] = ((8 - index) * alpha0 + (index - 1) * alpha1) / 7;
+            }
+        }
+        else
+        {
+            for (int32_t index = 2; index < 6; index++)
+            {
+                palette[index] = ((6 - index) * alpha0 + (index - 1) * alpha1) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        return palette;
+    }
+
+    void encodeAlphaBlock(const Block& block, uint8_t* output)
+    {
+        int32_t alpha0 = 0;
+        int32_t alpha1 = 255;
+        for (const std::array<uint8_t, 4>& pixel : block)
+        {
+            alpha0 = std::max<int32_t>(alpha0, pixel[3]);
+            alpha1 = std::min<int32_t>(alpha1, pixel[3]);
+        }
+
+        uint64_t indices = 0;
+        if (alpha0 != alpha1)
+        {
+            const std::array<int32_t, 8> palette = alphaPalette(alpha0, alpha1);
+            for (int32_t pixel = 0; pixel < 16; pixel++)
+            {
+                uint64_t bestIndex = 0;
+                int32_t bestDistance = std::numeric_limits<int32_t>::max();
+                for (uint64_t index = 0; index < 8; index++)
+                {
+                    if (const int32_t distance = std::abs(block[pixel][3] - palette[index]); distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        bestIndex = index;
+                    }
+                }
+                indices |= bestIndex << (pixel * 3);
+            }
+        }
+
+        output[0] = static_cast<uint8_t>(alpha0);
+        output[1] = static_cast<uint8_t>(alpha1);
+        for (int32_t byte = 0; byte < 6; byte++)
+        {
+            output[2 + byte] = static_cast<uint8_t>(indices >> (byte * 8));
+        }
+    }
+
+    void decodeAlphaBlock(const uint8_t* input, Block& block)
+    {
+        uint64_t indices = 0;
+        for (int32_t byte = 0; byte < 6; byte++)
+        {
+            indices |= static_cast<uint64_t>(input[2 + byte]) << (byte * 8);
+        }
+
+        const std::array<int32_t, 8> palette = alphaPalette(input[0], input[1]);
+        for (int32_t pixel = 0; pixel < 16; pixel++)
+        {
+            block[pixel][3] = static_cast<uint8_t>(palette[(indices >> (pixel * 3)) & 0x7]);
+        }
+    }
+
+    constexpr std::array<int32_t, 16> BC7_WEIGHTS4 { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // Little endian bit stream over one 128 bit block
+    class BlockBits
+    {
+    public:
+        explicit BlockBits(uint8_t* data) : m_data(data)
+        {
+        }
+
+        void write(uint32_t value, int32_t bitCount)
+        {
+            for (int32_t bit = 0; bit < bitCount; bit++, m_position++)
+            {
+                if ((value >> bit) & 1u)
+                {
+                    m_data[m_position / 8] |= static_cast<uint8_t>(1u << (m_position % 8));
+                }
+            }
+        }
+
+        uint32_t read(int32_t bitCount)
+        {
+            uint32_t value = 0;
+            for (int32_t bit = 0; bit < bitCount; bit++, m_position++)
+            {
+                value |= static_cast<uint32_t>((m_data[m_position / 8] >> (m_position % 8)) & 1u) << bit;
+            }
+            return value;
+        }
+
+    private:
+        uint8_t* m_data;
+        int32_t m_position { 0 };
+    };
+
+    struct Mode6Endpoints
+    {
+        std::array<std::array<int32_t, 4>, 2> quantized;
+        std::array<int32_t, 2> pBits;
+    };
+
+    // Endpoint channels are 7 bits plus a p-bit shared by the four channels, pick the p-bit with the smaller error
+    void quantizeMode6Endpoint(const std::array<float, 4>& endpoint, std::array<int32_t, 4>& quantized, int32_t& pBit)
+    {
+        float bestError = std::numeric_limits<float>::max();
+        for (int32_t candidate = 0; candidate < 2; candidate++)
+        {
+            std::array<int32_t, 4> values{};
+            float error = 0.0f;
+            for (int32_t channel = 0; channel < 4; channel++)
+            {
+                values[channel] = std::clamp(static_cast<int32_t>(std::lround((endpoint[channel] - candidate) / 2.0f)), 0, 127);
+                const float difference = static_cast<float>((values[channel] << 1) | candidate) - endpoint[channel];
+                error += difference * difference;
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                quantized = values;
+                pBit = candidate;
+            }
+        }
+    }
+
+    std::array<std::array<int32_t, 4>, 16> mode6Palette(const Mode6Endpoints& endpoints)
+    {
+        std::array<std::array<int32_t, 4>, 16> palette{};
+        for (int32_t channel = 0; channel < 4; channel++)
+        {
+            const int32_t low = (endpoints.quantized[0][channel] << 1) | endpoints.pBits[0];
+            const int32_t high = (endpoints.quantized[1][channel] << 1) | endpoints.pBits[1];
+            for (int32_t index = 0; index < 16; index++)
+            {
+                palette[index][channel] = ((64 - BC7_WEIGHTS4[index]) * low + BC7_WEIGHTS4[index] * high + 32) >> 6;
+            }
+        }
+        return palette;
+    }
+
+    int32_t mode6Indices(const Block& block, const Mode6Endpoints& endpoints, std::array<int32_t, 16>& indices)
+    {
+        const std::array<std::array<int32_t, 4>, 16> palette = mode6Palette(endpoints);
+        int32_t totalError = 0;
+        for (int32_t pixel = 0; pixel < 16; pixel++)
+        {
+            int32_t bestDistance = std::numeric_limits<int32_t>::max();
+            for (int32_t index = 0; index < 16; index++)
+            {
+                if (const int32_t distance = squaredDistance(block[pixel], palette[index], 4); distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    indices[pixel] = index;
+                }
+            }
+            totalError += bestDistance;
+        }
+        return totalError;
+    }
+
+    Mode6Endpoints quantizeMode6(const std::array<float, 4>& low, const std::array<float, 4>& high)
+    {
+        Mode6Endpoints endpoints{};
+        quantizeMode6Endpoint(low, endpoints.quantized[0], endpoints.pBits[0]);
+        quantizeMode6Endpoint(high, endpoints.quantized[1], endpoints.pBits[1]);
+        return endpoints;
+    }
+
+    void encodeMode6Block(const Block& block, uint8_t* output)
+    {
+        std::array<float, 4> low{};
+        std::array<float, 4> high{};
+        principalEndpoints<4>(block, low, high);
+
+        Mode6Endpoints endpoints = quantizeMode6(low, high);
+        std::array<int32_t, 16> indices{};
+        int32_t error = mode6Indices(block, endpoints, indices);
+
+        // One least squares pass fitting the endpoints to the chosen weights
+        float sumWW = 0.0f;
+        float sumW = 0.0f;
+        std::array<float, 4> sumX{};
+        std::array<float, 4> sumWX{};
+        for (int32_t pixel = 0; pixel < 16; pixel++)
+        {
+            const float weight = BC7_WEIGHTS4[indices[pixel]] / 64.0f;
+            sumWW += weight * weight;
+            sumW += weight;
+            for (int32_t channel = 0; channel < 4; channel++)
+            {
+                sumX[channel] += block[pixel][channel];
+                sumWX[channel] += weight * block[pixel][channel];
+            }
+        }
+
+        // Normal equations of sum(((1 - w) * low + w * high - x)^2)
+        const float a = 16.0f - 2.0f * sumW + sumWW;
+        const float b = sumW - sumWW;
+        const float c = sumWW;
+        const float determinant = a * c - b * b;
+        if (std::abs(determinant) > 1e-6f)
+        {
+            std::array<float, 4> fittedLow{};
+            std::array<float, 4> fittedHigh{};
+            for (int32_t channel = 0; channel < 4; channel++)
+            {
+                const float lowRhs = sumX[channel] - sumWX[channel];
+                const float highRhs = sumWX[channel];
+                fittedLow[channel] = std::clamp((c * lowRhs - b * highRhs) / determinant, 0.0f, 255.0f);
+                fittedHigh[channel] = std::clamp((a * highRhs - b * lowRhs) / determinant, 0.0f, 255.0f);
+            }
+
+            const Mode6Endpoints fitted = quantizeMode6(fittedLow, fittedHigh);
+            std::array<int32_t, 16> fittedIndices{};
+            if (const int32_t fittedError = mode6Indices(block, fitted, fittedIndices); fittedError < error)
+            {
+                endpoints = fitted;
+                indices = fittedIndices;
+                error = fittedError;
+            }
+        }
+
+        // The anchor index drops its top bit, so it has to be below 8
+        if (indices[0] >= 8)
+        {
+            std::swap(endpoints.quantized[0], endpoints.quantized[1]);
+            std::swap(endpoints.pBits[0], endpoints.pBits[1]);
+            for (int32_t& index : indices)
+            {
+                index = 15 - index;
+            }
+        }
+
+        std::memset(output, 0, 16);
+        BlockBits bits(output);
+        bits.write(1u << 6, 7);
+        for (int32_t channel = 0; channel < 4; channel++)
+        {
+            bits.write(static_cast<uint32_t>(endpoints.quantized[0][channel]), 7);
+            bits.write(static_cast<uint32_t>(endpoints.quantized[1][channel]), 7);
+        }
+        bits.write(static_cast<uint32_t>(endpoints.pBits[0]), 1);
+        bits.write(static_cast<uint32_t>(endpoints.pBits[1]), 1);
+        for (int32_t pixel = 0; pixel < 16; pixel++)
+        {
+            bits.write(static_cast<uint32_t>(indices[pixel]), pixel == 0 ? 3 : 4);
+        }
+    }
+
+    void decodeMode6Block(const uint8_t* input, Block& block)
+    {
+        std::array<uint8_t, 16> data{};
+        std::memcpy(data.data(), input, data.size());
+
+        if (data[0] == 0)
+        {
+            // Reserved mode, decodes to transparent black
+            block = {};
+            return;
+        }
+
+        const int32_t mode = std::countr_zero(static_cast<uint32_t>(data[0]));
+        KORELIB_VERIFY_THROW(mode == 6, korelib::RuntimeException, fmt::format("BC7 mode {} blocks are not supported", mode));
+
+        BlockBits bits(data.data());
+        bits.read(7);
+
+        Mode6Endpoints endpoints{};
+        for (int32_t channel = 0; channel < 4; channel++)
+        {
+            endpoints.quantized[0][channel] = static_cast<int32_t>(bits.read(7));
+            endpoints.quantized[1][channel] = static_cast<int32_t>(bits.read(7));
+        }
+        endpoints.pBits[0] = static_cast<int32_t>(bits.read(1));
+        endpoints.pBits[1] = static_cast<int32_t>(bits.read(1));
+
+        const std::array<std::array<int32_t, 4>, 16> palette = mode6Palette(endpoints);
+        for (int32_t pixel = 0; pixel < 16; pixel++)
+        {
+            const std::array<int32_t, 4>& color = palette[bits.read(pixel == 0 ? 3 : 4)];
+            block[pixel] = { static_cast<uint8_t>(color[0]), static_cast<uint8_t>(color[1]), static_cast<uint8_t>(color[2]), static_cast<uint8_t>(color[3]) };
+        }
+    }
+
+    template<typename EncodeBlock>
+    std::vector<uint8_t> encodeBlocks(const TextureCompression::Image& image, uint32_t blockSize, EncodeBlock&& encodeBlock)
+    {
+        const TextureCompression::Image rgba = TextureCompression::toRgba(image);
+        const int32_t blocksWide = blockCount(rgba.width);
+        const int32_t blocksHigh = blockCount(rgba.height);
+
+        std::vector<uint8_t> blocks(static_cast<std::size_t>(blocksWide) * blocksHigh * blockSize);
+        for (int32_t blockY = 0; blockY < blocksHigh; blockY++)
+        {
+            for (int32_t blockX = 0; blockX < blocksWide; blockX++)
+            {
+                encodeBlock(fetchBlock(rgba, blockX, blockY), blocks.data() + (static_cast<std::size_t>(blockY) * blocksWide + blockX) * blockSize);
+            }
+        }
+        return blocks;
+    }
+
+    template<typename DecodeBlock>
+    TextureCompression::Image decodeBlocks(std::span<const uint8_t> blocks, int32_t width, int32_t height, uint32_t blockSize, DecodeBlock&& decodeBlock)
+    {
+        const int32_t blocksWide = blockCount(width);
+        const int32_t blocksHigh = blockCount(height);
+        KORELIB_VERIFY_THROW(blocks.size() >= static_cast<std::size_t>(blocksWide) * blocksHigh * blockSize, korelib::RuntimeException, "Compressed level is truncated");
+
+        TextureCompression::Image rgba { width, height, 4, std::vector<uint8_t>(static_cast<std::size_t>(width) * height * 4) };
+        for (int32_t blockY = 0; blockY < blocksHigh; blockY++)
+        {
+            for (int32_t blockX = 0; blockX < blocksWide; blockX++)
+            {
+                Block block{};
+                decodeBlock(blocks.data() + (static_cast<std::size_t>(blockY) * blocksWide + blockX) * blockSize, block);
+                storeBlock(rgba, blockX, blockY, block);
+            }
+        }
+        return rgba;
+    }
+}
+
+bool TextureCompression::isCompressed(Format format)
+{
+    return format == Format::BC1 || format == Format::BC3 || format == Format::BC7;
+}
+
+TextureCompression::Format TextureCompression::uncompressedFormat(int32_t channels)
+{
+    switch (channels)
+    {
+        case 1:
+            return Format::R8;
+        case 2:
+            return Format::RG8;
+        case 3:
+            return Format::RGB8;
+        case 4:
+            return Format::RGBA8;
+        default:
+            KORELIB_VERIFY_THROW(false, korelib::RuntimeException, fmt::format("Unsupported channel count {}", channels));
+    }
+    return Format::RGBA8;
+}
+
+uint64_t TextureCompression::levelSize(Format format, int32_t width, int32_t height)
+{
+    const uint64_t blocks = static_cast<uint64_t>(blockCount(width)) * blockCount(height);
+    switch (format)
+    {
+        case Format::R8:
+            return static_cast<uint64_t>(width) * height;
+        case Format::RG8:
+            return static_cast<uint64_t>(width) * height * 2;
+        case Format::RGB8:
+            return static_cast<uint64_t>(width) * height * 3;
+        case Format::RGBA8:
+            return static_cast<uint64_t>(width) * height * 4;
+        case Format::BC1:
+            return blocks * 8;
+        case Format::BC3:
+        case Format::BC7:
+            return blocks * 16;
+    }
+    return 0;
+}
+
+std::vector<TextureCompression::Image> TextureCompression::generateMipChain(const Image& image, MipFilter filter)
+{
+    std::vector<Image> levels { image };
+    while (levels.back().width > 1 || levels.back().height > 1)
+    {
+        levels.emplace_back(downsample(levels.back(), filter));
+    }
+    return levels;
+}
+
+TextureCompression::Image TextureCompression::downsample(const Image& image, MipFilter filter)
+{
+    KORELIB_VERIFY_THROW(image.channels >= 1 && image.channels <= 4, korelib::RuntimeException, fmt::format("Unsupported channel count {}", image.channels));
+    return filter == MipFilter::KAISER ? kaiserDownsample(image) : boxDownsample(image);
+}
+
+TextureCompression::Image TextureCompression::toRgba(const Image& image)
+{
+    if (image.channels == 4)
+    {
+        return image;
+    }
+
+    Image rgba { image.width, image.height, 4, std::vector<uint8_t>(static_cast<std::size_t>(image.width) * image.height * 4) };
+    for (std::size_t pixel = 0; pixel < static_cast<std::size_t>(image.width) * image.height; pixel++)
+    {
+        const uint8_t* source = image.pixels.data() + pixel * image.channels;
+        uint8_t* destination = rgba.pixels.data() + pixel * 4;
+        switch (image.channels)
+        {
+            case 1:
+                destination[0] = destination[1] = destination[2] = source[0];
+                destination[3] = 255;
+                break;
+            case 2:
+                destination[0] = destination[1] = destination[2] = source[0];
+                destination[3] = source[1];
+                break;
+            default:
+                destination[0] = source[0];
+                destination[1] = source[1];
+                destination[2] = source[2];
+                destination[3] = 255;
+                break;
+        }
+    }
+    return rgba;
+}
+
+std::vector<uint8_t> TextureCompression::encodeBC1(const Image& image)
+{
+    return encodeBlocks(image, 8, [](const Block& block, uint8_t* output) { encodeColorBlock(block, output); });
+}
+
+std::vector<uint8_t> TextureCompression::encodeBC3(const Image& image)
+{
+    return encodeBlocks(image, 16, [](const Block& block, uint8_t* output) {
+        encodeAlphaBlock(block, output);
+        encodeColorBlock(block, output + 8);
+    });
+}
+
+std::vector<uint8_t> TextureCompression::encodeBC7(const Image& image)
+{
+    return encodeBlocks(image, 16, [](const Block& block, uint8_t* output) { encodeMode6Block(block, output); });
+}
+
+TextureCompression::Image TextureCompression::decodeBC1(std::span<const uint8_t> blocks, int32_t width, int32_t height)
+{
+    return decodeBlocks(blocks, width, height, 8, [](const uint8_t* input, Block& block) { decodeColorBlock(input, block, false); });
+}
+
+TextureCompression::Image TextureCompression::decodeBC3(std::span<const uint8_t> blocks, int32_t width, int32_t height)
+{
+    return decodeBlocks(blocks, width, height, 16, [](const uint8_t* input, Block& block) {
+        decodeColorBlock(input + 8, block, true);
+        decodeAlphaBlock(input, block);
+    });
+}
+
+TextureCompression::Image TextureCompression::decodeBC7(std::span<const uint8_t> blocks, int32_t width, int32_t height)
+{
+    return decodeBlocks(blocks, width, height, 16, [](const uint8_t* input, Block& block) { decodeMode6Block(input, block); });
+}
+
+TextureCompression::EncodedTexture TextureCompression::encode(const Image& image, Format format, MipFilter filter)
+{
+    EncodedTexture encoded { .format = format, .channels = image.channels, .levels = {} };
+
+    // Block formats are encoded from RGBA, filtering the expanded image keeps all mips in one layout
+    const Image source = isCompressed(format) ? toRgba(image) : image;
+    KORELIB_VERIFY_THROW(isCompressed(format) || format == uncompressedFormat(image.channels), korelib::RuntimeException, "Uncompressed format must match the image channels");
+
+    for (Image& level : generateMipChain(source, filter))
+    {
+        switch (format)
+        {
+            case Format::BC1:
+                level.pixels = encodeBC1(level);
+                break;
+            case Format::BC3:
+                level.pixels = encodeBC3(level);
+                break;
+            case Format::BC7:
+                level.pixels = encodeBC7(level);
+                break;
+            default:
+                break;
+        }
+        encoded.levels.emplace_back(std::move(level));
+    }
+
+    return encoded;
+}
+
+std::vector<std::byte> TextureCompression::serialize(const EncodedTexture& texture)
+{
+    KORELIB_VERIFY_THROW(!texture.levels.empty(), korelib::RuntimeException, "Texture has no levels");
+
+    const CacheHeader header {
+        .magic = CACHE_MAGIC,
+        .version = CACHE_VERSION,
+        .format = static_cast<uint8_t>(texture.format),
+        .channels = static_cast<uint8_t>(texture.channels),
+        .levelCount = static_cast<uint16_t>(texture.levels.size()),
+        .width = static_cast<uint32_t>(texture.levels.front().width),
+        .height = static_cast<uint32_t>(texture.levels.front().height),
+        .reserved = 0
+    };
+
+    std::vector<CacheLevel> table{};
+    uint64_t offset = sizeof(CacheHeader) + texture.levels.size() * sizeof(CacheLevel);
+    for (const Image& level : texture.levels)
+    {
+        offset = (offset + CACHE_LEVEL_ALIGNMENT - 1) / CACHE_LEVEL_ALIGNMENT * CACHE_LEVEL_ALIGNMENT;
+        KORELIB_VERIFY_THROW(level.pixels.size() == levelSize(texture.format, level.width, level.height), korelib::RuntimeException, "Level size does not match its format");
+
+        table.emplace_back(CacheLevel{ .offset = offset, .size = level.pixels.size(), .width = static_cast<uint32_t>(level.width), .height = static_cast<uint32_t>(level.height) });
+        offset += level.pixels.size();
+    }
+
+    std::vector<std::byte> bytes(offset);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + sizeof(header), table.data(), table.size() * sizeof(CacheLevel));
+    for (std::size_t levelIndex = 0; levelIndex < table.size(); levelIndex++)
+    {
+        std::memcpy(bytes.data() + table[levelIndex].offset, texture.levels[levelIndex].pixels.data(), table[levelIndex].size);
+    }
+
+    return bytes;
+}
+
+bool TextureCompression::isCache(std::span<const std::byte> bytes)
+{
+    return bytes.size() >= sizeof(CacheHeader) && std::memcmp(bytes.data(), CACHE_MAGIC.data(), CACHE_MAGIC.size()) == 0;
+}
+
+TextureCompression::TextureView TextureCompression::parse(std::span<const std::byte> bytes)
+{
+    KORELIB_VERIFY_THROW(isCache(bytes), korelib::RuntimeException, "Not a texture cache");
+
+    CacheHeader header{};
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    KORELIB_VERIFY_THROW(header.version == CACHE_VERSION, korelib::RuntimeException, fmt::format("Unsupported texture cache version {}", header.version));
+    KORELIB_VERIFY_THROW(header.format <= static_cast<uint8_t>(Format::BC7) && header.levelCount > 0, korelib::RuntimeException, "Corrupt texture cache header");
+    KORELIB_VERIFY_THROW(sizeof(CacheHeader) + static_cast<uint64_t>(header.levelCount) * sizeof(CacheLevel) <= bytes.size(), korelib::RuntimeException, "Texture cache is truncated");
+
+    TextureView view { .format = static_cast<Format>(header.format), .channels = header.channels, .levels = {} };
+    view.levels.reserve(header.levelCount);
+    for (uint32_t levelIndex = 0; levelIndex < header.levelCount; levelIndex++)
+    {
+        CacheLevel level{};
+        std::memcpy(&level, bytes.data() + sizeof(CacheHeader) + levelIndex * sizeof(CacheLevel), sizeof(level));
+        KORELIB_VERIFY_THROW(level.offset <= bytes.size() && level.size <= bytes.size() - level.offset && level.size == levelSize(view.format, level.width, level.height),
+            korelib::RuntimeException, "Texture cache level out of bounds");
+
+        view.levels.emplace_back(Level{
+            .width = static_cast<int32_t>(level.width),
+            .height = static_cast<int32_t>(level.height),
+            .data = { reinterpret_cast<const uint8_t*>(bytes.data() + level.offset), static_cast<std::size_t>(level.size) }
+        });
+    }
+
+    return view;
+}
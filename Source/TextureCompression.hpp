@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Korelib.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// CPU side of the texture pipeline: mip chain generation, block compression and the texture cache format.
+// Nothing in here touches the GPU, so the packer and tests can use it without a context.
+class TextureCompression final : public korelib::StaticOnlyClass
+{
+public:
+    enum class Format : uint8_t
+    {
+        R8,
+        RG8,
+        RGB8,
+        RGBA8,
+        // 8 bytes per 4x4 block, opaque RGB
+        BC1,
+        // 16 bytes per 4x4 block, BC1 colors plus interpolated alpha
+        BC3,
+        // 16 bytes per 4x4 block, only mode 6 (single subset RGBA, 4 bit indices) is produced and decoded
+        BC7
+    };
+
+    enum class MipFilter : uint8_t
+    {
+        // 2x2 average, cheap enough to run while loading
+        BOX,
+        // Kaiser windowed sinc over 12 taps, sharper distant mips for offline packing
+        KAISER
+    };
+
+    // Tightly packed 8 bit pixels, rows of width * channels bytes
+    struct Image
+    {
+        int32_t width;
+        int32_t height;
+        int32_t channels;
+        std::vector<uint8_t> pixels;
+    };
+
+    struct Level
+    {
+        int32_t width;
+        int32_t height;
+        std::span<const uint8_t> data;
+    };
+
+    // Encoded mip chain that owns its bytes, level 0 first
+    struct EncodedTexture
+    {
+        Format format;
+        int32_t channels;
+        std::vector<Image> levels;
+    };
+
+    // Mip chain pointing into bytes owned by someone else, e.g. a mapped archive entry
+    struct TextureView
+    {
+        Format format;
+        int32_t channels;
+        std::vector<Level> levels;
+    };
+
+    static constexpr std::array<char, 8> CACHE_MAGIC { 'L', 'O', 'G', 'L', 'T', 'E', 'X', '\0' };
+    static constexpr uint32_t CACHE_VERSION = 1;
+    static constexpr uint64_t CACHE_LEVEL_ALIGNMENT = 16;
+
+public:
+    static bool isCompressed(Format format);
+    static Format uncompressedFormat(int32_t channels);
+    static uint64_t levelSize(Format format, int32_t width, int32_t height);
+
+    // Level 0 is a copy of image, each following level halves both sides until 1x1
+    static std::vector<Image> generateMipChain(const Image& image, MipFilter filter);
+    static Image downsample(const Image& image, MipFilter filter);
+    static Image toRgba(const Image& image);
+
+    static std::vector<uint8_t> encodeBC1(const Image& image);
+    static std::vector<uint8_t> encodeBC3(const Image& image);
+    static std::vector<uint8_t> encodeBC7(const Image& image);
+    // Reference decoders returning RGBA, used to check the encoders on the CPU
+    static Image decodeBC1(std::span<const uint8_t> blocks, int32_t width, int32_t height);
+    static Image decodeBC3(std::span<const uint8_t> blocks, int32_t width, int32_t height);
+    static Image decodeBC7(std::span<const uint8_t> blocks, int32_t width, int32_t height);
+
+    // Builds the mip chain and compresses every level when format is a block format
+    static EncodedTexture encode(const Image& image, Format format, MipFilter filter);
+
+    // Texture cache file: header, level table, then every level aligned to CACHE_LEVEL_ALIGNMENT.
+    // Levels are stored exactly as glTexImage2D/glCompressedTexImage2D consume them.
+    static std::vector<std::byte> serialize(const EncodedTexture& texture);
+    static bool isCache(std::span<const std::byte> bytes);
+    // The returned levels point into bytes
+    static TextureView parse(std::span<const std::byte> bytes);
+
+private:
+    struct CacheHeader
+    {
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint8_t format;
+        uint8_t channels;
+        uint16_t levelCount;
+        uint32_t width;
+        uint32_t height;
+        uint64_t reserved;
+    };
+
+    struct CacheLevel
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    static_assert(sizeof(CacheHeader) == 32 && sizeof(CacheLevel) == 24);
+};
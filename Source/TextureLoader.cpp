@@ -0,0 +1,192 @@
+#include "TextureLoader.hpp"
+#include "Profiler.hpp"
+
+#include <array>
+
+void TextureLoader::initialize(uint32_t decoderCount, std::size_t decodedCapacity)
+{
+    KORELIB_VERIFY_THROW(g_decoders.empty(), korelib::RuntimeException, "TextureLoader is already initialized");
+    KORELIB_VERIFY_THROW(decoderCount > 0 && decodedCapacity > 0, korelib::RuntimeException, "TextureLoader needs at least one decoder and one decoded slot");
+
+    // 4x4 magenta and black checkerboard
+    std::array<uint8_t, 4 * 4 * 3> checkerboard{};
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            const uint8_t value = ((x + y) % 2 == 0) ? 255 : 0;
+            uint8_t* pixel = checkerboard.data() + (y * 4 + x) * 3;
+            pixel[0] = value;
+            pixel[1] = 0;
+            pixel[2] = value;
+        }
+    }
+    const TextureCompression::Level level { .width = 4, .height = 4, .data = checkerboard };
+    g_placeholderTexture = Gfx::textureFromData(TextureCompression::Format::RGB8, { &level, 1 });
+
+    g_decodedCapacity = decodedCapacity;
+    g_running = true;
+    g_decoders.reserve(decoderCount);
+    for (uint32_t decoderIndex = 0; decoderIndex < decoderCount; decoderIndex++)
+    {
+        g_decoders.emplace_back(decoderMain);
+    }
+}
+
+void TextureLoader::destroy()
+{
+    {
+        std::lock_guard lock(g_mutex);
+        g_running = false;
+    }
+    g_requestAvailable.notify_all();
+    g_decodedSpaceAvailable.notify_all();
+
+    for (std::thread& decoder : g_decoders)
+    {
+        decoder.join();
+    }
+    g_decoders.clear();
+
+    {
+        std::lock_guard lock(g_mutex);
+        g_requests.clear();
+        g_decoded.clear();
+        g_pending = 0;
+    }
+
+    // Textures still pointing at the placeholder never owned it
+    Gfx::destroyTextureObject(g_placeholderTexture);
+    g_placeholderTexture = 0;
+}
+
+void TextureLoader::request(const std::shared_ptr<Texture>& texture)
+{
+    KORELIB_VERIFY_THROW(texture != nullptr, korelib::RuntimeException, "texture is null");
+    KORELIB_VERIFY_THROW(!g_decoders.empty(), korelib::RuntimeException, "TextureLoader is not initialized");
+
+    Texture::State expected = Texture::State::UNLOADED;
+    if (!texture->m_state.compare_exchange_strong(expected, Texture::State::LOADING, std::memory_order_acq_rel))
+    {
+        return;
+    }
+
+    texture->m_textureId.store(g_placeholderTexture, std::memory_order_release);
+    {
+        std::lock_guard lock(g_mutex);
+        g_requests.emplace_back(texture);
+        g_pending++;
+    }
+    g_requestAvailable.notify_one();
+}
+
+void TextureLoader::processUploads()
+{
+    PROFILE_ZONE("TextureLoader::processUploads");
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline = Clock::now() + g_uploadBudget;
+
+    bool uploadedAny = false;
+    while (!uploadedAny || Clock::now() < deadline)
+    {
+        Decoded decoded{};
+        {
+            std::lock_guard lock(g_mutex);
+            if (g_decoded.empty())
+            {
+                return;
+            }
+
+            decoded = std::move(g_decoded.front());
+            g_decoded.pop_front();
+            g_pending--;
+        }
+        g_decodedSpaceAvailable.notify_one();
+
+        std::shared_ptr<Texture> texture = decoded.texture.lock();
+        if (texture == nullptr)
+        {
+            continue;
+        }
+
+        if (decoded.failed)
+        {
+            texture->m_state.store(Texture::State::FAILED, std::memory_order_release);
+            continue;
+        }
+
+        texture->upload(decoded.pixels);
+        uploadedAny = true;
+    }
+}
+
+std::chrono::microseconds TextureLoader::uploadBudget()
+{
+    return g_uploadBudget;
+}
+
+void TextureLoader::setUploadBudget(std::chrono::microseconds budget)
+{
+    g_uploadBudget = budget;
+}
+
+std::size_t TextureLoader::pendingCount()
+{
+    std::lock_guard lock(g_mutex);
+    return g_pending;
+}
+
+Gfx::TextureIdType TextureLoader::placeholderTexture()
+{
+    return g_placeholderTexture;
+}
+
+void TextureLoader::decoderMain()
+{
+    Profiler::setThreadName("Texture decoder");
+
+    while (true)
+    {
+        std::weak_ptr<Texture> request{};
+        {
+            std::unique_lock lock(g_mutex);
+            g_requestAvailable.wait(lock, [] { return !g_running || !g_requests.empty(); });
+            if (!g_running)
+            {
+                return;
+            }
+
+            request = std::move(g_requests.front());
+            g_requests.pop_front();
+        }
+
+        // The path is copied so the texture can be released while its file is being decoded
+        Decoded decoded { .texture = request, .pixels = {}, .failed = false };
+        if (std::shared_ptr<Texture> texture = request.lock(); texture != nullptr)
+        {
+            const std::filesystem::path path = texture->getPath();
+            const Resource::StorageType storageType = texture->getStorageType();
+            texture.reset();
+
+            try
+            {
+                PROFILE_ZONE("Texture::decode");
+                decoded.pixels = Texture::decode(path, storageType);
+            }
+            catch (const std::exception&)
+            {
+                decoded.failed = true;
+            }
+        }
+
+        std::unique_lock lock(g_mutex);
+        g_decodedSpaceAvailable.wait(lock, [] { return !g_running || g_decoded.size() < g_decodedCapacity; });
+        if (!g_running)
+        {
+            return;
+        }
+
+        g_decoded.emplace_back(std::move(decoded));
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Gfx.hpp"
+#include "Korelib.hpp"
+#include "Texture.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Loads textures in the background.
+// Decoder threads read and decode the image files, the decoded pixels wait in a bounded queue and the render thread
+// uploads them at the start of the frame until the upload budget is spent.
+// A requested texture shows a shared placeholder until its own upload happened.
+class TextureLoader final : public korelib::StaticOnlyClass
+{
+public:
+    static constexpr uint32_t DEFAULT_DECODER_COUNT = 2;
+    // Decoders block once this many decoded images wait for upload, which bounds the memory held by pixels in flight
+    static constexpr std::size_t DEFAULT_DECODED_CAPACITY = 8;
+    static constexpr std::chrono::microseconds DEFAULT_UPLOAD_BUDGET { 2000 };
+
+public:
+    // Must be called after Gfx::initialize, the placeholder texture is created here
+    static void initialize(uint32_t decoderCount = DEFAULT_DECODER_COUNT, std::size_t decodedCapacity = DEFAULT_DECODED_CAPACITY);
+    static void destroy();
+
+    // Queues the texture for decoding and points it at the placeholder until it is uploaded.
+    // The loader only keeps a weak reference, textures released before their upload are skipped.
+    static void request(const std::shared_ptr<Texture>& texture);
+
+    // Called by Gfx::beginFrame on the render thread. Always uploads at least one texture so loading keeps progressing.
+    static void processUploads();
+
+    static std::chrono::microseconds uploadBudget();
+    static void setUploadBudget(std::chrono::microseconds budget);
+
+    // Textures requested but not uploaded yet
+    static std::size_t pendingCount();
+    static Gfx::TextureIdType placeholderTexture();
+
+private:
+    struct Decoded
+    {
+        std::weak_ptr<Texture> texture;
+        Texture::Pixels pixels;
+        bool failed;
+    };
+
+    static void decoderMain();
+
+private:
+    static inline std::vector<std::thread> g_decoders {};
+    static inline bool g_running { false };
+
+    static inline std::mutex g_mutex {};
+    static inline std::condition_variable g_requestAvailable {};
+    static inline std::condition_variable g_decodedSpaceAvailable {};
+    static inline std::deque<std::weak_ptr<Texture>> g_requests {};
+    static inline std::deque<Decoded> g_decoded {};
+    static inline std::size_t g_decodedCapacity { DEFAULT_DECODED_CAPACITY };
+    static inline std::size_t g_pending { 0 };
+
+    static inline std::chrono::microseconds g_uploadBudget { DEFAULT_UPLOAD_BUDGET };
+    static inline Gfx::TextureIdType g_placeholderTexture { 0 };
+};
@@ -0,0 +1,382 @@
+#include "TransformStorage.hpp"
+#include "Korelib.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <utility>
+
+TransformStorage::Handle TransformStorage::create(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, Handle parent)
+{
+    const uint32_t parentIndex = parent == INVALID_HANDLE ? NO_PARENT : denseIndex(parent);
+
+    uint32_t slotIndex{};
+    if (!m_freeSlots.empty())
+    {
+        slotIndex = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        slotIndex = static_cast<uint32_t>(m_slots.size());
+        m_slots.emplace_back(Slot{ .denseIndex = 0, .generation = 0 });
+    }
+
+    Slot& slot = m_slots[slotIndex];
+    slot.denseIndex = static_cast<uint32_t>(m_positions.size());
+
+    m_positions.emplace_back(position);
+    m_rotations.emplace_back(rotation);
+    m_scales.emplace_back(scale);
+    m_localMatrices.emplace_back(1.0f);
+    m_worldMatrices.emplace_back(1.0f);
+    m_parents.emplace_back(parentIndex);
+    m_parentHandles.emplace_back(parent);
+    m_flags.emplace_back(LOCAL_DIRTY);
+    m_denseToSlot.emplace_back(slotIndex);
+
+    return { slotIndex, slot.generation };
+}
+
+void TransformStorage::destroy(Handle handle)
+{
+    // Reached from destructors, so a stale handle is ignored instead of throwing
+    if (!isValid(handle))
+    {
+        return;
+    }
+
+    const uint32_t removedIndex = m_slots[handle.index].denseIndex;
+    const uint32_t lastIndex = static_cast<uint32_t>(m_denseToSlot.size() - 1);
+    if (removedIndex != lastIndex)
+    {
+        m_positions[removedIndex] = m_positions[lastIndex];
+        m_rotations[removedIndex] = m_rotations[lastIndex];
+        m_scales[removedIndex] = m_scales[lastIndex];
+        m_localMatrices[removedIndex] = m_localMatrices[lastIndex];
+        m_worldMatrices[removedIndex] = m_worldMatrices[lastIndex];
+        m_parents[removedIndex] = m_parents[lastIndex];
+        m_parentHandles[removedIndex] = m_parentHandles[lastIndex];
+        m_flags[removedIndex] = m_flags[lastIndex];
+        m_denseToSlot[removedIndex] = m_denseToSlot[lastIndex];
+        m_slots[m_denseToSlot[removedIndex]].denseIndex = removedIndex;
+    }
+    // Also without a swap, children of the removed entry still point at its dense index
+    m_orderDirty = true;
+
+    m_positions.pop_back();
+    m_rotations.pop_back();
+    m_scales.pop_back();
+    m_localMatrices.pop_back();
+    m_worldMatrices.pop_back();
+    m_parents.pop_back();
+    m_parentHandles.pop_back();
+    m_flags.pop_back();
+    m_denseToSlot.pop_back();
+
+    m_slots[handle.index].generation++;
+    m_freeSlots.emplace_back(handle.index);
+}
+
+bool TransformStorage::isValid(Handle handle) const
+{
+    return handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation;
+}
+
+std::size_t TransformStorage::size() const
+{
+    return m_positions.size();
+}
+
+const glm::vec3& TransformStorage::getPosition(Handle handle) const
+{
+    return m_positions[denseIndex(handle)];
+}
+
+const glm::quat& TransformStorage::getRotation(Handle handle) const
+{
+    return m_rotations[denseIndex(handle)];
+}
+
+const glm::vec3& TransformStorage::getScale(Handle handle) const
+{
+    return m_scales[denseIndex(handle)];
+}
+
+void TransformStorage::setPosition(Handle handle, const glm::vec3& position)
+{
+    const uint32_t index = denseIndex(handle);
+    m_positions[index] = position;
+    m_flags[index] |= LOCAL_DIRTY;
+}
+
+void TransformStorage::setRotation(Handle handle, const glm::quat& rotation)
+{
+    const uint32_t index = denseIndex(handle);
+    m_rotations[index] = rotation;
+    m_flags[index] |= LOCAL_DIRTY;
+}
+
+void TransformStorage::setScale(Handle handle, const glm::vec3& scale)
+{
+    const uint32_t index = denseIndex(handle);
+    m_scales[index] = scale;
+    m_flags[index] |= LOCAL_DIRTY;
+}
+
+const glm::mat4& TransformStorage::getLocalMatrix(Handle handle) const
+{
+    return m_localMatrices[denseIndex(handle)];
+}
+
+const glm::mat4& TransformStorage::getWorldMatrix(Handle handle) const
+{
+    return m_worldMatrices[denseIndex(handle)];
+}
+
+glm::quat TransformStorage::getWorldRotation(Handle handle) const
+{
+    uint32_t index = denseIndex(handle);
+    glm::quat rotation = m_rotations[index];
+    // Walks the parent handles, the dense parent indices are stale while the order is dirty
+    while (m_parentHandles[index] != INVALID_HANDLE && isValid(m_parentHandles[index]))
+    {
+        index = m_slots[m_parentHandles[index].index].denseIndex;
+        rotation = m_rotations[index] * rotation;
+    }
+    return rotation;
+}
+
+bool TransformStorage::hasWorldChanged(Handle handle) const
+{
+    return (m_flags[denseIndex(handle)] & WORLD_CHANGED) != 0;
+}
+
+void TransformStorage::updateWorldMatrices()
+{
+    PROFILE_ZONE("TransformStorage::updateWorldMatrices");
+
+    if (m_orderDirty)
+    {
+        sortByDepth();
+    }
+
+    for (std::size_t index = 0; index < m_flags.size(); index++)
+    {
+        const uint32_t parentIndex = m_parents[index];
+        const bool localDirty = (m_flags[index] & LOCAL_DIRTY) != 0;
+        const bool parentChanged = parentIndex != NO_PARENT && (m_flags[parentIndex] & WORLD_CHANGED) != 0;
+
+        if (localDirty)
+        {
+            m_localMatrices[index] = glm::translate(m_positions[index]) * glm::toMat4(m_rotations[index]) * glm::scale(m_scales[index]);
+        }
+
+        if (!localDirty && !parentChanged)
+        {
+            m_flags[index] = 0;
+            continue;
+        }
+
+        m_worldMatrices[index] = parentIndex == NO_PARENT ? m_localMatrices[index] : m_worldMatrices[parentIndex] * m_localMatrices[index];
+        m_flags[index] = WORLD_CHANGED;
+    }
+}
+
+std::span<const glm::vec3> TransformStorage::positions() const
+{
+    return m_positions;
+}
+
+std::span<const glm::quat> TransformStorage::rotations() const
+{
+    return m_rotations;
+}
+
+std::span<const glm::vec3> TransformStorage::scales() const
+{
+    return m_scales;
+}
+
+std::span<const glm::mat4> TransformStorage::worldMatrices() const
+{
+    return m_worldMatrices;
+}
+
+uint32_t TransformStorage::denseIndex(Handle handle) const
+{
+    KORELIB_VERIFY_THROW(isValid(handle), korelib::RuntimeException, "Invalid transform handle");
+    return m_slots[handle.index].denseIndex;
+}
+
+void TransformStorage::sortByDepth()
+{
+    PROFILE_ZONE("TransformStorage::sortByDepth");
+
+    static constexpr uint32_t UNKNOWN_DEPTH = std::numeric_limits<uint32_t>::max();
+    const uint32_t count = static_cast<uint32_t>(m_denseToSlot.size());
+
+    // Parents from the handles, which survive the swaps of destroy(). Orphans of a destroyed parent become roots
+    for (uint32_t index = 0; index < count; index++)
+    {
+        if (m_parentHandles[index] == INVALID_HANDLE || !isValid(m_parentHandles[index]))
+        {
+            if (m_parentHandles[index] != INVALID_HANDLE)
+            {
+                m_parentHandles[index] = INVALID_HANDLE;
+                m_flags[index] |= LOCAL_DIRTY;
+            }
+            m_parents[index] = NO_PARENT;
+            continue;
+        }
+
+        m_parents[index] = m_slots[m_parentHandles[index].index].denseIndex;
+    }
+
+    // Depth of every entry, each chain is walked once and everything on it is resolved on the way back
+    m_depths.assign(count, UNKNOWN_DEPTH);
+    uint32_t maxDepth = 0;
+    for (uint32_t index = 0; index < count; index++)
+    {
+        m_order.clear();
+        uint32_t current = index;
+        while (current != NO_PARENT && m_depths[current] == UNKNOWN_DEPTH)
+        {
+            m_order.emplace_back(current);
+            current = m_parents[current];
+        }
+
+        uint32_t depth = current == NO_PARENT ? 0 : m_depths[current] + 1;
+        for (auto it = m_order.rbegin(); it != m_order.rend(); ++it)
+        {
+            m_depths[*it] = depth++;
+        }
+        maxDepth = std::max(maxDepth, depth);
+    }
+
+    // Counting sort by depth, stable so siblings keep their relative order
+    std::vector<uint32_t> depthOffsets(maxDepth + 1, 0);
+    for (uint32_t depth : m_depths)
+    {
+        depthOffsets[depth]++;
+    }
+    uint32_t offset = 0;
+    for (uint32_t& depthOffset : depthOffsets)
+    {
+        offset += std::exchange(depthOffset, offset);
+    }
+    m_order.resize(count);
+    for (uint32_t index = 0; index < count; index++)
+    {
+        m_order[depthOffsets[m_depths[index]]++] = index;
+    }
+
+    const auto permute = [this](auto& values)
+    {
+        auto sorted = values;
+        for (std::size_t index = 0; index < m_order.size(); index++)
+        {
+            sorted[index] = values[m_order[index]];
+        }
+        values = std::move(sorted);
+    };
+    permute(m_positions);
+    permute(m_rotations);
+    permute(m_scales);
+    permute(m_localMatrices);
+    permute(m_worldMatrices);
+    permute(m_parentHandles);
+    permute(m_flags);
+    permute(m_denseToSlot);
+
+    for (uint32_t index = 0; index < count; index++)
+    {
+        m_slots[m_denseToSlot[index]].denseIndex = index;
+    }
+    for (uint32_t index = 0; index < count; index++)
+    {
+        m_parents[index] = m_parentHandles[index] == INVALID_HANDLE ? NO_PARENT : m_slots[m_parentHandles[index].index].denseIndex;
+    }
+
+    m_orderDirty = false;
+}
+
+TransformRef::TransformRef(TransformStorage& storage, TransformStorage::Handle handle) : m_storage(storage), m_handle(handle)
+{
+}
+
+const glm::vec3& TransformRef::position() const
+{
+    return m_storage.getPosition(m_handle);
+}
+
+const glm::quat& TransformRef::rotation() const
+{
+    return m_storage.getRotation(m_handle);
+}
+
+const glm::vec3& TransformRef::scale() const
+{
+    return m_storage.getScale(m_handle);
+}
+
+void TransformRef::setPosition(const glm::vec3& position)
+{
+    m_storage.setPosition(m_handle, position);
+}
+
+void TransformRef::setRotation(const glm::quat& rotation)
+{
+    m_storage.setRotation(m_handle, rotation);
+}
+
+void TransformRef::setScale(const glm::vec3& scale)
+{
+    m_storage.setScale(m_handle, scale);
+}
+
+Gfx::Transform TransformRef::value() const
+{
+    return { .position = position(), .rotation = rotation(), .scale = scale() };
+}
+
+glm::vec3 TransformRef::eulerAngles() const
+{
+    return value().eulerAngles();
+}
+
+glm::vec3 TransformRef::front() const
+{
+    return value().front();
+}
+
+glm::vec3 TransformRef::right() const
+{
+    return value().right();
+}
+
+glm::vec3 TransformRef::up() const
+{
+    return value().up();
+}
+
+void TransformRef::rotate(const glm::vec3& eulerAngles)
+{
+    Gfx::Transform transform = value();
+    transform.rotate(eulerAngles);
+    setRotation(transform.rotation);
+}
+
+glm::mat4 TransformRef::localMatrix() const
+{
+    return value().model();
+}
+
+const glm::mat4& TransformRef::worldMatrix() const
+{
+    return m_storage.getWorldMatrix(m_handle);
+}
+
+glm::quat TransformRef::worldRotation() const
+{
+    return m_storage.getWorldRotation(m_handle);
+}
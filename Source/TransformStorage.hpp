@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Gfx.hpp"
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+// Structure-of-arrays storage for every transform of a scene.
+// Entries are densely packed, Handle stays valid until destroy() regardless of how the arrays move around.
+// A parent always precedes its children, which lets updateWorldMatrices() propagate dirty subtrees in a single
+// linear pass. destroy() swaps the last entry into the hole, which can break that order, so it only marks the
+// order dirty and the next updateWorldMatrices() sorts the entries by depth again.
+// Children of a destroyed transform become roots.
+class TransformStorage
+{
+public:
+    struct Handle
+    {
+        uint32_t index;
+        uint32_t generation;
+
+        constexpr bool operator==(const Handle& other) const = default;
+    };
+
+    static constexpr Handle INVALID_HANDLE { std::numeric_limits<uint32_t>::max(), 0 };
+
+public:
+    Handle create(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, Handle parent = INVALID_HANDLE);
+    void destroy(Handle handle);
+    bool isValid(Handle handle) const;
+    std::size_t size() const;
+
+    const glm::vec3& getPosition(Handle handle) const;
+    const glm::quat& getRotation(Handle handle) const;
+    const glm::vec3& getScale(Handle handle) const;
+
+    void setPosition(Handle handle, const glm::vec3& position);
+    void setRotation(Handle handle, const glm::quat& rotation);
+    void setScale(Handle handle, const glm::vec3& scale);
+
+    const glm::mat4& getLocalMatrix(Handle handle) const;
+    const glm::mat4& getWorldMatrix(Handle handle) const;
+    // Rotations of the transform and its ancestors combined, unlike the world matrix it never carries scale
+    glm::quat getWorldRotation(Handle handle) const;
+    bool hasWorldChanged(Handle handle) const;
+
+    void updateWorldMatrices();
+
+    std::span<const glm::vec3> positions() const;
+    std::span<const glm::quat> rotations() const;
+    std::span<const glm::vec3> scales() const;
+    std::span<const glm::mat4> worldMatrices() const;
+
+private:
+    enum Flags : uint8_t
+    {
+        LOCAL_DIRTY = 1 << 0,
+        WORLD_CHANGED = 1 << 1
+    };
+
+    static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+
+    struct Slot
+    {
+        uint32_t denseIndex;
+        uint32_t generation;
+    };
+
+    uint32_t denseIndex(Handle handle) const;
+    // Restores parent before child order and rebuilds m_parents from m_parentHandles
+    void sortByDepth();
+
+private:
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::quat> m_rotations;
+    std::vector<glm::vec3> m_scales;
+    std::vector<glm::mat4> m_localMatrices;
+    std::vector<glm::mat4> m_worldMatrices;
+    // Dense index of the parent, only valid while the order is not dirty
+    std::vector<uint32_t> m_parents;
+    std::vector<Handle> m_parentHandles;
+    std::vector<uint8_t> m_flags;
+    std::vector<uint32_t> m_denseToSlot;
+
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+    bool m_orderDirty { false };
+
+    // Scratch space of sortByDepth
+    std::vector<uint32_t> m_depths;
+    std::vector<uint32_t> m_order;
+};
+
+// Short-lived view of a single transform, do not keep it around across structural scene changes.
+class TransformRef
+{
+public:
+    TransformRef(TransformStorage& storage, TransformStorage::Handle handle);
+
+    const glm::vec3& position() const;
+    const glm::quat& rotation() const;
+    const glm::vec3& scale() const;
+
+    void setPosition(const glm::vec3& position);
+    void setRotation(const glm::quat& rotation);
+    void setScale(const glm::vec3& scale);
+
+    Gfx::Transform value() const;
+    glm::vec3 eulerAngles() const;
+    glm::vec3 front() const;
+    glm::vec3 right() const;
+    glm::vec3 up() const;
+
+    void rotate(const glm::vec3& eulerAngles);
+
+    glm::mat4 localMatrix() const;
+    const glm::mat4& worldMatrix() const;
+    glm::quat worldRotation() const;
+
+private:
+    TransformStorage& m_storage;
+    TransformStorage::Handle m_handle;
+};
@@ -0,0 +1,227 @@
+#include "VoxelMesher.hpp"
+#include "Profiler.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <optional>
+
+namespace
+{
+    // Block textures are tiled per block and aligned to the block grid, the same directions MeshRenderer's CUBE uses:
+    // sides run along x or z with y up, top and bottom run along x with -z up
+    glm::vec2 tileOf(const glm::vec3& position, int32_t axis)
+    {
+        switch (axis)
+        {
+            case 0:
+                return { position.z + 0.5f, position.y + 0.5f };
+            case 1:
+                return { position.x + 0.5f, 0.5f - position.z };
+            default:
+                return { position.x + 0.5f, position.y + 0.5f };
+        }
+    }
+}
+
+VoxelPalette::VoxelPalette(std::shared_ptr<const TextureAtlas> atlas, std::span<const Block> blocks) : m_atlas(std::move(atlas))
+{
+    KORELIB_VERIFY_THROW(m_atlas != nullptr && m_atlas->getLayout() == TextureAtlas::Layout::ARRAY, korelib::RuntimeException, "Voxel palettes need an ARRAY atlas");
+    KORELIB_VERIFY_THROW(blocks.size() <= std::numeric_limits<BlockId>::max(), korelib::RuntimeException, fmt::format("{} block types don't fit a block ID", blocks.size()));
+
+    m_faces.reserve(blocks.size());
+    for (const Block& block : blocks)
+    {
+        const std::optional<TextureAtlas::Region> region = m_atlas->find(block.texture);
+        KORELIB_VERIFY_THROW(region.has_value(), korelib::RuntimeException, fmt::format("{} is not part of the atlas", block.texture.string()));
+
+        const auto band = [&region](uint32_t index, uint32_t count) -> FaceTexture
+        {
+            const float height = region->scale.y / static_cast<float>(count);
+            return { .layer = region->layer, .region = glm::vec4(region->offset.x, region->offset.y + height * static_cast<float>(index), region->scale.x, height) };
+        };
+
+        if (block.layout == Layout::COLUMN)
+        {
+            m_faces.push_back({ band(1, 3), band(2, 3), band(0, 3) });
+        }
+        else
+        {
+            m_faces.push_back({ band(0, 1), band(0, 1), band(0, 1) });
+        }
+    }
+}
+
+const std::shared_ptr<const TextureAtlas>& VoxelPalette::getAtlas() const
+{
+    return m_atlas;
+}
+
+VoxelPalette::BlockId VoxelPalette::maxBlockId() const
+{
+    return static_cast<BlockId>(m_faces.size());
+}
+
+const VoxelPalette::FaceTexture& VoxelPalette::faceTexture(BlockId block, Face face) const
+{
+    KORELIB_VERIFY_THROW(block != 0 && block <= m_faces.size(), korelib::RuntimeException, fmt::format("Block ID {} has no textures", block));
+    return m_faces[block - 1][static_cast<std::size_t>(face)];
+}
+
+std::span<const Gfx::Attribute> VoxelMesher::vertexLayout()
+{
+    static constexpr std::array<Gfx::Attribute, 4> attributes
+    {{
+        {
+            .index = 0,
+            .numComponents = 3,
+            .stride = sizeof(Vertex),
+            .type = Gfx::Attribute::Type::FLOAT,
+            .offset = offsetof(Vertex, position),
+            .aligned = false
+        },
+        {
+            .index = 1,
+            .numComponents = 2,
+            .stride = sizeof(Vertex),
+            .type = Gfx::Attribute::Type::FLOAT,
+            .offset = offsetof(Vertex, tile),
+            .aligned = false
+        },
+        {
+            .index = Gfx::VOXEL_REGION_ATTRIBUTE_INDEX,
+            .numComponents = 4,
+            .stride = sizeof(Vertex),
+            .type = Gfx::Attribute::Type::FLOAT,
+            .offset = offsetof(Vertex, region),
+            .aligned = false
+        },
+        {
+            .index = Gfx::VOXEL_LAYER_ATTRIBUTE_INDEX,
+            .numComponents = 1,
+            .stride = sizeof(Vertex),
+            .type = Gfx::Attribute::Type::FLOAT,
+            .offset = offsetof(Vertex, layer),
+            .aligned = false
+        }
+    }};
+
+    return attributes;
+}
+
+VoxelMesher::Result VoxelMesher::mesh(std::span<const BlockId> paddedBlocks, const VoxelPalette& palette)
+{
+    PROFILE_ZONE("VoxelMesher::mesh");
+    KORELIB_VERIFY_THROW(paddedBlocks.size() == PADDED_BLOCK_COUNT, korelib::RuntimeException, fmt::format("Expected {} blocks, got {}", PADDED_BLOCK_COUNT, paddedBlocks.size()));
+
+    Result result{};
+    // Block type of every visible face in the current slice, indexed by the two in-plane axes
+    std::array<BlockId, CHUNK_SIZE * CHUNK_SIZE> mask{};
+
+    for (int32_t axis = 0; axis < 3; axis++)
+    {
+        const int32_t u = (axis + 1) % 3;
+        const int32_t v = (axis + 2) % 3;
+
+        for (int32_t side : { -1, 1 })
+        {
+            glm::ivec3 normal(0);
+            normal[axis] = side;
+            const VoxelPalette::Face face = axis != 1 ? VoxelPalette::Face::SIDE : side > 0 ? VoxelPalette::Face::TOP : VoxelPalette::Face::BOTTOM;
+
+            for (int32_t slice = 0; slice < CHUNK_SIZE; slice++)
+            {
+                for (int32_t j = 0; j < CHUNK_SIZE; j++)
+                {
+                    for (int32_t i = 0; i < CHUNK_SIZE; i++)
+                    {
+                        glm::ivec3 cell{};
+                        cell[axis] = slice;
+                        cell[u] = i;
+                        cell[v] = j;
+                        const glm::ivec3 neighbour = cell + normal;
+
+                        const BlockId block = paddedBlocks[paddedIndex(cell.x, cell.y, cell.z)];
+                        const bool visible = block != AIR && paddedBlocks[paddedIndex(neighbour.x, neighbour.y, neighbour.z)] == AIR;
+                        mask[i + j * CHUNK_SIZE] = visible ? block : AIR;
+                        result.stats.visibleFaces += visible ? 1 : 0;
+                    }
+                }
+
+                for (int32_t j = 0; j < CHUNK_SIZE; j++)
+                {
+                    for (int32_t i = 0; i < CHUNK_SIZE;)
+                    {
+                        const BlockId block = mask[i + j * CHUNK_SIZE];
+                        if (block == AIR)
+                        {
+                            i++;
+                            continue;
+                        }
+
+                        int32_t width = 1;
+                        while (i + width < CHUNK_SIZE && mask[i + width + j * CHUNK_SIZE] == block)
+                        {
+                            width++;
+                        }
+
+                        int32_t height = 1;
+                        for (; j + height < CHUNK_SIZE; height++)
+                        {
+                            bool rowMatches = true;
+                            for (int32_t k = 0; k < width && rowMatches; k++)
+                            {
+                                rowMatches = mask[i + k + (j + height) * CHUNK_SIZE] == block;
+                            }
+                            if (!rowMatches)
+                            {
+                                break;
+                            }
+                        }
+
+                        for (int32_t row = 0; row < height; row++)
+                        {
+                            std::fill_n(mask.begin() + i + (j + row) * CHUNK_SIZE, width, AIR);
+                        }
+
+                        glm::vec3 origin{};
+                        origin[axis] = static_cast<float>(slice) + 0.5f * static_cast<float>(side);
+                        origin[u] = static_cast<float>(i) - 0.5f;
+                        origin[v] = static_cast<float>(j) - 0.5f;
+                        glm::vec3 alongU(0.0f);
+                        alongU[u] = static_cast<float>(width);
+                        glm::vec3 alongV(0.0f);
+                        alongV[v] = static_cast<float>(height);
+
+                        const VoxelPalette::FaceTexture& texture = palette.faceTexture(block, face);
+                        const uint32_t base = static_cast<uint32_t>(result.vertices.size());
+                        for (const glm::vec3& corner : { origin, origin + alongU, origin + alongU + alongV, origin + alongV })
+                        {
+                            result.vertices.push_back({ .position = corner, .tile = tileOf(corner, axis), .region = texture.region, .layer = static_cast<float>(texture.layer) });
+                            result.bounds.expand(corner);
+                        }
+
+                        // Counter-clockwise seen from the air side
+                        if (glm::dot(glm::cross(alongU, alongV), glm::vec3(normal)) > 0.0f)
+                        {
+                            result.triangles.push_back({ base, base + 1, base + 2 });
+                            result.triangles.push_back({ base, base + 2, base + 3 });
+                        }
+                        else
+                        {
+                            result.triangles.push_back({ base, base + 2, base + 1 });
+                            result.triangles.push_back({ base, base + 3, base + 2 });
+                        }
+
+                        result.stats.quads++;
+                        i += width;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Gfx.hpp"
+#include "Korelib.hpp"
+#include "TextureAtlas.hpp"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Texture of every block face by block ID, resolved against an ARRAY atlas.
+// Immutable once built so meshing jobs can read it from worker threads.
+class VoxelPalette
+{
+public:
+    using BlockId = uint8_t;
+
+    // How a block texture is laid out, the same way MeshRenderer's CUBE UVs read it
+    enum class Layout : uint8_t
+    {
+        // The whole texture on every face
+        SINGLE,
+        // Three horizontal bands, bottom face in the lowest third, sides in the middle and top face in the upper third
+        COLUMN
+    };
+
+    enum class Face : uint8_t
+    {
+        SIDE,
+        TOP,
+        BOTTOM
+    };
+
+    struct Block
+    {
+        std::filesystem::path texture;
+        Layout layout;
+    };
+
+    // Where one face samples, region is (offset, scale) inside the page
+    struct FaceTexture
+    {
+        uint32_t layer;
+        glm::vec4 region;
+    };
+
+public:
+    // blocks[i] becomes block ID i + 1, ID 0 is air
+    VoxelPalette(std::shared_ptr<const TextureAtlas> atlas, std::span<const Block> blocks);
+
+    const std::shared_ptr<const TextureAtlas>& getAtlas() const;
+    // Highest block ID that has textures
+    BlockId maxBlockId() const;
+    const FaceTexture& faceTexture(BlockId block, Face face) const;
+
+private:
+    std::shared_ptr<const TextureAtlas> m_atlas;
+    std::vector<std::array<FaceTexture, 3>> m_faces;
+};
+
+// Turns a dense grid of block IDs into one mesh.
+// Only faces between a block and air are kept, and coplanar faces of the same block type are merged into
+// rectangles greedily: along the first axis of the slice as far as the type repeats, then along the second axis
+// as long as the whole row matches. Pure CPU work without shared state, any thread may mesh.
+class VoxelMesher final : public korelib::StaticOnlyClass
+{
+public:
+    using BlockId = VoxelPalette::BlockId;
+
+    static constexpr BlockId AIR = 0;
+    static constexpr int32_t CHUNK_SIZE = 16;
+    static constexpr uint32_t CHUNK_BLOCK_COUNT = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+    // The grid handed to mesh() has a border of one block taken from the neighbouring chunks
+    static constexpr int32_t PADDED_SIZE = CHUNK_SIZE + 2;
+    static constexpr uint32_t PADDED_BLOCK_COUNT = PADDED_SIZE * PADDED_SIZE * PADDED_SIZE;
+
+    // tile counts blocks across a merged quad, the shader repeats the face region once per block
+    struct Vertex
+    {
+        glm::vec3 position;
+        glm::vec2 tile;
+        glm::vec4 region;
+        float layer;
+    };
+
+    struct Stats
+    {
+        // Faces between a block and air, what one quad per visible face would draw
+        uint32_t visibleFaces;
+        uint32_t quads;
+    };
+
+    struct Result
+    {
+        std::vector<Vertex> vertices;
+        std::vector<std::array<uint32_t, 3>> triangles;
+        AABB bounds;
+        Stats stats;
+    };
+
+public:
+    static std::span<const Gfx::Attribute> vertexLayout();
+
+    // x fastest, then y, then z
+    static constexpr uint32_t blockIndex(int32_t x, int32_t y, int32_t z)
+    {
+        return static_cast<uint32_t>(x + y * CHUNK_SIZE + z * CHUNK_SIZE * CHUNK_SIZE);
+    }
+
+    // Chunk coordinates from -1 to CHUNK_SIZE
+    static constexpr uint32_t paddedIndex(int32_t x, int32_t y, int32_t z)
+    {
+        return static_cast<uint32_t>((x + 1) + (y + 1) * PADDED_SIZE + (z + 1) * PADDED_SIZE * PADDED_SIZE);
+    }
+
+    // Block centers sit on integer coordinates, so the chunk covers [-0.5, CHUNK_SIZE - 0.5] on every axis
+    static Result mesh(std::span<const BlockId> paddedBlocks, const VoxelPalette& palette);
+};
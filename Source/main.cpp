@@ -5,161 +5,34 @@
 #include "fmt/format.h"
 #include "Korelib.hpp"
 #include "Gfx.hpp"
-
+#include "JobSystem.hpp"
+#include "Mesh.hpp"
+#include "MeshOptimizer.hpp"
+#include "Profiler.hpp"
+#include "RenderQueue.hpp"
+#include "ResourceManager.hpp"
+#include "ShaderCache.hpp"
+#include "ShaderPermutations.hpp"
+
+#include "Archive.hpp"
 #include "Components/Camera.hpp"
+#include "Components/Material.hpp"
+#include "Components/MeshRenderer.hpp"
+#include "Components/VoxelChunk.hpp"
 #include "SceneGraph.hpp"
+#include "Texture.hpp"
+#include "TextureAtlas.hpp"
+#include "TextureLoader.hpp"
+#include "VoxelMesher.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <iterator>
+#include <span>
 #include <vector>
-#include <thread>
 #include <limits>
 
-class Material : public Component
-{
-public:
-    Material(const std::shared_ptr<Entity>& parent) : Component("Material", parent), m_shaderProgram(Gfx::defaultShaderProgram())
-    {
-    }
-
-    void update() override
-    {
-        Gfx::setShaderProgram(m_shaderProgram);
-
-        if (m_texture.has_value())
-        {
-            Gfx::updateTextureData(m_texture.value());
-        }
-
-        if (const std::shared_ptr<Camera>& camera = Gfx::getActiveCamera(); camera != nullptr)
-        {
-            Gfx::setShaderMat4x4Value(Gfx::defaultShaderProgram(), "view", camera->view());
-            Gfx::setShaderMat4x4Value(Gfx::defaultShaderProgram(), "projection", camera->projection());
-        }
-    }
-
-    Gfx::ShaderType shaderProgram() const
-    {
-        return m_shaderProgram;
-    }
-
-    void setTexture(const Gfx::Texture& texture)
-    {
-        m_texture = texture;
-    }
-
-    std::vector<Gfx::Attribute> attributes() const
-    {
-        return
-        {
-            {
-                .index = 0,
-                .numComponents = 3,
-                .stride = sizeof(Gfx::Vertex),
-                .type = Gfx::Attribute::Type::FLOAT,
-                .offset = offsetof(Gfx::Vertex, position),
-                .aligned = false
-            },
-            {
-                .index = 1,
-                .numComponents = 2,
-                .stride = sizeof(Gfx::Vertex),
-                .type = Gfx::Attribute::Type::FLOAT,
-                .offset = offsetof(Gfx::Vertex, uv),
-                .aligned = false
-            }
-        };
-    }
-
-protected:
-    Gfx::ShaderType m_shaderProgram;
-    std::optional<Gfx::Texture> m_texture;
-};
-
-class MeshRenderer : public Component
-{
-public:
-    enum class PrimitiveType : uint8_t
-    {
-        CUBE,
-    };
-
-public:
-    MeshRenderer(const std::shared_ptr<Entity>& parent, PrimitiveType primitiveType) : Component("MeshRenderer", parent), m_vertexBufferObject(Gfx::createVertexBufferObject()), m_vertexArrayObject(Gfx::createVertexArrayObject())
-    {
-        m_material = gameObject().addComponent<Material>();
-
-        switch (primitiveType)
-        {
-            case PrimitiveType::CUBE:
-            {
-                m_vertices.reserve(24);
-                m_vertices = {
-                    /*[ 0]*/ {{-0.5f, -0.5f,  0.5f},     {0.0f, 1.0f / 3}},  // front  - bottom - left
-                    /*[ 1]*/ {{-0.5f,  0.5f,  0.5f}, {0.0f, 1.0f / 3 * 2}},  // front  - top    - left
-                    /*[ 2]*/ {{ 0.5f,  0.5f,  0.5f}, {1.0f, 1.0f / 3 * 2}},  // front  - top    - right
-                    /*[ 3]*/ {{ 0.5f, -0.5f,  0.5f},     {1.0f, 1.0f / 3}},  // front  - bottom - right
-                    /*[ 4]*/ {{-0.5f, -0.5f, -0.5f},     {0.0f, 1.0f / 3}},  // back   - bottom - left
-                    /*[ 5]*/ {{-0.5f,  0.5f, -0.5f}, {0.0f, 1.0f / 3 * 2}},  // back   - top    - left
-                    /*[ 6]*/ {{ 0.5f,  0.5f, -0.5f}, {1.0f, 1.0f / 3 * 2}},  // back   - top    - right
-                    /*[ 7]*/ {{ 0.5f, -0.5f, -0.5f},     {1.0f, 1.0f / 3}},  // back   - bottom - right
-                    /*[ 8]*/ {{-0.5f, -0.5f, -0.5f},     {0.0f, 1.0f / 3}},  // left   - bottom - back
-                    /*[ 9]*/ {{-0.5f,  0.5f, -0.5f}, {0.0f, 1.0f / 3 * 2}},  // left   - top    - back
-                    /*[10]*/ {{-0.5f,  0.5f,  0.5f}, {1.0f, 1.0f / 3 * 2}},  // left   - top    - front
-                    /*[11]*/ {{-0.5f, -0.5f,  0.5f},     {1.0f, 1.0f / 3}},  // left   - bottom - front
-                    /*[12]*/ {{ 0.5f, -0.5f, -0.5f},     {0.0f, 1.0f / 3}},  // right  - bottom - back
-                    /*[13]*/ {{ 0.5f,  0.5f, -0.5f}, {0.0f, 1.0f / 3 * 2}},  // right  - top    - back
-                    /*[14]*/ {{ 0.5f,  0.5f,  0.5f}, {1.0f, 1.0f / 3 * 2}},  // right  - top    - front
-                    /*[15]*/ {{ 0.5f, -0.5f,  0.5f},     {1.0f, 1.0f / 3}},  // right  - bottom - front
-                    /*[16]*/ {{-0.5f,  0.5f,  0.5f}, {0.0f, 1.0f / 3 * 2}},  // top    - near   - left
-                    /*[17]*/ {{-0.5f,  0.5f, -0.5f},         {0.0f, 1.0f}},  // top    - far    - left
-                    /*[18]*/ {{ 0.5f,  0.5f, -0.5f},         {1.0f, 1.0f}},  // top    - far    - right
-                    /*[19]*/ {{ 0.5f,  0.5f,  0.5f}, {1.0f, 1.0f / 3 * 2}},  // top    - near   - right
-                    /*[20]*/ {{-0.5f, -0.5f,  0.5f},         {0.0f, 0.0f}},  // bottom - near   - left
-                    /*[21]*/ {{-0.5f, -0.5f, -0.5f},     {0.0f, 1.0f / 3}},  // bottom - far    - left
-                    /*[22]*/ {{ 0.5f, -0.5f, -0.5f},     {1.0f, 1.0f / 3}},  // bottom - far    - right
-                    /*[23]*/ {{ 0.5f, -0.5f,  0.5f},         {1.0f, 0.0f}},  // bottom - near   - right
-                };
-
-                m_triangles.reserve(36);
-                m_triangles = {
-                     { 2,  1,  0},  {0,  3,  2}, // front
-                     { 7,  5,  6},  {7,  4,  5}, // back
-                     { 8, 11, 10},  {9,  8, 10}, // left
-                     {15, 12, 13}, {13, 14, 15}, // right
-                     {17, 16, 19}, {18, 17, 19}, // top
-                     {21, 22, 20}, {23, 20, 22}, // bottom
-                };
-                break;
-            }
-            default:
-                break;
-        }
-    }
-
-    void update() override
-    {
-        Gfx::Transform& transform = gameObject().m_transform;
-        Gfx::drawIndexedGeometry(
-            transform,
-            m_vertices,
-            m_triangles,
-            m_material->shaderProgram(),
-            m_vertexBufferObject,
-            m_vertexArrayObject,
-            m_material->attributes()
-        );
-    }
-
-protected:
-    std::vector<Gfx::Vertex> m_vertices;
-    std::vector<std::array<uint32_t, 3>> m_triangles;
-
-    Gfx::VertexBufferObjectType m_vertexBufferObject;
-    Gfx::VertexArrayObjectType m_vertexArrayObject;
-
-    std::shared_ptr<Material> m_material;
-};
-
 class FlyCameraController : public Component
 {
 public:
@@ -167,39 +40,39 @@ public:
     {
     }
 
-    void update() override
+    void update(float deltaTime) override
     {
-        Gfx::Transform& transform = std::static_pointer_cast<GameObject>(getParent())->m_transform;
+        TransformRef transform = gameObject().transform();
         const glm::vec2 mousePosition = Input::GetMousePosition();
 
         if (Input::GetKeyDown(GLFW_KEY_W))
         {
-            transform.position += speed * Gfx::deltaTime() * transform.front();
+            transform.setPosition(transform.position() + speed * deltaTime * transform.front());
         }
 
         if (Input::GetKeyDown(GLFW_KEY_S))
         {
-            transform.position -= speed * Gfx::deltaTime() * transform.front();
+            transform.setPosition(transform.position() - speed * deltaTime * transform.front());
         }
 
         if (Input::GetKeyDown(GLFW_KEY_A))
         {
-            transform.position -= glm::normalize(glm::cross(transform.front(), transform.up())) * speed * Gfx::deltaTime();
+            transform.setPosition(transform.position() - glm::normalize(glm::cross(transform.front(), transform.up())) * speed * deltaTime);
         }
 
         if (Input::GetKeyDown(GLFW_KEY_D))
         {
-            transform.position += glm::normalize(glm::cross(transform.front(), transform.up())) * speed * Gfx::deltaTime();
+            transform.setPosition(transform.position() + glm::normalize(glm::cross(transform.front(), transform.up())) * speed * deltaTime);
         }
 
         if (Input::GetKeyDown(GLFW_KEY_SPACE))
         {
-            transform.position += speed * Gfx::deltaTime() * transform.up();
+            transform.setPosition(transform.position() + speed * deltaTime * transform.up());
         }
 
         if (Input::GetKeyDown(GLFW_KEY_LEFT_CONTROL))
         {
-            transform.position -= speed * Gfx::deltaTime() * transform.up();
+            transform.setPosition(transform.position() - speed * deltaTime * transform.up());
         }
 
         if (Input::GetMouseButtonDown(GLFW_MOUSE_BUTTON_RIGHT))
@@ -212,7 +85,7 @@ public:
             eluerAngles.y += yoffset;
             eluerAngles.y = glm::clamp(eluerAngles.y, -89.0f, 89.0f);
 
-            transform.rotation = glm::quat(glm::radians(eluerAngles));
+            transform.setRotation(glm::quat(glm::radians(eluerAngles)));
         }
 
         lastMousePosition = mousePosition;
@@ -232,10 +105,15 @@ public:
     {
     }
 
-    void update()
+    bool isThreadSafe() const override
+    {
+        return true;
+    }
+
+    void update(float deltaTime) override
     {
-        glm::vec3 rot = {rotationSpeed.x * Gfx::deltaTime(), rotationSpeed.y * Gfx::deltaTime(), rotationSpeed.z * Gfx::deltaTime()}; 
-        gameObject().m_transform.rotate(std::move(rot));
+        glm::vec3 rot = {rotationSpeed.x * deltaTime, rotationSpeed.y * deltaTime, rotationSpeed.z * deltaTime}; 
+        gameObject().transform().rotate(std::move(rot));
     }
 
 public:
@@ -248,10 +126,15 @@ int main(int argc, char** argv)
     static constexpr uint32_t INITIAL_WINDOW_HEIGHT = 720;
 
     Gfx::initialize(INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT, "Learn OpenGL", Gfx::WindowFlags::NONE);
+    JobSystem::initialize();
+    ShaderCache::initialize("./ShaderCache");
+    TextureLoader::initialize();
+    Archive::mount(Archive::open("./Resources.pak"));
 
     std::shared_ptr<Scene> scene = Scene::create("MyScene");
+    scene->setUpdateMode(Scene::UpdateMode::PARALLEL);
     std::shared_ptr<GameObject> cameraGameObject = scene->addGameObject("MainCamera", {0.0f, 0.0f, -2.5f});
-    cameraGameObject->m_transform.rotation = glm::quat(glm::radians(glm::vec3(90.0f, 0.0f, 0.0f)));
+    cameraGameObject->transform().setRotation(glm::quat(glm::radians(glm::vec3(90.0f, 0.0f, 0.0f))));
     std::shared_ptr<Camera> cameraComponent = cameraGameObject->addComponent<Camera>(45, 0.1f, 100);
     std::shared_ptr<FlyCameraController> flyCameraController = cameraGameObject->addComponent<FlyCameraController>();
     std::shared_ptr<GameObject> cube = scene->addGameObject("Cube", {0.0f, 0.0f, 0.0f});
@@ -259,26 +142,62 @@ int main(int argc, char** argv)
     //cube->addComponent<CubeRotator>();
     if (std::optional<std::reference_wrapper<Material>> cubeMaterial = cube->getComponent<Material>(); cubeMaterial.has_value())
     {
-        Gfx::Texture texture = Gfx::Texture::fromFile("./Resources/Textures/Grass_Block.jpg");
-        cubeMaterial->get().setTexture(std::move(texture));
+        cubeMaterial->get().setTexture(ResourceManager::texture("Textures/Grass_Block.jpg", Resource::StorageType::ARCHIVE));
+    }
+
+    // The sphere primitive comes in authoring order, compare it against the optimised order and quantize every level
+    std::vector<Gfx::Vertex> sphereVertices = MeshRenderer::primitiveMesh(MeshRenderer::PrimitiveType::SPHERE)->getVertices();
+    std::vector<std::array<uint32_t, 3>> sphereTriangles = MeshRenderer::primitiveMesh(MeshRenderer::PrimitiveType::SPHERE)->getTriangles();
+    const MeshOptimizer::CacheStats sphereAuthoredCache = MeshOptimizer::analyzeVertexCache(sphereTriangles, sphereVertices.size());
+    MeshOptimizer::optimize(sphereVertices, sphereTriangles);
+    const MeshOptimizer::CacheStats sphereOptimizedCache = MeshOptimizer::analyzeVertexCache(sphereTriangles, sphereVertices.size());
+    std::vector<MeshRenderer::Lod> sphereLods = MeshRenderer::buildLods(std::make_shared<Mesh>(std::move(sphereVertices), std::move(sphereTriangles)));
+    for (MeshRenderer::Lod& lod : sphereLods)
+    {
+        lod.mesh = Mesh::quantized(*lod.mesh);
+    }
+    std::shared_ptr<GameObject> sphere = scene->addGameObject("Sphere", {2.0f, 0.0f, 0.0f});
+    std::shared_ptr<MeshRenderer> sphereRenderer = sphere->addComponent<MeshRenderer>(std::move(sphereLods));
+    if (std::optional<std::reference_wrapper<Material>> sphereMaterial = sphere->getComponent<Material>(); sphereMaterial.has_value())
+    {
+        sphereMaterial->get().setTexture(ResourceManager::texture("Textures/Diamond_Ore.jpg", Resource::StorageType::ARCHIVE));
     }
 
+    static constexpr VoxelChunk::BlockId GRASS_BLOCK = 1;
+    static constexpr VoxelChunk::BlockId DIAMOND_ORE = 2;
+    const std::array<TextureAtlas::Source, 2> blockTextures {{
+        { .path = "Textures/Grass_Block.jpg", .storageType = Resource::StorageType::ARCHIVE },
+        { .path = "Textures/Diamond_Ore.jpg", .storageType = Resource::StorageType::ARCHIVE }
+    }};
+    const std::array<VoxelPalette::Block, 2> blocks {{
+        { .texture = "Textures/Grass_Block.jpg", .layout = VoxelPalette::Layout::COLUMN },
+        { .texture = "Textures/Diamond_Ore.jpg", .layout = VoxelPalette::Layout::SINGLE }
+    }};
+    std::shared_ptr<const VoxelPalette> blockPalette = std::make_shared<VoxelPalette>(TextureAtlas::build(blockTextures), blocks);
+    std::shared_ptr<GameObject> terrain = scene->addGameObject("Terrain", {-8.0f, -12.0f, -8.0f});
+    std::shared_ptr<VoxelChunk> terrainChunk = terrain->addComponent<VoxelChunk>(blockPalette);
+    terrainChunk->fill({0, 0, 0}, {VoxelChunk::SIZE - 1, 9, VoxelChunk::SIZE - 1}, GRASS_BLOCK);
+    terrainChunk->fill({7, 10, 7}, {8, 12, 8}, DIAMOND_ORE);
+
     Gfx::setActiveCamera(cameraComponent);
     Gfx::setClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     while (!Gfx::windowShouldClose())
     {
         Gfx::beginFrame();
-        scene->update();
+        scene->update(Gfx::deltaTime());
 
         static ImGuizmo::OPERATION mCurrentGizmoOperation(ImGuizmo::TRANSLATE);
         static ImGuizmo::MODE mCurrentGizmoMode(ImGuizmo::LOCAL);
 
-        glm::mat4 mod = cube->m_transform.model();
+        glm::mat4 mod = cube->transform().localMatrix();
         glm::mat4 camView = cameraComponent->view();
         glm::mat4 camProj = cameraComponent->projection();
 
-        glm::vec3 camEuler = cameraGameObject->m_transform.eulerAngles();
-        glm::vec3 cubeEuler = cube->m_transform.eulerAngles();
+        glm::vec3 camPosition = cameraGameObject->transform().position();
+        glm::vec3 camEuler = cameraGameObject->transform().eulerAngles();
+        glm::vec3 cubePosition = cube->transform().position();
+        glm::vec3 cubeEuler = cube->transform().eulerAngles();
+        glm::vec3 cubeScale = cube->transform().scale();
 
         ImGui::Begin("Stats");
         if (ImGui::RadioButton("Translate", mCurrentGizmoOperation == ImGuizmo::TRANSLATE))
@@ -289,9 +208,11 @@ int main(int argc, char** argv)
         ImGui::SameLine();
         if (ImGui::RadioButton("Scale", mCurrentGizmoOperation == ImGuizmo::SCALE))
             mCurrentGizmoOperation = ImGuizmo::SCALE;
-        ImGui::InputFloat3("Cube.Position", glm::value_ptr(cube->m_transform.position));
+        if (ImGui::InputFloat3("Cube.Position", glm::value_ptr(cubePosition)))
+            cube->transform().setPosition(cubePosition);
         ImGui::InputFloat3("Cube.EulerAngles", glm::value_ptr(cubeEuler));
-        ImGui::InputFloat3("Cube.Scale", glm::value_ptr(cube->m_transform.scale));
+        if (ImGui::InputFloat3("Cube.Scale", glm::value_ptr(cubeScale)))
+            cube->transform().setScale(cubeScale);
         ImGui::Separator();
         ImGui::InputFloat4("Cube.Model[0]", glm::value_ptr(mod[0]));
         ImGui::InputFloat4("Cube.Model[1]", glm::value_ptr(mod[1]));
@@ -308,14 +229,92 @@ int main(int argc, char** argv)
         ImGui::InputFloat4("Camera.Proj[2]", glm::value_ptr(camProj[2]));
         ImGui::InputFloat4("Camera.Proj[3]", glm::value_ptr(camProj[3]));
         ImGui::Separator();
-        ImGui::InputFloat3("Camera.Position", glm::value_ptr(cameraGameObject->m_transform.position));
+        if (ImGui::InputFloat3("Camera.Position", glm::value_ptr(camPosition)))
+            cameraGameObject->transform().setPosition(camPosition);
         ImGui::InputFloat3("Camera.EulerAngles", glm::value_ptr(camEuler));
 
         ImGui::SliderFloat("Camera.near", &cameraComponent->near(), 0.0f, cameraComponent->far());
         ImGui::SliderFloat("Camera.far", &cameraComponent->far(), cameraComponent->near(), 1000);
         ImGui::SliderFloat("Camera.fov", &cameraComponent->fov(), 0, 180);
+        ImGui::Separator();
+        ImGui::Text("Renderers: %u visible, %u culled (%u BVH nodes tested)", scene->cullingStats().visible, scene->cullingStats().culled, scene->cullingStats().nodesTested);
+        ImGui::Text("Draw packets: %u (%u instanced draws)", RenderQueue::stats().packets, RenderQueue::stats().batches);
+        ImGui::Text("State changes: %u (saved %u)", RenderQueue::stats().stateChanges, RenderQueue::stats().stateChangesSaved);
+        ImGui::Text("Textures loading: %zu", TextureLoader::pendingCount());
+        ImGui::Text("Resources: %zu (%zu referenced, %llu evicted)", ResourceManager::stats().resources, ResourceManager::stats().referenced, static_cast<unsigned long long>(ResourceManager::stats().evictions));
+        ImGui::Text("Shader programs: %u (%u linking, %u compiled, %u from binaries, %u binaries rejected)", ShaderCache::stats().programs, ShaderCache::stats().pending, ShaderCache::stats().compiled, ShaderCache::stats().binaryLoads, ShaderCache::stats().binaryRejects);
+        ImGui::Text("Shader variants used: %u of %u", ShaderPermutations::usedVariantCount(), ShaderPermutations::VARIANT_COUNT);
+        ImGui::Text("Terrain: %u quads for %u visible faces, %u vertices%s", terrainChunk->meshStats().quads, terrainChunk->meshStats().visibleFaces,
+            terrainChunk->getMesh() != nullptr ? terrainChunk->getMesh()->getVertexCount() : 0, terrainChunk->isMeshing() ? " (meshing)" : "");
+        ImGui::Text("Sphere: LOD %u of %zu, %u triangles", sphereRenderer->lodIndex(), sphereRenderer->getLods().size(), sphereRenderer->getLods()[sphereRenderer->lodIndex()].mesh->getIndexCount() / 3);
+        ImGui::Text("Sphere cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u bytes per vertex", sphereAuthoredCache.acmr, sphereOptimizedCache.acmr, sphereAuthoredCache.atvr, sphereOptimizedCache.atvr,
+            sphereRenderer->getMesh()->getVertexStride());
+        float lodErrorPixels = MeshRenderer::lodErrorPixels();
+        if (ImGui::SliderFloat("LOD error (px)", &lodErrorPixels, 0.0f, 16.0f))
+            MeshRenderer::setLodErrorPixels(lodErrorPixels);
+        if (ImGui::Button("Terrain.Dig"))
+        {
+            // Takes the top grass block off the next column, each click remeshes the chunk on a worker
+            static int32_t digColumn = 0;
+            const glm::ivec3 column(digColumn % VoxelChunk::SIZE, 0, (digColumn / VoxelChunk::SIZE) % VoxelChunk::SIZE);
+            int32_t top = VoxelChunk::SIZE - 1;
+            while (top >= 0 && terrainChunk->getBlock({column.x, top, column.z}) == VoxelMesher::AIR)
+            {
+                top--;
+            }
+            if (top >= 0)
+            {
+                terrainChunk->setBlock({column.x, top, column.z}, VoxelMesher::AIR);
+            }
+            digColumn++;
+        }
+        if (std::optional<std::reference_wrapper<Material>> cubeMaterial = cube->getComponent<Material>(); cubeMaterial.has_value())
+        {
+            ShaderPermutations::FeatureMask features = cubeMaterial->get().features();
+            bool lighting = (features & ShaderPermutations::LIGHTING) != 0;
+            bool fog = (features & ShaderPermutations::FOG) != 0;
+            if (ImGui::Checkbox("Cube.Lighting", &lighting))
+                features ^= ShaderPermutations::LIGHTING;
+            ImGui::SameLine();
+            if (ImGui::Checkbox("Cube.Fog", &fog))
+                features ^= ShaderPermutations::FOG;
+            cubeMaterial->get().setFeatures(features);
+        }
+
+        Gfx::Environment environment = Gfx::environment();
+        bool environmentChanged = ImGui::InputFloat3("Light.Direction", glm::value_ptr(environment.lightDirection));
+        environmentChanged |= ImGui::SliderFloat("Fog.Start", &environment.fogStart, 0.0f, 100.0f);
+        environmentChanged |= ImGui::SliderFloat("Fog.End", &environment.fogEnd, 0.0f, 200.0f);
+        if (environmentChanged)
+            Gfx::setEnvironment(environment);
+        ImGui::Text("Resource memory: %.2f MiB CPU, %.2f MiB GPU", ResourceManager::stats().cpuBytes / (1024.0 * 1024.0), ResourceManager::stats().gpuBytes / (1024.0 * 1024.0));
+        ImGui::Separator();
+
+        static constexpr const char* PACING_MODES[] = { "Unlimited", "Fixed", "VSync" };
+        int32_t pacingMode = static_cast<int32_t>(Gfx::pacingMode());
+        if (ImGui::Combo("Frame pacing", &pacingMode, PACING_MODES, static_cast<int32_t>(std::size(PACING_MODES))))
+            Gfx::setPacingMode(static_cast<Gfx::PacingMode>(pacingMode));
+        if (Gfx::pacingMode() == Gfx::PacingMode::FIXED)
+        {
+            float targetFrameRate = static_cast<float>(Gfx::targetFrameRate());
+            if (ImGui::SliderFloat("Target FPS", &targetFrameRate, 10.0f, 360.0f, "%.0f"))
+                Gfx::setTargetFrameRate(targetFrameRate);
+        }
+
+        const Gfx::FrameTimeStats frameTimes = Gfx::frameTimeStats();
+        ImGui::Text("Frame time: %.2f ms avg, p50 %.2f, p95 %.2f, p99 %.2f, max %.2f (%u frames)", frameTimes.average, frameTimes.p50, frameTimes.p95, frameTimes.p99, frameTimes.max, frameTimes.samples);
+        if (ImGui::Button("Reset frame times"))
+            Gfx::resetFrameTimes();
+
+        // Trailing empty buckets would only squash the interesting part of the plot
+        const std::span<const uint32_t> histogram = Gfx::frameTimeHistogram();
+        const size_t usedBuckets = histogram.size() - std::distance(histogram.rbegin(), std::find_if(histogram.rbegin(), histogram.rend(), [](uint32_t count) { return count > 0; }));
+        std::vector<float> buckets(histogram.begin(), histogram.begin() + std::max<size_t>(usedBuckets, 1));
+        ImGui::PlotHistogram("##FrameTimeHistogram", buckets.data(), static_cast<int32_t>(buckets.size()), 0, "Frame time histogram", 0.0f, *std::max_element(buckets.begin(), buckets.end()), ImVec2(-1.0f, 64.0f));
         ImGui::End();
 
+        Profiler::drawTimeline();
+
         ImGuizmo::Manipulate(
             glm::value_ptr(camView),
             glm::value_ptr(camProj),
@@ -333,15 +332,21 @@ int main(int argc, char** argv)
 
         if (ImGuizmo::IsUsing())
         {
-            cube->m_transform.position = translation;
-            cube->m_transform.rotation = rotation;
-            cube->m_transform.scale = scale;
+            cube->transform().setPosition(translation);
+            cube->transform().setRotation(rotation);
+            cube->transform().setScale(scale);
         }
 
         Gfx::endFrame();
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 
+    scene.reset();
+    TextureLoader::destroy();
+    ResourceManager::destroy();
+    ShaderPermutations::reset();
+    ShaderCache::destroy();
+    Archive::unmountAll();
+    JobSystem::destroy();
     Gfx::destroy();
     return 0;
 }
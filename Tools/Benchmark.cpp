@@ -0,0 +1,532 @@
+#include "Gfx.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include "RenderQueue.hpp"
+#include "SceneGraph.hpp"
+#include "TextureLoader.hpp"
+#include "Components/Camera.hpp"
+#include "Components/MeshRenderer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    enum class Mix : uint8_t
+    {
+        // MeshRenderer (and its Material) only
+        RENDER,
+        // Thread-safe Spinner component plus a registry system, nothing is drawn
+        LOGIC,
+        // Both of the above on every object
+        MIXED
+    };
+
+    enum class Format : uint8_t
+    {
+        JSON,
+        CSV
+    };
+
+    struct Options
+    {
+        std::vector<uint32_t> objectCounts { 1'000, 10'000, 100'000, 1'000'000 };
+        std::vector<uint32_t> depths { 1, 8 };
+        std::vector<Mix> mixes { Mix::MIXED };
+        uint32_t frames { 10 };
+        uint32_t repetitions { 5 };
+        uint32_t seed { 1337 };
+        Format format { Format::JSON };
+        std::string filter{};
+        std::filesystem::path output{};
+        std::filesystem::path trace{};
+    };
+
+    struct Parameters
+    {
+        uint32_t objects;
+        uint32_t depth;
+        Mix mix;
+    };
+
+    struct Result
+    {
+        std::string name;
+        Parameters parameters;
+        uint64_t operations;
+        // Nanoseconds per operation over the repetitions
+        double median;
+        double min;
+        double max;
+        std::vector<std::pair<std::string, double>> counters;
+    };
+
+    // Keeps results of measured code alive without a side effect the compiler could see through
+    volatile uint64_t g_sink = 0;
+
+    class Spinner : public Component
+    {
+    public:
+        Spinner(const std::shared_ptr<Entity>& parent, const glm::vec3& speed) : Component("Spinner", parent), m_speed(speed)
+        {
+        }
+
+        bool isThreadSafe() const override
+        {
+            return true;
+        }
+
+        void update(float deltaTime) override
+        {
+            gameObject().transform().rotate(m_speed * deltaTime);
+        }
+
+    private:
+        glm::vec3 m_speed;
+    };
+
+    struct Velocity
+    {
+        glm::vec3 value;
+    };
+
+    struct SyntheticScene
+    {
+        std::shared_ptr<Scene> scene;
+        std::vector<std::shared_ptr<GameObject>> objects;
+        std::shared_ptr<Camera> camera;
+    };
+
+    std::string_view mixName(Mix mix)
+    {
+        switch (mix)
+        {
+            case Mix::RENDER:
+                return "render";
+            case Mix::LOGIC:
+                return "logic";
+            default:
+                return "mixed";
+        }
+    }
+
+    // Objects form parent chains of `depth` links scattered through a cube sized to keep the density constant,
+    // the camera sits in front of it so roughly half of the renderers are inside its frustum
+    SyntheticScene buildScene(const Parameters& parameters, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        const float extent = std::cbrt(static_cast<float>(parameters.objects)) * 2.0f;
+        std::uniform_real_distribution<float> position(-extent, extent);
+        std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> speed(-90.0f, 90.0f);
+
+        SyntheticScene result{};
+        result.scene = Scene::create("Benchmark");
+        result.objects.reserve(parameters.objects);
+
+        const bool render = parameters.mix != Mix::LOGIC;
+        const bool logic = parameters.mix != Mix::RENDER;
+
+        std::shared_ptr<GameObject> parent{};
+        for (uint32_t index = 0; index < parameters.objects; index++)
+        {
+            const bool isRoot = index % parameters.depth == 0;
+            const glm::vec3 localPosition = isRoot ? glm::vec3(position(random), position(random), position(random)) : glm::vec3(offset(random), offset(random), offset(random));
+
+            std::shared_ptr<GameObject> object = result.scene->addGameObject("Object", localPosition, isRoot ? nullptr : parent);
+            if (render)
+            {
+                object->addComponent<MeshRenderer>(MeshRenderer::PrimitiveType::CUBE);
+            }
+            if (logic)
+            {
+                object->addComponent<Spinner>(glm::vec3(speed(random), speed(random), speed(random)));
+                object->addComponent<Velocity>(glm::vec3(offset(random), offset(random), offset(random)));
+            }
+
+            parent = object;
+            result.objects.emplace_back(std::move(object));
+        }
+
+        if (logic)
+        {
+            TransformStorage& transforms = result.scene->transforms();
+            result.scene->addSystem([&transforms](Registry& registry, float deltaTime)
+            {
+                registry.each<TransformStorage::Handle, Velocity>([&transforms, deltaTime](Registry::EntityId, TransformStorage::Handle& handle, Velocity& velocity)
+                {
+                    transforms.setPosition(handle, transforms.getPosition(handle) + velocity.value * deltaTime);
+                });
+            });
+        }
+
+        std::shared_ptr<GameObject> cameraObject = result.scene->addGameObject("Camera", { 0.0f, 0.0f, -extent * 1.5f });
+        cameraObject->transform().setRotation(glm::quat(glm::radians(glm::vec3(90.0f, 0.0f, 0.0f))));
+        result.camera = cameraObject->addComponent<Camera>(60.0f, 0.1f, extent * 4.0f);
+        Gfx::setActiveCamera(result.camera);
+
+        return result;
+    }
+
+    // Drops the active camera too, it would otherwise outlive the GameObject it reads its view from
+    void releaseScene(SyntheticScene& synthetic)
+    {
+        Gfx::setActiveCamera(nullptr);
+        synthetic = {};
+    }
+
+    // Runs fn once per repetition and reports nanoseconds per operation, setup runs untimed before every repetition
+    Result measure(std::string name, const Parameters& parameters, uint64_t operations, uint32_t repetitions, const std::function<void()>& setup, const std::function<void()>& fn)
+    {
+        std::vector<double> samples{};
+        samples.reserve(repetitions);
+        for (uint32_t repetition = 0; repetition < repetitions; repetition++)
+        {
+            if (setup)
+            {
+                setup();
+            }
+
+            const Clock::time_point begin = Clock::now();
+            fn();
+            const Clock::time_point end = Clock::now();
+
+            samples.emplace_back(std::chrono::duration<double, std::nano>(end - begin).count() / static_cast<double>(std::max<uint64_t>(operations, 1)));
+        }
+
+        std::sort(samples.begin(), samples.end());
+        return Result{
+            .name = std::move(name),
+            .parameters = parameters,
+            .operations = operations,
+            .median = samples[samples.size() / 2],
+            .min = samples.front(),
+            .max = samples.back(),
+            .counters = {}
+        };
+    }
+
+    void runFrames(Scene& scene, uint32_t frames)
+    {
+        for (uint32_t frame = 0; frame < frames; frame++)
+        {
+            Gfx::beginFrame();
+            scene.update(Gfx::deltaTime());
+            Gfx::endFrame();
+        }
+    }
+
+    void runSuite(const Options& options, const Parameters& parameters, std::vector<Result>& results)
+    {
+        auto enabled = [&options](std::string_view name) { return options.filter.empty() || name.find(options.filter) != std::string_view::npos; };
+        const uint32_t objects = parameters.objects;
+
+        if (enabled("scene.build"))
+        {
+            SyntheticScene built{};
+            results.emplace_back(measure("scene.build", parameters, objects, options.repetitions,
+                [&built]() { releaseScene(built); },
+                [&]() { built = buildScene(parameters, options.seed); }));
+            releaseScene(built);
+        }
+
+        SyntheticScene synthetic = buildScene(parameters, options.seed);
+
+        if (enabled("gameobject.getComponents"))
+        {
+            results.emplace_back(measure("gameobject.getComponents", parameters, objects, options.repetitions, nullptr, [&synthetic]()
+            {
+                uint64_t found = 0;
+                for (const std::shared_ptr<GameObject>& object : synthetic.objects)
+                {
+                    found += object->getComponents<MeshRenderer>().size();
+                    found += object->getComponent<Spinner>().has_value() ? 1 : 0;
+                }
+                g_sink = g_sink + found;
+            }));
+        }
+
+        if (enabled("transform.updateWorldMatrices"))
+        {
+            TransformStorage& transforms = synthetic.scene->transforms();
+            results.emplace_back(measure("transform.updateWorldMatrices", parameters, objects, options.repetitions,
+                [&synthetic, &parameters]()
+                {
+                    // Dirty every root so the whole hierarchy is propagated
+                    for (std::size_t index = 0; index < synthetic.objects.size(); index += parameters.depth)
+                    {
+                        TransformRef transform = synthetic.objects[index]->transform();
+                        transform.setPosition(transform.position() + glm::vec3(0.001f));
+                    }
+                },
+                [&transforms]() { transforms.updateWorldMatrices(); }));
+        }
+
+        if (enabled("gfx.transform.model"))
+        {
+            std::vector<Gfx::Transform> values{};
+            values.reserve(synthetic.objects.size());
+            for (const std::shared_ptr<GameObject>& object : synthetic.objects)
+            {
+                values.emplace_back(object->transform().value());
+            }
+
+            results.emplace_back(measure("gfx.transform.model", parameters, objects, options.repetitions, nullptr, [&values]()
+            {
+                float sum = 0.0f;
+                for (const Gfx::Transform& value : values)
+                {
+                    sum += value.model()[3][0];
+                }
+                g_sink = g_sink + static_cast<uint64_t>(sum);
+            }));
+        }
+
+        if (parameters.mix != Mix::LOGIC && enabled("renderqueue.submitFlush"))
+        {
+            std::vector<RenderQueue::DrawPacket> packets{};
+            packets.reserve(synthetic.objects.size());
+            for (const std::shared_ptr<GameObject>& object : synthetic.objects)
+            {
+                const MeshRenderer& renderer = object->getComponents<MeshRenderer>().front();
+                packets.emplace_back(RenderQueue::DrawPacket{ .shaderProgram = Gfx::defaultShaderProgram(), .texture = 0, .mesh = renderer.getMesh().get(), .model = object->transform().worldMatrix(), .textureArray = false, .textureLayer = 0 });
+            }
+
+            Result& result = results.emplace_back(measure("renderqueue.submitFlush", parameters, objects, options.repetitions, nullptr, [&packets]()
+            {
+                for (const RenderQueue::DrawPacket& packet : packets)
+                {
+                    RenderQueue::submit(packet);
+                }
+                RenderQueue::flush();
+            }));
+            result.counters = { { "drawCalls", static_cast<double>(RenderQueue::stats().batches) } };
+        }
+
+        for (const Scene::UpdateMode mode : { Scene::UpdateMode::SERIAL, Scene::UpdateMode::PARALLEL })
+        {
+            const std::string name = mode == Scene::UpdateMode::SERIAL ? "frame.serial" : "frame.parallel";
+            if (!enabled(name))
+            {
+                continue;
+            }
+
+            synthetic.scene->setUpdateMode(mode);
+            runFrames(*synthetic.scene, 1);
+
+            Result& result = results.emplace_back(measure(name, parameters, static_cast<uint64_t>(objects) * options.frames, options.repetitions, nullptr, [&]()
+            {
+                runFrames(*synthetic.scene, options.frames);
+            }));
+            result.counters = {
+                { "visible", static_cast<double>(synthetic.scene->cullingStats().visible) },
+                { "culled", static_cast<double>(synthetic.scene->cullingStats().culled) },
+                { "drawCalls", static_cast<double>(Gfx::frameStats().drawCalls) }
+            };
+        }
+
+        releaseScene(synthetic);
+    }
+
+    void writeJson(std::FILE* file, const Options& options, const std::vector<Result>& results)
+    {
+        std::fprintf(file, "{\n  \"benchmark\": \"learnopengl\",\n  \"workers\": %u,\n  \"frames\": %u,\n  \"repetitions\": %u,\n  \"seed\": %u,\n  \"results\": [", JobSystem::workerCount(), options.frames, options.repetitions, options.seed);
+        for (std::size_t index = 0; index < results.size(); index++)
+        {
+            const Result& result = results[index];
+            std::fprintf(file, "%s\n    {\"name\": \"%s\", \"objects\": %u, \"depth\": %u, \"mix\": \"%s\", \"operations\": %llu, \"nsPerOp\": {\"median\": %.3f, \"min\": %.3f, \"max\": %.3f}, \"opsPerSecond\": %.1f",
+                index == 0 ? "" : ",", result.name.c_str(), result.parameters.objects, result.parameters.depth, std::string(mixName(result.parameters.mix)).c_str(),
+                static_cast<unsigned long long>(result.operations), result.median, result.min, result.max, 1.0e9 / result.median);
+            for (const auto& [counter, value] : result.counters)
+            {
+                std::fprintf(file, ", \"%s\": %.0f", counter.c_str(), value);
+            }
+            std::fprintf(file, "}");
+        }
+        std::fprintf(file, "\n  ]\n}\n");
+    }
+
+    void writeCsv(std::FILE* file, const std::vector<Result>& results)
+    {
+        std::fprintf(file, "name,objects,depth,mix,operations,median_ns_per_op,min_ns_per_op,max_ns_per_op,ops_per_second\n");
+        for (const Result& result : results)
+        {
+            std::fprintf(file, "%s,%u,%u,%s,%llu,%.3f,%.3f,%.3f,%.1f\n", result.name.c_str(), result.parameters.objects, result.parameters.depth, std::string(mixName(result.parameters.mix)).c_str(),
+                static_cast<unsigned long long>(result.operations), result.median, result.min, result.max, 1.0e9 / result.median);
+        }
+    }
+
+    std::optional<std::vector<uint32_t>> parseList(std::string_view value)
+    {
+        std::vector<uint32_t> numbers{};
+        while (!value.empty())
+        {
+            const std::size_t comma = value.find(',');
+            const std::string_view item = value.substr(0, comma);
+
+            uint32_t number{};
+            const auto [end, error] = std::from_chars(item.data(), item.data() + item.size(), number);
+            if (error != std::errc{} || end != item.data() + item.size() || number == 0)
+            {
+                return std::nullopt;
+            }
+
+            numbers.emplace_back(number);
+            value = comma == std::string_view::npos ? std::string_view{} : value.substr(comma + 1);
+        }
+
+        return numbers.empty() ? std::nullopt : std::optional(std::move(numbers));
+    }
+
+    void printUsage(const char* executable)
+    {
+        std::fprintf(stderr, "usage: %s [--objects 1000,10000,...] [--depth 1,8,...] [--mix render|logic|mixed|all] [--frames N] [--repetitions N] [--seed N]\n"
+                             "          [--filter substring] [--format json|csv] [--output file] [--trace file]\n", executable);
+    }
+}
+
+// Headless benchmarks of the scene graph and render submission hot paths over synthetic scenes
+int main(int argc, char** argv)
+{
+    Options options{};
+    for (int argument = 1; argument < argc; argument++)
+    {
+        const std::string_view value = argv[argument];
+        const bool hasNext = argument + 1 < argc;
+        if ((value == "--objects" || value == "--depth") && hasNext)
+        {
+            std::optional<std::vector<uint32_t>> list = parseList(argv[++argument]);
+            if (!list.has_value())
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+            (value == "--objects" ? options.objectCounts : options.depths) = std::move(*list);
+        }
+        else if ((value == "--frames" || value == "--repetitions" || value == "--seed") && hasNext)
+        {
+            std::optional<std::vector<uint32_t>> number = parseList(argv[++argument]);
+            if (!number.has_value() || number->size() != 1)
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+            (value == "--frames" ? options.frames : value == "--repetitions" ? options.repetitions : options.seed) = number->front();
+        }
+        else if (value == "--mix" && hasNext)
+        {
+            const std::string_view mode = argv[++argument];
+            if (mode == "render") options.mixes = { Mix::RENDER };
+            else if (mode == "logic") options.mixes = { Mix::LOGIC };
+            else if (mode == "mixed") options.mixes = { Mix::MIXED };
+            else if (mode == "all") options.mixes = { Mix::RENDER, Mix::LOGIC, Mix::MIXED };
+            else
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (value == "--format" && hasNext)
+        {
+            const std::string_view mode = argv[++argument];
+            if (mode == "json") options.format = Format::JSON;
+            else if (mode == "csv") options.format = Format::CSV;
+            else
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (value == "--filter" && hasNext)
+        {
+            options.filter = argv[++argument];
+        }
+        else if (value == "--output" && hasNext)
+        {
+            options.output = argv[++argument];
+        }
+        else if (value == "--trace" && hasNext)
+        {
+            options.trace = argv[++argument];
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Result> results{};
+    try
+    {
+        Gfx::initialize(1280, 720, "Benchmark", Gfx::WindowFlags::NONE, Gfx::Backend::NONE);
+        JobSystem::initialize();
+        TextureLoader::initialize();
+
+        // Zones cost a few percent on the hottest paths, only pay for them when a trace was asked for
+        Profiler::setEnabled(!options.trace.empty());
+
+        for (const Mix mix : options.mixes)
+        {
+            for (const uint32_t depth : options.depths)
+            {
+                for (const uint32_t objects : options.objectCounts)
+                {
+                    std::fprintf(stderr, "objects %u, depth %u, mix %s\n", objects, depth, std::string(mixName(mix)).c_str());
+                    runSuite(options, Parameters{ .objects = objects, .depth = depth, .mix = mix }, results);
+                }
+            }
+        }
+
+        if (!options.trace.empty())
+        {
+            Profiler::writeChromeTrace(options.trace);
+        }
+
+        TextureLoader::destroy();
+        JobSystem::destroy();
+        Gfx::destroy();
+    }
+    catch (const std::exception& exception)
+    {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+
+    std::FILE* file = options.output.empty() ? stdout : std::fopen(options.output.string().c_str(), "w");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "Failed to open '%s' for writing\n", options.output.string().c_str());
+        return 1;
+    }
+
+    if (options.format == Format::JSON)
+    {
+        writeJson(file, options, results);
+    }
+    else
+    {
+        writeCsv(file, results);
+    }
+
+    if (file != stdout)
+    {
+        std::fclose(file);
+    }
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <thread>
+
+// Queues background jobs behind a slow one, destroys the job system and checks that every job ran and released its captures
+namespace
+{
+    constexpr uint32_t JOB_COUNT = 64;
+
+    bool check(bool condition, const char* name)
+    {
+        std::printf("%-4s %s\n", condition ? "ok" : "FAIL", name);
+        return condition;
+    }
+}
+
+int main()
+{
+    uint32_t failures = 0;
+    try
+    {
+        JobSystem::initialize(1);
+
+        // Keeps the only worker busy, so the jobs below are still queued when destroy() starts
+        JobSystem::submitBackground([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+
+        JobSystem::Counter counter{};
+        std::atomic<uint32_t> ran { 0 };
+        const std::shared_ptr<uint32_t> captured = std::make_shared<uint32_t>(0);
+        for (uint32_t job = 0; job < JOB_COUNT; job++)
+        {
+            JobSystem::submitBackground([&ran, captured]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+        }
+
+        JobSystem::destroy();
+
+        failures += check(JobSystem::isDone(counter), "counter reaches zero") ? 0 : 1;
+        failures += check(ran.load() == JOB_COUNT, "every queued job ran") ? 0 : 1;
+        failures += check(captured.use_count() == 1, "captures are released") ? 0 : 1;
+    }
+    catch (const std::exception& exception)
+    {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+#include "Archive.hpp"
+#include "TextureCompression.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace
+{
+    enum class Compression
+    {
+        NONE,
+        BC1,
+        BC3,
+        BC7,
+        // BC1 for opaque images, BC7 when the image has alpha
+        AUTO
+    };
+
+    bool isImage(const std::filesystem::path& file)
+    {
+        std::string extension = file.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char character) { return static_cast<char>(std::tolower(character)); });
+        return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".tga" || extension == ".bmp";
+    }
+
+    // Images are stored as texture caches under their original name, Texture recognizes them by their magic
+    std::optional<std::vector<std::byte>> compressImage(const std::filesystem::path& file, Compression compression, TextureCompression::MipFilter filter)
+    {
+        if (compression == Compression::NONE || !isImage(file))
+        {
+            return std::nullopt;
+        }
+
+        TextureCompression::Image image{};
+        uint8_t* data = stbi_load(file.string().c_str(), &image.width, &image.height, &image.channels, 0);
+        KORELIB_VERIFY_THROW(data != nullptr, korelib::RuntimeException, fmt::format("Failed to load image '{}': {}", file.string(), stbi_failure_reason()));
+
+        image.pixels.assign(data, data + static_cast<std::size_t>(image.width) * image.height * image.channels);
+        stbi_image_free(data);
+
+        TextureCompression::Format format{};
+        switch (compression)
+        {
+            case Compression::BC1:
+                format = TextureCompression::Format::BC1;
+                break;
+            case Compression::BC3:
+                format = TextureCompression::Format::BC3;
+                break;
+            case Compression::BC7:
+                format = TextureCompression::Format::BC7;
+                break;
+            default:
+                format = (image.channels == 2 || image.channels == 4) ? TextureCompression::Format::BC7 : TextureCompression::Format::BC1;
+                break;
+        }
+
+        return TextureCompression::serialize(TextureCompression::encode(image, format, filter));
+    }
+
+    void printUsage(const char* executable)
+    {
+        std::fprintf(stderr, "usage: %s [--compress none|bc1|bc3|bc7|auto] [--mip-filter box|kaiser] <input directory> <output archive>\n", executable);
+    }
+}
+
+// Packs every file below a directory into a single archive, optionally turning images into compressed texture caches
+int main(int argc, char** argv)
+{
+    Compression compression = Compression::NONE;
+    TextureCompression::MipFilter filter = TextureCompression::MipFilter::KAISER;
+    std::vector<std::string_view> positional{};
+
+    for (int argument = 1; argument < argc; argument++)
+    {
+        const std::string_view value = argv[argument];
+        if (value == "--compress" && argument + 1 < argc)
+        {
+            const std::string_view mode = argv[++argument];
+            if (mode == "none") compression = Compression::NONE;
+            else if (mode == "bc1") compression = Compression::BC1;
+            else if (mode == "bc3") compression = Compression::BC3;
+            else if (mode == "bc7") compression = Compression::BC7;
+            else if (mode == "auto") compression = Compression::AUTO;
+            else
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (value == "--mip-filter" && argument + 1 < argc)
+        {
+            const std::string_view mode = argv[++argument];
+            if (mode == "box") filter = TextureCompression::MipFilter::BOX;
+            else if (mode == "kaiser") filter = TextureCompression::MipFilter::KAISER;
+            else
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else
+        {
+            positional.emplace_back(value);
+        }
+    }
+
+    if (positional.size() != 2)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        ArchiveWriter writer{};
+        writer.addDirectory(positional[0], [compression, filter](const std::filesystem::path& file) { return compressImage(file, compression, filter); });
+        writer.write(positional[1]);
+
+        std::printf("Packed %zu entries into '%s'\n", writer.entryCount(), std::string(positional[1]).c_str());
+    }
+    catch (const std::exception& exception)
+    {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+
+    return 0;
+}
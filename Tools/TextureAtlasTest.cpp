@@ -0,0 +1,107 @@
+#include "TextureAtlas.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+// Packs odd sized solid color images and checks that no texel of the kept mip levels covers pixels of two regions
+namespace
+{
+    struct Case
+    {
+        const char* name;
+        int32_t padding;
+        TextureAtlas::Layout layout;
+    };
+
+    TextureCompression::Image solid(int32_t width, int32_t height, std::array<uint8_t, 4> color)
+    {
+        TextureCompression::Image image { width, height, 4, std::vector<uint8_t>(static_cast<std::size_t>(width) * height * 4) };
+        for (std::size_t pixel = 0; pixel < static_cast<std::size_t>(width) * height; pixel++)
+        {
+            std::memcpy(image.pixels.data() + pixel * 4, color.data(), 4);
+        }
+        return image;
+    }
+
+    // Every 2^level x 2^level block of the page holds a single color, so box filtering never blends two regions
+    bool isBlockUniform(const TextureCompression::Image& page, int32_t blockX, int32_t blockY, int32_t blockSize)
+    {
+        const uint8_t* first = page.pixels.data() + (static_cast<std::size_t>(blockY) * page.width + blockX) * 4;
+        for (int32_t y = blockY; y < blockY + blockSize; y++)
+        {
+            for (int32_t x = blockX; x < blockX + blockSize; x++)
+            {
+                if (std::memcmp(first, page.pixels.data() + (static_cast<std::size_t>(y) * page.width + x) * 4, 4) != 0)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool check(const Case& testCase, const std::vector<TextureCompression::Image>& images)
+    {
+        const TextureAtlas::Settings settings { .layout = testCase.layout, .pageSize = 0, .padding = testCase.padding, .mipFilter = TextureCompression::MipFilter::BOX };
+        const TextureAtlas::Pages pages = TextureAtlas::pack(images, settings);
+
+        uint32_t mixedTexels = 0;
+        for (const TextureCompression::Image& page : pages.layers)
+        {
+            for (std::size_t level = 1; level < pages.levelCount; level++)
+            {
+                const int32_t blockSize = 1 << level;
+                for (int32_t y = 0; y + blockSize <= page.height; y += blockSize)
+                {
+                    for (int32_t x = 0; x + blockSize <= page.width; x += blockSize)
+                    {
+                        mixedTexels += isBlockUniform(page, x, y, blockSize) ? 0 : 1;
+                    }
+                }
+            }
+        }
+
+        const bool passed = mixedTexels == 0 && pages.levelCount >= 1;
+        std::printf("%-4s %-28s %zu levels, %u mixed texels\n", passed ? "ok" : "FAIL", testCase.name, pages.levelCount, mixedTexels);
+        return passed;
+    }
+}
+
+int main()
+{
+    // Odd sizes, none of them a multiple of the alignment
+    const std::vector<TextureCompression::Image> images {
+        solid(5, 7, { 255, 0, 0, 255 }),
+        solid(3, 3, { 0, 255, 0, 255 }),
+        solid(9, 5, { 0, 0, 255, 255 }),
+        solid(7, 11, { 255, 255, 0, 255 }),
+        solid(1, 1, { 0, 255, 255, 255 }),
+        solid(13, 3, { 255, 0, 255, 255 })
+    };
+
+    const std::vector<Case> cases {
+        { "atlas, padding 4", 4, TextureAtlas::Layout::ATLAS },
+        { "array, padding 4", 4, TextureAtlas::Layout::ARRAY },
+        { "atlas, padding 8", 8, TextureAtlas::Layout::ATLAS },
+        { "atlas, padding 3", 3, TextureAtlas::Layout::ATLAS }
+    };
+
+    uint32_t failures = 0;
+    try
+    {
+        for (const Case& testCase : cases)
+        {
+            failures += check(testCase, images) ? 0 : 1;
+        }
+    }
+    catch (const std::exception& exception)
+    {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
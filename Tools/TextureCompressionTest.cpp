@@ -0,0 +1,122 @@
+#include "TextureCompression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+// Encodes known blocks with every block format, decodes them with the reference decoders and checks the PSNR
+namespace
+{
+    constexpr int32_t SIZE = 8;
+
+    struct Case
+    {
+        std::string_view name;
+        // RGBA of the pixel at (x, y)
+        std::function<std::array<uint8_t, 4>(int32_t x, int32_t y)> pixel;
+        // Lowest acceptable PSNR over RGB for BC1, over RGBA for BC3 and BC7
+        double minimumPsnr;
+        // Skipped for BC1, which has no alpha
+        bool translucent;
+    };
+
+    struct Codec
+    {
+        std::string_view name;
+        std::vector<uint8_t> (*encode)(const TextureCompression::Image& image);
+        TextureCompression::Image (*decode)(std::span<const uint8_t> blocks, int32_t width, int32_t height);
+        int32_t comparedChannels;
+    };
+
+    TextureCompression::Image makeImage(const Case& testCase)
+    {
+        TextureCompression::Image image { SIZE, SIZE, 4, std::vector<uint8_t>(static_cast<std::size_t>(SIZE) * SIZE * 4) };
+        for (int32_t y = 0; y < SIZE; y++)
+        {
+            for (int32_t x = 0; x < SIZE; x++)
+            {
+                const std::array<uint8_t, 4> pixel = testCase.pixel(x, y);
+                std::copy(pixel.begin(), pixel.end(), image.pixels.begin() + (static_cast<std::size_t>(y) * SIZE + x) * 4);
+            }
+        }
+        return image;
+    }
+
+    // Infinity for an exact match
+    double psnr(const TextureCompression::Image& expected, const TextureCompression::Image& actual, int32_t channels)
+    {
+        double squaredError = 0.0;
+        for (std::size_t pixel = 0; pixel < static_cast<std::size_t>(SIZE) * SIZE; pixel++)
+        {
+            for (int32_t channel = 0; channel < channels; channel++)
+            {
+                const double difference = static_cast<double>(expected.pixels[pixel * 4 + channel]) - actual.pixels[pixel * 4 + channel];
+                squaredError += difference * difference;
+            }
+        }
+
+        const double meanSquaredError = squaredError / (static_cast<double>(SIZE) * SIZE * channels);
+        return meanSquaredError == 0.0 ? std::numeric_limits<double>::infinity() : 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+    }
+
+    uint8_t ramp(int32_t position)
+    {
+        return static_cast<uint8_t>(position * 255 / (SIZE - 1));
+    }
+}
+
+int main()
+{
+    const std::vector<Case> cases {
+        { "solid", [](int32_t, int32_t) { return std::array<uint8_t, 4> { 200, 100, 50, 255 }; }, 38.0, false },
+        // Two color blocks are exact in BC1 and BC3, BC7 mode 6 loses a little to its endpoint precision
+        { "black/white checker", [](int32_t x, int32_t y) { const uint8_t value = (x + y) % 2 == 0 ? 255 : 0; return std::array<uint8_t, 4> { value, value, value, 255 }; }, 50.0, false },
+        // Chroma only, orthogonal to (1, 1, 1). A block collapsed to its mean color falls far below this floor.
+        { "red/green checker", [](int32_t x, int32_t y) { return (x + y) % 2 == 0 ? std::array<uint8_t, 4> { 255, 0, 0, 255 } : std::array<uint8_t, 4> { 0, 255, 0, 255 }; }, 50.0, false },
+        { "red/green gradient", [](int32_t x, int32_t) { return std::array<uint8_t, 4> { ramp(x), static_cast<uint8_t>(255 - ramp(x)), 128, 255 }; }, 28.0, false },
+        { "yellow/blue gradient", [](int32_t, int32_t y) { return std::array<uint8_t, 4> { static_cast<uint8_t>(96 + y * 8), static_cast<uint8_t>(96 + y * 8), static_cast<uint8_t>(191 - y * 16), 255 }; }, 28.0, false },
+        { "alpha gradient", [](int32_t x, int32_t y) { return std::array<uint8_t, 4> { 90, 160, 220, ramp((x + y) / 2) }; }, 30.0, true }
+    };
+
+    const std::vector<Codec> codecs {
+        { "BC1", TextureCompression::encodeBC1, TextureCompression::decodeBC1, 3 },
+        { "BC3", TextureCompression::encodeBC3, TextureCompression::decodeBC3, 4 },
+        { "BC7", TextureCompression::encodeBC7, TextureCompression::decodeBC7, 4 }
+    };
+
+    uint32_t failures = 0;
+    try
+    {
+        for (const Case& testCase : cases)
+        {
+            const TextureCompression::Image image = makeImage(testCase);
+            for (const Codec& codec : codecs)
+            {
+                if (testCase.translucent && codec.comparedChannels < 4)
+                {
+                    continue;
+                }
+
+                const std::vector<uint8_t> blocks = codec.encode(image);
+                const double result = psnr(image, codec.decode(blocks, SIZE, SIZE), codec.comparedChannels);
+                const bool passed = result >= testCase.minimumPsnr;
+                failures += passed ? 0 : 1;
+                std::printf("%-4s %-4.*s %-22.*s %7.2f dB (minimum %.1f)\n", passed ? "ok" : "FAIL", static_cast<int>(codec.name.size()), codec.name.data(),
+                    static_cast<int>(testCase.name.size()), testCase.name.data(), result, testCase.minimumPsnr);
+            }
+        }
+    }
+    catch (const std::exception& exception)
+    {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+
+    return failures == 0 ? 0 : 1;
+}